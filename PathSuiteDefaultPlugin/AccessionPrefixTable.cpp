@@ -0,0 +1,59 @@
+#include "stdafx.h"
+#include "AccessionPrefixTable.h"
+
+using namespace std;
+using namespace std::tr2;
+
+AccessionPrefixTable& AccessionPrefixTable::Instance()
+{
+    static AccessionPrefixTable table;
+    return table;
+}
+
+void AccessionPrefixTable::Refresh(const sys::path& prefixFile)
+{
+    bool exists = sys::exists(prefixFile);
+    time_t modified = exists ? sys::last_write_time(prefixFile) : 0;
+    if (loaded && prefixFile == sourceFile && modified == lastWriteTime)
+        return;
+
+    sourceFile = prefixFile;
+    lastWriteTime = modified;
+    loaded = true;
+    prefixes.clear();
+    descriptions.clear();
+    prefixList.clear();
+    if (exists)
+        Load();
+}
+
+void AccessionPrefixTable::Load()
+{
+    MappedFile file;
+    if (!file.Open(sourceFile.string()))
+        return;
+    for (auto line : file.Lines())
+    {
+        auto separator = find(line.begin(), line.end(), '-');
+        boost::string_ref trimmedPrefix = TrimView(boost::string_ref(line.begin(), separator - line.begin()));
+        string prefix(trimmedPrefix.begin(), trimmedPrefix.end());
+        prefixes.push_back(prefix);
+        prefixList.append(prefix).append("\n");
+        if (separator != line.end() && separator + 1 != line.end())
+        {   // The description ends at the next separator
+            auto descriptionEnd = find(separator + 1, line.end(), '-');
+            boost::string_ref description = TrimView(boost::string_ref(separator + 1, descriptionEnd - (separator + 1)));
+            if (descriptions.find(prefix) == descriptions.end()) // the first entry for a prefix wins
+                descriptions[prefix] = string(description.begin(), description.end());
+        }
+    }
+}
+
+bool AccessionPrefixTable::TryGetDescription(const string& prefix, string& description) const
+{
+    auto item = descriptions.find(prefix);
+    if (item == descriptions.end())
+        return false;
+    description = item->second;
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <ctime>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+
+/// Summary:
+///   In memory copy of the catalog accession prefix file (AccessionPrefixes.txt).
+///   Each line of the file has the form "PREFIX - Description".
+///   The file is parsed once and is only read again when its last write time changes.
+///   This object is not thread safe. It is only used from the host UI thread.
+class AccessionPrefixTable
+{
+    std::tr2::sys::path sourceFile;
+    time_t lastWriteTime;
+    bool loaded;
+    std::vector<std::string> prefixes;                          // in the same order as the file
+    std::unordered_map<std::string, std::string> descriptions;  // prefix -> description
+    std::string prefixList;                                     // prefixes joined with a trailing '\n' for each
+
+    AccessionPrefixTable() : lastWriteTime(0), loaded(false) {}
+    AccessionPrefixTable(const AccessionPrefixTable&);
+    AccessionPrefixTable& operator = (const AccessionPrefixTable&);
+
+    void Load();
+
+public:
+    static AccessionPrefixTable& Instance();
+
+    /// Summary:
+    ///   Makes sure the table reflects the current contents of the file.
+    ///   The file is only parsed if it is a different file or if it was modified since it was last read.
+    ///   A missing file results in an empty table.
+    void Refresh(const std::tr2::sys::path& prefixFile);
+
+    /// The prefixes in file order.
+    const std::vector<std::string>& Prefixes() const { return prefixes; }
+
+    /// The prefixes in file order with each one followed by a newline char '\n'.
+    const std::string& PrefixList() const { return prefixList; }
+
+    /// Summary:
+    ///   Finds the description of a prefix.
+    /// Returns:
+    ///   True if the prefix was found
+    bool TryGetDescription(const std::string& prefix, std::string& description) const;
+};
@@ -0,0 +1,193 @@
+#include "stdafx.h"
+#include <mmsystem.h>
+#include "AcquisitionScheduler.h"
+
+#pragma comment(lib, "winmm.lib")
+
+using namespace std;
+
+namespace
+{
+    int64_t PerformanceCounterMicroseconds()
+    {
+        static LARGE_INTEGER frequency;
+        if (frequency.QuadPart == 0)
+            QueryPerformanceFrequency(&frequency);
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        // Split so the multiplication does not overflow for counters that run for a long time
+        return (counter.QuadPart / frequency.QuadPart) * 1000000 + (counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+    }
+
+    bool AcquireWithHost()
+    {
+        return PluginHost::DoAction(SpotPluginApi::HostActionRequest::AcqSingleImage, 0, nullptr);
+    }
+
+    // A thread timer posts WM_TIMER to the host's thread, so the scheduler runs there like any other host callback.
+    // The system timer resolution is raised to 1 ms while a timer is set.
+    UINT_PTR wakeTimer = 0;
+
+    void CALLBACK OnWakeTimer(HWND, UINT, UINT_PTR, DWORD)
+    {
+        AcquisitionScheduler::Instance().Poll();
+    }
+
+    void WakeWithTimer(int64_t delayMicroseconds)
+    {
+        if (delayMicroseconds < 0)
+        {
+            if (wakeTimer != 0)
+            {
+                KillTimer(NULL, wakeTimer);
+                timeEndPeriod(1);
+                wakeTimer = 0;
+            }
+            return;
+        }
+        if (wakeTimer == 0)
+            timeBeginPeriod(1);
+        UINT delay = static_cast<UINT>(max<int64_t>(USER_TIMER_MINIMUM, (delayMicroseconds + 999) / 1000));
+        UINT_PTR timer = SetTimer(NULL, wakeTimer, delay, OnWakeTimer);
+        if (timer == 0 && wakeTimer == 0)
+            timeEndPeriod(1); // Poll is still called when the host is idle
+        else if (timer != 0)
+            wakeTimer = timer;
+    }
+}
+
+const vector<int64_t>& AcquisitionScheduler::JitterBuckets()
+{
+    static const int64_t bounds[] = { 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000 };
+    static const vector<int64_t> buckets(begin(bounds), end(bounds));
+    return buckets;
+}
+
+AcquisitionScheduler::AcquisitionScheduler(clock_func_t clock, acquire_func_t acquire, wake_func_t wake) :
+    clock(clock), acquire(acquire), wake(wake), mode(Mode::FixedRate), interval(0), shotCount(0), nextSlot(0), startTime(0), nextDelayDue(0), polling(false)
+{
+}
+
+AcquisitionScheduler& AcquisitionScheduler::Instance()
+{
+    static AcquisitionScheduler scheduler(PerformanceCounterMicroseconds, AcquireWithHost, WakeWithTimer);
+    return scheduler;
+}
+
+bool AcquisitionScheduler::Start(Mode newMode, int64_t newInterval, size_t count, const vector<int64_t>& newOffsets)
+{
+    if (status.running)
+        return false;
+    mode = newMode;
+    interval = newInterval;
+    offsets = newOffsets;
+    shotCount = count;
+    nextSlot = 0;
+    nextDelayDue = 0;
+    status = AcquisitionStatus();
+    status.jitter.assign(JitterBuckets().size() + 1, 0);
+    status.running = true;
+    shots.clear();
+    startTime = clock();
+    Poll();
+    return true;
+}
+
+bool AcquisitionScheduler::StartFixedRate(int64_t intervalMicroseconds, size_t count)
+{
+    return intervalMicroseconds > 0 && Start(Mode::FixedRate, intervalMicroseconds, count, vector<int64_t>());
+}
+
+bool AcquisitionScheduler::StartFixedDelay(int64_t delayMicroseconds, size_t count)
+{
+    return delayMicroseconds >= 0 && Start(Mode::FixedDelay, delayMicroseconds, count, vector<int64_t>());
+}
+
+bool AcquisitionScheduler::StartBurst(vector<int64_t> offsetMicroseconds)
+{
+    sort(offsetMicroseconds.begin(), offsetMicroseconds.end());
+    if (offsetMicroseconds.empty() || offsetMicroseconds.front() < 0)
+        return false;
+    size_t count = offsetMicroseconds.size();
+    return Start(Mode::Burst, 0, count, offsetMicroseconds);
+}
+
+void AcquisitionScheduler::Stop()
+{
+    status.running = false;
+    wake(-1);
+}
+
+int64_t AcquisitionScheduler::PlannedTime(size_t slot) const
+{
+    switch (mode)
+    {
+    case Mode::FixedRate:
+        return static_cast<int64_t>(slot) * interval;
+    case Mode::FixedDelay:
+        return nextDelayDue;
+    default:
+        return offsets[slot];
+    }
+}
+
+void AcquisitionScheduler::Poll()
+{
+    // The host may dispatch the wake up timer while it acquires
+    if (polling)
+        return;
+    polling = true;
+    while (status.running)
+    {
+        int64_t now = clock() - startTime;
+        int64_t planned = PlannedTime(nextSlot);
+        if (now < planned)
+        {
+            wake(planned - now);
+            break;
+        }
+
+        // Take only the latest slot that is due
+        if (mode == Mode::FixedRate)
+        {
+            size_t due = static_cast<size_t>(now / interval);
+            if (shotCount != 0)
+                due = min(due, shotCount - 1);
+            status.missed += due - nextSlot;
+            nextSlot = due;
+        }
+        else if (mode == Mode::Burst)
+        {
+            while (nextSlot + 1 < shotCount && offsets[nextSlot + 1] <= now)
+            {
+                ++status.missed;
+                ++nextSlot;
+            }
+        }
+        Issue(PlannedTime(nextSlot), now);
+        ++nextSlot;
+        if (mode == Mode::FixedDelay)
+            nextDelayDue = clock() - startTime + interval;
+        if (shotCount != 0 && nextSlot >= shotCount)
+            Stop();
+    }
+    polling = false;
+}
+
+void AcquisitionScheduler::Issue(int64_t planned, int64_t actual)
+{
+    AcquisitionShot shot;
+    shot.planned = planned;
+    shot.actual = actual;
+    shot.succeeded = acquire();
+    ++status.issued;
+    if (!shot.succeeded)
+        ++status.failed;
+    int64_t lateness = actual - planned;
+    status.maxLateness = max(status.maxLateness, lateness);
+    status.totalLateness += lateness;
+    const vector<int64_t>& buckets = JitterBuckets();
+    ++status.jitter[upper_bound(buckets.begin(), buckets.end(), lateness - 1) - buckets.begin()];
+    if (shots.size() < MaxShotsKept)
+        shots.push_back(shot);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <functional>
+
+/// Summary:
+///   The time a scheduled acquisition was planned for and the time it was issued,
+///   in microseconds since the schedule started.
+struct AcquisitionShot
+{
+    int64_t planned;
+    int64_t actual;
+    bool succeeded;
+};
+
+/// Summary:
+///   The state of the current or last acquisition schedule.
+struct AcquisitionStatus
+{
+    AcquisitionStatus() : running(false), issued(0), failed(0), missed(0), maxLateness(0), totalLateness(0) {}
+
+    bool running;
+    size_t issued;              // Acquisitions requested from the host, including those that failed
+    size_t failed;              // Acquisitions the host did not perform
+    size_t missed;              // Slots skipped because a later slot was already due
+    int64_t maxLateness;        // microseconds
+    int64_t totalLateness;      // microseconds, for the mean
+    std::vector<size_t> jitter; // The number of shots in each AcquisitionScheduler::JitterBuckets range of lateness
+};
+
+/// Summary:
+///   Requests single image acquisitions from the host on a schedule.
+///   Fixed rate shots are planned at start + n * interval, so a late shot does not delay the ones after it.
+///   Fixed delay shots are planned a delay after the previous shot was issued.
+///   Burst shots are planned at a list of offsets from the start.
+///   When several fixed rate or burst slots are due at once only the latest is taken and the others are counted as missed.
+///
+///   The clock, the acquisition and the wake up request are functions so the schedule can be run against a mock host.
+///   Poll must be called on the host's thread. The default scheduler is woken by a thread timer on the host's thread,
+///   and Poll is also called when the host is idle.
+class AcquisitionScheduler
+{
+public:
+    typedef std::function<int64_t()> clock_func_t;          // A monotonic time in microseconds
+    typedef std::function<bool()> acquire_func_t;           // Requests an acquisition. Returns false if it failed.
+    typedef std::function<void(int64_t)> wake_func_t;       // Asks for Poll to be called after a number of microseconds. Negative when no call is needed.
+
+    /// The upper bounds in microseconds of the lateness ranges of AcquisitionStatus::jitter. The last range has no upper bound.
+    static const std::vector<int64_t>& JitterBuckets();
+
+    /// The most shots kept for Shots(). Later shots are counted but not kept.
+    static const size_t MaxShotsKept = 100000;
+
+private:
+    enum class Mode { FixedRate, FixedDelay, Burst };
+
+    clock_func_t clock;
+    acquire_func_t acquire;
+    wake_func_t wake;
+
+    Mode mode;
+    int64_t interval;               // fixed rate interval or fixed delay, in microseconds
+    std::vector<int64_t> offsets;   // burst offsets, in microseconds
+    size_t shotCount;               // 0 for a fixed rate or fixed delay schedule that runs until stopped
+    size_t nextSlot;
+    int64_t startTime;
+    int64_t nextDelayDue;           // fixed delay only, since the start
+    bool polling;
+    AcquisitionStatus status;
+    std::vector<AcquisitionShot> shots;
+
+    AcquisitionScheduler(const AcquisitionScheduler&);
+    AcquisitionScheduler& operator = (const AcquisitionScheduler&);
+
+    bool Start(Mode mode, int64_t interval, size_t count, const std::vector<int64_t>& offsets);
+    int64_t PlannedTime(size_t slot) const;
+    void Issue(int64_t planned, int64_t actual);
+
+public:
+    AcquisitionScheduler(clock_func_t clock, acquire_func_t acquire, wake_func_t wake);
+
+    /// Summary:
+    ///   The scheduler that acquires through the host. Its clock is QueryPerformanceCounter.
+    static AcquisitionScheduler& Instance();
+
+    /// Summary:
+    ///   Starts acquiring at a fixed rate. The first shot is taken immediately.
+    /// Arguments:
+    ///   intervalMicroseconds - The time between planned shots
+    ///   count - The number of shots. Zero runs until Stop is called.
+    /// Returns:
+    ///   False if a schedule is already running or the interval is not positive
+    bool StartFixedRate(int64_t intervalMicroseconds, size_t count);
+
+    /// Summary:
+    ///   Starts acquiring with a fixed delay between the end of one request and the start of the next.
+    ///   The first shot is taken immediately.
+    /// Returns:
+    ///   False if a schedule is already running or the delay is negative
+    bool StartFixedDelay(int64_t delayMicroseconds, size_t count);
+
+    /// Summary:
+    ///   Starts acquiring at a list of times.
+    /// Arguments:
+    ///   offsetMicroseconds - The time of each shot from the start. They are sorted before use.
+    /// Returns:
+    ///   False if a schedule is already running, the list is empty or an offset is negative
+    bool StartBurst(std::vector<int64_t> offsetMicroseconds);
+
+    void Stop();
+
+    bool IsRunning() const { return status.running; }
+
+    /// Summary:
+    ///   Issues the acquisitions that are due and asks to be woken for the next one.
+    void Poll();
+
+    const AcquisitionStatus& Status() const { return status; }
+
+    /// The shots of the current or last schedule in the order they were taken
+    const std::vector<AcquisitionShot>& Shots() const { return shots; }
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+/// Summary:
+///   Runs queued tasks one at a time on a single lazily created worker thread.
+///   Tasks must not call back into the host application (HostInterop) since the
+///   host only services requests made on its own UI thread.
+class BackgroundWorker
+{
+public:
+    typedef std::function<void()> task_t;
+
+private:
+    std::thread worker;
+    std::mutex queueLock;
+    std::condition_variable queueChanged;
+    std::deque<task_t> tasks;
+    std::atomic<bool> stopRequested;
+    int threadPriority;
+
+    // no copies allowed
+    BackgroundWorker(const BackgroundWorker&);
+    BackgroundWorker& operator = (const BackgroundWorker&);
+
+    void Run()
+    {
+        SetThreadPriority(GetCurrentThread(), threadPriority);
+        for (;;)
+        {
+            task_t task;
+            {
+                std::unique_lock<std::mutex> lock(queueLock);
+                while (tasks.empty() && !stopRequested)
+                    queueChanged.wait(lock);
+                if (stopRequested)
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            try
+            {
+                task();
+            }
+            catch(const std::exception& ex)
+            {
+                OutputDebugStringA(ex.what());
+            }
+        }
+    }
+
+public:
+    /// Summary:
+    ///   Constructs an idle worker. The thread is not started until the first task is posted.
+    /// Arguments:
+    ///   priority - A Win32 thread priority value (e.g. THREAD_PRIORITY_LOWEST) for the worker thread.
+    explicit BackgroundWorker(int priority = THREAD_PRIORITY_LOWEST) :
+        stopRequested(false), threadPriority(priority)
+    {
+    }
+
+    ~BackgroundWorker()
+    {
+        Stop();
+    }
+
+    /// Summary:
+    ///   Queues a task to be run on the worker thread after all previously posted tasks.
+    ///   Tasks posted after Stop() has been called are discarded.
+    void Post(task_t task)
+    {
+        std::lock_guard<std::mutex> lock(queueLock);
+        if (stopRequested)
+            return;
+        tasks.push_back(std::move(task));
+        if (!worker.joinable())
+            worker = std::thread(&BackgroundWorker::Run, this);
+        queueChanged.notify_one();
+    }
+
+    /// Summary:
+    ///   Discards any pending tasks and waits for the running task to finish.
+    ///   Long running tasks should poll StopRequested() so that this returns promptly.
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(queueLock);
+            stopRequested = true;
+            tasks.clear();
+            queueChanged.notify_all();
+        }
+        if (worker.joinable())
+            worker.join();
+    }
+
+    /// Returns true once Stop() has been called.
+    bool StopRequested() const { return stopRequested; }
+
+    /// Summary:
+    ///   A shared low priority worker for housekeeping that must never compete with the UI thread.
+    ///   Stop() must be called before the plug-in is unloaded.
+    static BackgroundWorker& LowPriority()
+    {
+        static BackgroundWorker lowPriorityWorker(THREAD_PRIORITY_LOWEST);
+        return lowPriorityWorker;
+    }
+};
@@ -0,0 +1,370 @@
+#include "stdafx.h"
+
+// Timing harness that compares helpers with the implementations they replaced.
+// It is only compiled into the plug-in when PATHSUITE_BENCHMARKS is defined, and runs without the host:
+//   rundll32 PathSuiteDefaultPlugin.dll,RunBenchmarks <work directory>
+// The work directory must exist. The results are written to benchmarks.txt in it.
+// The file operations are timed in the work directory, so pass a folder on a file share to time a catalog on a share.
+#ifdef PATHSUITE_BENCHMARKS
+
+#include <locale>
+#include <fstream>
+#include <sstream>
+#include <functional>
+#include <filesystem>
+#include "Utilities.h"
+#include "DirectoryScanner.h"
+#include "FileOperationBatch.h"
+#include "CommonFileIo.h"
+#include "MappedFile.h"
+
+#pragma comment(linker, "/EXPORT:RunBenchmarks=_RunBenchmarks@16")
+
+using namespace std;
+namespace sys = std::tr2::sys;
+
+namespace
+{
+    // Results are added here so that the optimizer can not drop the work being timed
+    volatile size_t sink;
+
+    const int Trials = 5;
+
+    // The best time of several trials, in milliseconds. setup runs before each trial and is not timed.
+    double BestMilliseconds(const function<void()>& setup, const function<void()>& body)
+    {
+        LARGE_INTEGER frequency, start, end;
+        QueryPerformanceFrequency(&frequency);
+        double best = 0;
+        for (int trial = 0; trial < Trials; ++trial)
+        {
+            if (setup)
+                setup();
+            QueryPerformanceCounter(&start);
+            body();
+            QueryPerformanceCounter(&end);
+            double elapsed = (end.QuadPart - start.QuadPart) * 1000.0 / frequency.QuadPart;
+            if (trial == 0 || elapsed < best)
+                best = elapsed;
+        }
+        return best;
+    }
+
+    void Compare(ostream& report, const string& name, const function<void()>& before, const function<void()>& after,
+                 const function<void()>& setup = function<void()>())
+    {
+        double beforeTime = BestMilliseconds(setup, before);
+        double afterTime = BestMilliseconds(setup, after);
+        report << name << ": before " << beforeTime << " ms, after " << afterTime << " ms";
+        if (afterTime > 0)
+            report << " (" << beforeTime / afterTime << "x)";
+        report << endl;
+    }
+
+    // The string helpers as they were before Split, TrimView and the ASCII case folding were added
+    namespace before
+    {
+        vector<string> Explode(const string& src, char sectionDivider)
+        {
+            vector<string> sections;
+            for (string::const_iterator sectionStart = src.begin(); sectionStart != src.end(); )
+            {
+                string::const_iterator sectionEnd = find(sectionStart, src.end(), sectionDivider);
+                sections.push_back(string(sectionStart, sectionEnd));
+                sectionStart = (sectionEnd != src.end()) ? ++sectionEnd : src.end();
+            }
+            return sections;
+        }
+
+        string TrimCopy(string toTrim)
+        {
+            toTrim.erase(find_if_not(toTrim.rbegin(), toTrim.rend(), [] (char c) { return isspace(c, locale::classic()); }).base(), toTrim.end());
+            toTrim.erase(toTrim.begin(), find_if_not(toTrim.begin(), toTrim.end(), [] (char c) { return isspace(c, locale::classic()); }));
+            return toTrim;
+        }
+
+        // Also dropped the separator before every third item, which does not change the cost
+        string JoinWith(vector<string>::const_iterator first, vector<string>::const_iterator last, const string& joinWith)
+        {
+            string output;
+            while (first != last)
+            {
+                output.append(*(first++));
+                if (first != last)
+                    output.append(joinWith).append(*(first++));
+            }
+            return output;
+        }
+
+        bool AreEqualIgnoreCase(const string& first, const string& second)
+        {
+            if (first.size() != second.size())
+                return false;
+            for (size_t i = 0; i < first.size(); ++i)
+            {
+                if (tolower(first[i], locale::classic()) != tolower(second[i], locale::classic()))
+                    return false;
+            }
+            return true;
+        }
+    }
+
+    // A newline separated list of padded case ids, like the list arguments of the catalog actions
+    void StringBenchmarks(ostream& report)
+    {
+        const int Repetitions = 200;
+        vector<string> caseIds;
+        string list;
+        for (int i = 0; i < 2000; ++i)
+        {
+            caseIds.push_back("S" + to_string(10 + i % 20) + "-" + to_string(10000 + i));
+            list.append("  ").append(caseIds.back()).append(" \r\n");
+        }
+
+        Compare(report, "Split and trim a list of 2000 case ids",
+            [&] ()
+            {
+                for (int repetition = 0; repetition < Repetitions; ++repetition)
+                {
+                    for (auto& caseId : before::Explode(list, '\n'))
+                        sink += before::TrimCopy(caseId).size();
+                }
+            },
+            [&] ()
+            {
+                for (int repetition = 0; repetition < Repetitions; ++repetition)
+                {
+                    for (auto caseId : Split(list, '\n'))
+                        sink += TrimView(caseId).size();
+                }
+            });
+
+        Compare(report, "Join 2000 case ids",
+            [&] ()
+            {
+                for (int repetition = 0; repetition < Repetitions; ++repetition)
+                    sink += before::JoinWith(caseIds.begin(), caseIds.end(), "\n").size();
+            },
+            [&] ()
+            {
+                for (int repetition = 0; repetition < Repetitions; ++repetition)
+                    sink += JoinWith(caseIds.begin(), caseIds.end(), "\n").size();
+            });
+
+        // Every id has the same length, so each comparison folds the whole prefix
+        Compare(report, "Match a typed prefix against 2000 case ids",
+            [&] ()
+            {
+                for (int repetition = 0; repetition < Repetitions; ++repetition)
+                {
+                    for (auto& caseId : caseIds)
+                        sink += before::AreEqualIgnoreCase(caseId.substr(0, 6), string("s29-19"));
+                }
+            },
+            [&] ()
+            {
+                for (int repetition = 0; repetition < Repetitions; ++repetition)
+                {
+                    for (auto& caseId : caseIds)
+                        sink += AreEqualIgnoreCase(boost::string_ref(caseId).substr(0, 6), "s29-19");
+                }
+            });
+    }
+
+    // A catalog of 10 cases with 2 specimens of 100 images each
+    vector<sys::path> CreateCatalog(const sys::path& root)
+    {
+        sys::remove_all(root);
+        vector<sys::path> images;
+        for (int caseNumber = 0; caseNumber < 10; ++caseNumber)
+        {
+            string caseId = "S12-" + to_string(100 + caseNumber);
+            for (int specimen = 1; specimen <= 2; ++specimen)
+            {
+                sys::path specimenDir = root / sys::path(caseId) / sys::path(to_string(specimen));
+                sys::create_directories(specimenDir);
+                for (int image = 1; image <= 100; ++image)
+                {
+                    images.push_back(specimenDir / sys::path(caseId + "." + to_string(specimen) + "." + to_string(image) + ".jpg"));
+                    ofstream(images.back().string()).put('x');
+                }
+            }
+        }
+        return images;
+    }
+
+    // Renames and deletes one at a time, as UpdateCatalog and CaseArchive did, against FileOperationBatch,
+    // and walks the catalog with recursive_directory_iterator, as UpdateCatalog did, against DirectoryScanner
+    void FileOperationBenchmarks(ostream& report, const sys::path& workDirectory)
+    {
+        sys::path root = workDirectory / "FileOperations";
+        vector<sys::path> images;
+        auto setup = [&] () { images = CreateCatalog(root); };
+        auto renamed = [] (const sys::path& image) { return image.parent_path() / sys::path("r" + image.filename()); };
+
+        Compare(report, "Rename 2000 images",
+            [&] ()
+            {
+                for (auto& image : images)
+                    sys::rename(image, renamed(image));
+            },
+            [&] ()
+            {
+                FileOperationBatch renames;
+                for (auto& image : images)
+                    renames.AddRename(image, renamed(image));
+                if (renames.Execute() > 0)
+                    throw runtime_error("A rename failed");
+            },
+            setup);
+
+        Compare(report, "Delete 2000 images",
+            [&] ()
+            {
+                for (auto& image : images)
+                    sys::remove(image);
+            },
+            [&] ()
+            {
+                FileOperationBatch deletes;
+                for (auto& image : images)
+                    deletes.AddDelete(image);
+                if (deletes.Execute() > 0)
+                    throw runtime_error("A delete failed");
+            },
+            setup);
+
+        setup();
+        Compare(report, "List the images of 20 specimens",
+            [&] ()
+            {
+                for (auto entry = sys::recursive_directory_iterator(root); entry != sys::recursive_directory_iterator(); ++entry)
+                {
+                    if (entry.level() == 2 && sys::is_regular_file(entry->path()))
+                        ++sink;
+                }
+            },
+            [&] ()
+            {
+                for (auto& caseId : DirectoryScanner::ListDirectories(root))
+                {
+                    for (auto& specimen : DirectoryScanner::ListDirectories(root / sys::path(caseId)))
+                    {
+                        for (auto& entry : DirectoryScanner::List(root / sys::path(caseId) / sys::path(specimen)))
+                            sink += !entry.isDirectory;
+                    }
+                }
+            });
+        sys::remove_all(root);
+    }
+
+    // The file readers as they were before MappedFile was added
+    namespace before
+    {
+        string ReadFileToString(const string& fileName)
+        {
+            ifstream file;
+            file.exceptions(ifstream::failbit | ifstream::badbit);
+            file.open(fileName);
+            return string(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        }
+
+        vector<string> ReadFileToStrings(const string& fileName)
+        {
+            ifstream file;
+            file.exceptions(ifstream::badbit);
+            file.open(fileName);
+            vector<string> lines;
+            while (file)
+            {
+                string newLine;
+                getline(file, newLine);
+                if (file || !newLine.empty())
+                    lines.push_back(move(newLine));
+            }
+            return lines;
+        }
+    }
+
+    // A large CRLF text file, and a small file like a lock file that is read many times
+    void FileReadingBenchmarks(ostream& report, const sys::path& workDirectory)
+    {
+        string largeFile = sys::path(workDirectory / "Lines.txt").string();
+        string smallFile = sys::path(workDirectory / "case.lock").string();
+        {
+            ofstream large(largeFile, ios::binary);
+            for (int line = 0; line < 200000; ++line)
+                large << "S" << line % 100 << "-;Surgical pathology specimen " << line << "\r\n";
+            ofstream small(smallFile, ios::binary);
+            small << "WORKSTATION-12\r\njsmith\r\n2026-10-19 08:15:00\r\n";
+        }
+
+        Compare(report, "Read a 200000 line file to a string",
+            [&] () { sink += before::ReadFileToString(largeFile).size(); },
+            [&] () { sink += ReadFileToString(largeFile).size(); });
+
+        Compare(report, "Read a 200000 line file to a vector of lines",
+            [&] () { sink += before::ReadFileToStrings(largeFile).size(); },
+            [&] () { sink += ReadFileToStrings(largeFile).size(); });
+
+        Compare(report, "Visit each line of a 200000 line file",
+            [&] ()
+            {
+                for (auto& line : before::ReadFileToStrings(largeFile))
+                    sink += line.size();
+            },
+            [&] ()
+            {
+                MappedFile file(largeFile);
+                for (auto line : file.Lines())
+                    sink += line.size();
+            });
+
+        Compare(report, "Stream each line of a 200000 line file",
+            [&] ()
+            {
+                ifstream file(largeFile);
+                string line;
+                while (getline(file, line))
+                    sink += line.size();
+            },
+            [&] ()
+            {
+                MappedFile::ForEachLine(largeFile, [] (boost::string_ref line) -> bool { sink += line.size(); return true; });
+            });
+
+        Compare(report, "Read a lock file 1000 times",
+            [&] ()
+            {
+                for (int read = 0; read < 1000; ++read)
+                    sink += before::ReadFileToStrings(smallFile).size();
+            },
+            [&] ()
+            {
+                for (int read = 0; read < 1000; ++read)
+                    sink += ReadFileToStrings(smallFile).size();
+            });
+        sys::remove(sys::path(largeFile));
+        sys::remove(sys::path(smallFile));
+    }
+}
+
+extern "C" void CALLBACK RunBenchmarks(HWND, HINSTANCE, LPSTR commandLine, int)
+{
+    sys::path workDirectory(TrimCopy(string(commandLine)));
+    ostringstream report;
+    try
+    {
+        StringBenchmarks(report);
+        FileOperationBenchmarks(report, workDirectory);
+        FileReadingBenchmarks(report, workDirectory);
+    }
+    catch(const std::exception& ex)
+    {
+        report << "Failed: " << ex.what() << endl;
+    }
+    ofstream output(sys::path(workDirectory / "benchmarks.txt").string());
+    output << report.str();
+}
+
+#endif
@@ -5,6 +5,7 @@
 #include <exception>
 #include "SpotPlugin.h"
 #include "HostVariables.h"
+#include "StallWatchdog.h"
 
 typedef void (*action_func_t)(void); 
 
@@ -42,6 +43,7 @@ public:
         case SpotPluginApi::CallbackReason::ActionCode:
             try
             {
+                StallWatchdog::CallScope scope(StallWatchdog::CallKind::Action, info);
                 if (obj->actionFunctions[info] != nullptr)
                     obj->actionFunctions[info]();
             }
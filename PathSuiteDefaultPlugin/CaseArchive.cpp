@@ -0,0 +1,563 @@
+#include "stdafx.h"
+#include <map>
+#include <mutex>
+#include "CatalogFiles.h"
+#include "CaseArchive.h"
+#include "CaseLockManager.h"
+#include "DirectoryScanner.h"
+#include "FileOperationBatch.h"
+#include "BackgroundWorker.h"
+#include "Xxh64.h"
+
+using namespace std;
+using namespace std::tr2;
+
+const string CaseArchive::FileName = "case.archive";
+
+namespace
+{
+    const char ARCHIVE_SIGNATURE[8] = {'P', 'S', 'A', 'R', 'C', 'H', 'V', '\0'};
+    const uint32_t ARCHIVE_VERSION = 1;
+    const DWORD COPY_BUFFER_SIZE = 1024 * 1024;
+
+#pragma pack(push, 8)
+    struct ArchiveHeader
+    {
+        char signature[8];
+        uint32_t version;
+        uint32_t pageSize;
+        uint64_t indexOffset;
+        uint64_t indexLength;
+        uint64_t entryCount;
+    };
+#pragma pack(pop)
+
+    ULONGLONG ToTicks(const FILETIME& ft)
+    {
+        return (static_cast<ULONGLONG>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    }
+
+    FILETIME ToFileTime(ULONGLONG ticks)
+    {
+        FILETIME ft;
+        ft.dwLowDateTime = static_cast<DWORD>(ticks);
+        ft.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+        return ft;
+    }
+
+    // Owns a Win32 file handle
+    class FileHandle
+    {
+        HANDLE handle;
+        FileHandle(const FileHandle&);
+        FileHandle& operator = (const FileHandle&);
+    public:
+        explicit FileHandle(HANDLE h) : handle(h) {}
+        ~FileHandle() { if (handle != INVALID_HANDLE_VALUE) CloseHandle(handle); }
+        HANDLE Get() const { return handle; }
+        bool IsValid() const { return handle != INVALID_HANDLE_VALUE; }
+    };
+
+    void WriteAll(HANDLE file, const void* data, size_t length, const sys::path& name)
+    {
+        DWORD written = 0;
+        if (!WriteFile(file, data, static_cast<DWORD>(length), &written, NULL) || written != length)
+            throw runtime_error("Unable to write " + name.string() + " (error " + to_string(GetLastError()) + ")");
+    }
+
+    void ReadAll(HANDLE file, void* data, size_t length, const sys::path& name)
+    {
+        DWORD read = 0;
+        if (!ReadFile(file, data, static_cast<DWORD>(length), &read, NULL) || read != length)
+            throw runtime_error("Unable to read " + name.string());
+    }
+
+    void Seek(HANDLE file, uint64_t offset, const sys::path& name)
+    {
+        LARGE_INTEGER position;
+        position.QuadPart = offset;
+        if (!SetFilePointerEx(file, position, NULL, FILE_BEGIN))
+            throw runtime_error("Unable to seek in " + name.string() + " (error " + to_string(GetLastError()) + ")");
+    }
+
+    // Lists the contents of a directory tree, directories before their contents
+    void CollectEntries(const sys::path& directory, const string& relative, vector<CaseArchiveEntry>& entries)
+    {
+        vector<string> subdirectories;
+        DirectoryScanner scanner(directory);
+        DirectoryEntry found;
+        while (scanner.Next(found))
+        {
+            CaseArchiveEntry entry;
+            entry.path = relative.empty() ? found.name : relative + '\\' + found.name;
+            entry.isDirectory = found.isDirectory;
+            entry.size = found.size;
+            entry.writeTime = ToTicks(found.writeTime);
+            entries.push_back(entry);
+            if (entry.isDirectory)
+                subdirectories.push_back(found.name);
+        }
+        scanner.ThrowIfFailed();
+        for (auto& name : subdirectories)
+            CollectEntries(directory / sys::path(name), relative.empty() ? name : relative + '\\' + name, entries);
+    }
+
+    // Checks that an archive holds the entries that were written to it with the data that was read from the
+    // originals, and that the originals have not changed since. Returns an empty string, or the reason it failed.
+    string VerifyArchive(const sys::path& archiveFile, const sys::path& caseDir, const vector<CaseArchiveEntry>& entries, const vector<uint64_t>& hashes)
+    {
+        vector<CaseArchiveEntry> written = CaseArchive::ReadIndex(archiveFile);
+        if (written.size() != entries.size())
+            return "the archive index has " + to_string(written.size()) + " entries instead of " + to_string(entries.size());
+        FileHandle archive(CreateFileA(archiveFile.string().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+        if (!archive.IsValid())
+            return "the archive cannot be read (error " + to_string(GetLastError()) + ")";
+        unique_ptr<char[]> buffer(new char[COPY_BUFFER_SIZE]);
+        for (size_t index = 0; index < entries.size(); ++index)
+        {
+            const CaseArchiveEntry& entry = entries[index];
+            if (written[index].path != entry.path || written[index].isDirectory != entry.isDirectory ||
+                written[index].offset != entry.offset || written[index].size != entry.size)
+                return "the archive index does not match the entry of " + entry.path;
+            if (entry.isDirectory)
+                continue;
+            Xxh64 hash;
+            Seek(archive.Get(), entry.offset, archiveFile);
+            for (uint64_t remaining = entry.size; remaining > 0; )
+            {
+                DWORD chunk = static_cast<DWORD>(min<uint64_t>(remaining, COPY_BUFFER_SIZE));
+                ReadAll(archive.Get(), buffer.get(), chunk, archiveFile);
+                hash.Update(buffer.get(), chunk);
+                remaining -= chunk;
+            }
+            if (hash.Digest() != hashes[index])
+                return "the archived data of " + entry.path + " does not match the original";
+            WIN32_FILE_ATTRIBUTE_DATA attributes;
+            sys::path source = caseDir / sys::path(entry.path);
+            if (!GetFileAttributesExA(source.string().c_str(), GetFileExInfoStandard, &attributes) ||
+                ((static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow) != entry.size ||
+                ToTicks(attributes.ftLastWriteTime) != entry.writeTime)
+                return entry.path + " was changed while the case was archived";
+        }
+        return string();
+    }
+
+    // Returns true for a path that stays within the case directory when it is joined to it: no drive or root,
+    // no empty, "." or ".." elements and no characters that Windows does not allow in a name
+    bool IsRelativeCasePath(const string& path)
+    {
+        if (path.empty() || path.back() == '\\' || path.find_first_of("/:*?\"<>|") != string::npos)
+            return false;
+        for (auto& element : Explode(path, '\\'))
+        {
+            if (element.empty() || element == "." || element == "..")
+                return false;
+        }
+        return true;
+    }
+
+    // Locks a case for this workstation and releases the lock when it goes out of scope.
+    // Throws runtime_error if the case is open on this workstation or locked by another one.
+    class HeldCaseLock
+    {
+        sys::path lockFile;
+        HeldCaseLock(const HeldCaseLock&);
+        HeldCaseLock& operator = (const HeldCaseLock&);
+    public:
+        HeldCaseLock(const sys::path& caseDir, const string& userName, const string& operation) : lockFile(caseDir / sys::path("case.lock"))
+        {
+            if (CaseLockManager::Instance().IsOwned(lockFile))
+                throw runtime_error("The case is open on this workstation and cannot be " + operation + ".");
+            string currentHolder;
+            if (!CaseLockManager::Instance().Acquire(lockFile, userName, currentHolder))
+                throw runtime_error("The case is locked and cannot be " + operation + ".\n" + currentHolder);
+        }
+        ~HeldCaseLock() { CaseLockManager::Instance().Release(lockFile); }
+    };
+
+    void ThrowIfCanceled(const function<bool()>& cancel)
+    {
+        if (cancel && cancel())
+            throw runtime_error("The operation was canceled.");
+    }
+
+    struct CachedIndex
+    {
+        ULONGLONG writeTime;
+        vector<CaseArchiveEntry> entries;
+    };
+    mutex indexCacheLock;
+    map<string, CachedIndex> indexCache; // keyed by the normalized archive path
+}
+
+sys::path CaseArchive::ArchiveFile(const sys::path& caseDir)
+{
+    return caseDir / sys::path(FileName);
+}
+
+bool CaseArchive::IsArchived(const sys::path& caseDir)
+{
+    return GetFileAttributesA(ArchiveFile(caseDir).string().c_str()) != INVALID_FILE_ATTRIBUTES;
+}
+
+void CaseArchive::Create(const sys::path& caseDir, const string& userName, const function<bool()>& cancel, const function<void(size_t, size_t)>& progress)
+{
+    // The case is locked for the whole time its files are packed, moved and removed so that no other
+    // workstation can open it and change its files in the meantime
+    HeldCaseLock heldLock(caseDir, userName, "archived");
+    if (IsArchived(caseDir))
+        throw runtime_error("The case is already archived.");
+
+    vector<CaseArchiveEntry> entries;
+    CollectEntries(caseDir, "", entries);
+    entries.erase(remove_if(entries.begin(), entries.end(), [] (const CaseArchiveEntry& entry) { return AreEqualIgnoreCase(entry.path, string("case.lock")); }), entries.end());
+    size_t totalFiles = count_if(entries.begin(), entries.end(), [] (const CaseArchiveEntry& entry) { return !entry.isDirectory; });
+    size_t filesCopied = 0;
+    if (progress)
+        progress(0, totalFiles);
+
+    vector<uint64_t> hashes(entries.size());     // of the data read from each original file
+    sys::path partialFile = ArchiveFile(caseDir).string() + ".partial";
+    try
+    {
+        FileHandle archive(CreateFileA(partialFile.string().c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+        if (!archive.IsValid())
+            throw runtime_error("Unable to create " + partialFile.string());
+
+        // The header is written last once the index location is known
+        vector<char> padding(PageSize, 0);
+        WriteAll(archive.Get(), padding.data(), PageSize, partialFile);
+        uint64_t offset = PageSize;
+        unique_ptr<char[]> buffer(new char[COPY_BUFFER_SIZE]);
+        for (size_t index = 0; index < entries.size(); ++index)
+        {
+            CaseArchiveEntry& entry = entries[index];
+            if (entry.isDirectory)
+                continue;
+            sys::path source = caseDir / sys::path(entry.path);
+            FileHandle input(CreateFileA(source.string().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+            if (!input.IsValid())
+                throw runtime_error("Unable to read " + source.string());
+            entry.offset = offset;
+            Xxh64 hash;
+            uint64_t remaining = entry.size;
+            while (remaining > 0)
+            {
+                ThrowIfCanceled(cancel);
+                DWORD chunk = static_cast<DWORD>(min<uint64_t>(remaining, COPY_BUFFER_SIZE));
+                ReadAll(input.Get(), buffer.get(), chunk, source);
+                hash.Update(buffer.get(), chunk);
+                WriteAll(archive.Get(), buffer.get(), chunk, partialFile);
+                remaining -= chunk;
+            }
+            hashes[index] = hash.Digest();
+            if (progress)
+                progress(++filesCopied, totalFiles);
+            offset += entry.size;
+            size_t pad = static_cast<size_t>((PageSize - offset % PageSize) % PageSize);
+            WriteAll(archive.Get(), padding.data(), pad, partialFile);
+            offset += pad;
+        }
+
+        ostringstream index;
+        for (auto& entry : entries)
+        {
+            if (entry.isDirectory)
+                index << "D\t" << entry.path << '\n';
+            else
+                index << "F\t" << entry.path << '\t' << entry.offset << '\t' << entry.size << '\t' << entry.writeTime << '\n';
+        }
+        string indexText = index.str();
+        WriteAll(archive.Get(), indexText.data(), indexText.size(), partialFile);
+
+        ArchiveHeader header = {};
+        copy(begin(ARCHIVE_SIGNATURE), end(ARCHIVE_SIGNATURE), header.signature);
+        header.version = ARCHIVE_VERSION;
+        header.pageSize = PageSize;
+        header.indexOffset = offset;
+        header.indexLength = indexText.size();
+        header.entryCount = entries.size();
+        Seek(archive.Get(), 0, partialFile);
+        WriteAll(archive.Get(), &header, sizeof(header), partialFile);
+        if (!FlushFileBuffers(archive.Get()))
+            throw runtime_error("Unable to write " + partialFile.string());
+    }
+    catch(const std::exception&)
+    {   // a partial archive left in the case directory would be packed by the next attempt
+        DeleteFileA(partialFile.string().c_str());
+        throw;
+    }
+
+    // Make sure every file can be read back from the archive as it was read from the original before anything is removed
+    string verifyError;
+    try
+    {
+        verifyError = VerifyArchive(partialFile, caseDir, entries, hashes);
+    }
+    catch(const std::exception& ex)
+    {
+        verifyError = ex.what();
+    }
+    if (!verifyError.empty())
+    {
+        DeleteFileA(partialFile.string().c_str());
+        throw runtime_error("The archive of " + caseDir.string() + " could not be verified: " + verifyError);
+    }
+    if (!MoveFileExA(partialFile.string().c_str(), ArchiveFile(caseDir).string().c_str(), 0))
+        throw runtime_error("Unable to create " + ArchiveFile(caseDir).string() + " (error " + to_string(GetLastError()) + ")");
+
+    // Remove the originals. The files are deleted several at a time, then the directories deepest first.
+    // The case is archived even if some of them cannot be removed; Extract skips the ones left behind.
+    FileOperationBatch deletes;
+    for (auto& entry : entries)
+    {
+        if (!entry.isDirectory)
+            deletes.AddDelete(caseDir / sys::path(entry.path));
+    }
+    size_t failures = deletes.Execute();
+    string firstFailure;
+    for (auto& operation : deletes.Operations())
+    {
+        if (operation.error != ERROR_SUCCESS)
+        {
+            firstFailure = operation.source.string() + " (error " + to_string(operation.error) + ")";
+            break;
+        }
+    }
+    for (auto entry = entries.rbegin(); entry != entries.rend(); ++entry)
+    {
+        sys::path directory = caseDir / sys::path(entry->path);
+        if (entry->isDirectory && !RemoveDirectoryA(directory.string().c_str()))
+        {
+            if (failures++ == 0)
+                firstFailure = directory.string() + " (error " + to_string(GetLastError()) + ")";
+        }
+    }
+    if (failures > 0)
+        throw runtime_error("The case was archived but " + to_string(failures) + " of its original files and folders could not be removed, starting with " + firstFailure + ".");
+}
+
+void CaseArchive::Extract(const sys::path& caseDir, const string& userName, const function<bool()>& cancel, const function<void(size_t, size_t)>& progress)
+{
+    // Restored files must not be changed by another workstation before the archive is removed
+    HeldCaseLock heldLock(caseDir, userName, "restored");
+    sys::path archiveFile = ArchiveFile(caseDir);
+    vector<CaseArchiveEntry> entries = ReadIndex(archiveFile);
+    size_t totalFiles = count_if(entries.begin(), entries.end(), [] (const CaseArchiveEntry& entry) { return !entry.isDirectory; });
+    size_t filesCopied = 0;
+    if (progress)
+        progress(0, totalFiles);
+    {
+        FileHandle archive(CreateFileA(archiveFile.string().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+        if (!archive.IsValid())
+            throw runtime_error("Unable to read " + archiveFile.string());
+        unique_ptr<char[]> buffer(new char[COPY_BUFFER_SIZE]);
+        for (auto& entry : entries)
+        {
+            sys::path target = caseDir / sys::path(entry.path);
+            if (entry.isDirectory)
+            {
+                sys::create_directories(target);
+                continue;
+            }
+            if (progress)
+                progress(filesCopied++, totalFiles);
+            // Restored files get the write time of the original, so a file that matches both was either
+            // left over from an archive whose originals were not all removed or restored by an earlier attempt
+            WIN32_FILE_ATTRIBUTE_DATA attributes;
+            if (GetFileAttributesExA(target.string().c_str(), GetFileExInfoStandard, &attributes) &&
+                ((static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow) == entry.size &&
+                ToTicks(attributes.ftLastWriteTime) == entry.writeTime)
+                continue;
+
+            FileHandle output(CreateFileA(target.string().c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL));
+            if (!output.IsValid())
+                throw runtime_error("Unable to create " + target.string());
+            Seek(archive.Get(), entry.offset, archiveFile);
+            uint64_t remaining = entry.size;
+            while (remaining > 0)
+            {
+                ThrowIfCanceled(cancel);
+                DWORD chunk = static_cast<DWORD>(min<uint64_t>(remaining, COPY_BUFFER_SIZE));
+                ReadAll(archive.Get(), buffer.get(), chunk, archiveFile);
+                WriteAll(output.Get(), buffer.get(), chunk, target);
+                remaining -= chunk;
+            }
+            FILETIME writeTime = ToFileTime(entry.writeTime);
+            if (!SetFileTime(output.Get(), NULL, NULL, &writeTime))
+                throw runtime_error("Unable to set the write time of " + target.string() + " (error " + to_string(GetLastError()) + ")");
+        }
+    }
+    if (progress)
+        progress(totalFiles, totalFiles);
+    if (!DeleteFileA(archiveFile.string().c_str()))
+        throw runtime_error("The case was restored but the archive " + archiveFile.string() + " could not be removed.");
+}
+
+vector<CaseArchiveEntry> CaseArchive::ReadIndex(const sys::path& archiveFile)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(archiveFile.string().c_str(), GetFileExInfoStandard, &attributes))
+        throw runtime_error("Unable to read " + archiveFile.string());
+    string key = NormalizedPathKey(archiveFile);
+    ULONGLONG writeTime = ToTicks(attributes.ftLastWriteTime);
+    {
+        lock_guard<mutex> guard(indexCacheLock);
+        auto cached = indexCache.find(key);
+        if (cached != indexCache.end() && cached->second.writeTime == writeTime)
+            return cached->second.entries;
+    }
+
+    FileHandle archive(CreateFileA(archiveFile.string().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL));
+    if (!archive.IsValid())
+        throw runtime_error("Unable to read " + archiveFile.string());
+    ArchiveHeader header;
+    ReadAll(archive.Get(), &header, sizeof(header), archiveFile);
+    if (!equal(begin(ARCHIVE_SIGNATURE), end(ARCHIVE_SIGNATURE), header.signature) || header.version != ARCHIVE_VERSION || header.indexLength > 0x7FFFFFFF)
+        throw runtime_error(archiveFile.string() + " is not a case archive or is damaged.");
+    string indexText(static_cast<size_t>(header.indexLength), '\0');
+    Seek(archive.Get(), header.indexOffset, archiveFile);
+    if (!indexText.empty())
+        ReadAll(archive.Get(), &indexText[0], indexText.size(), archiveFile);
+
+    string damaged = archiveFile.string() + " has a corrupt archive index.";
+    vector<CaseArchiveEntry> entries;
+    for (auto& line : Explode(indexText, '\n'))
+    {
+        vector<string> fields = Explode(line, '\t');
+        CaseArchiveEntry entry;
+        if (fields.size() == 2 && fields[0] == "D")
+            entry.isDirectory = true;
+        else if (fields.size() == 5 && fields[0] == "F")
+        {
+            try
+            {
+                entry.offset = stoull(fields[2]);
+                entry.size = stoull(fields[3]);
+                entry.writeTime = stoull(fields[4]);
+            }
+            catch(const std::logic_error&)
+            {   // invalid_argument or out_of_range
+                throw runtime_error(damaged);
+            }
+            if (entry.offset < PageSize || entry.offset + entry.size < entry.offset || entry.offset + entry.size > header.indexOffset)
+                throw runtime_error(damaged);
+        }
+        else
+            continue;
+        if (!IsRelativeCasePath(fields[1]))
+            throw runtime_error(damaged);
+        entry.path = fields[1];
+        entries.push_back(entry);
+    }
+    if (entries.size() != header.entryCount)
+        throw runtime_error(archiveFile.string() + " is damaged.");
+
+    lock_guard<mutex> guard(indexCacheLock);
+    CachedIndex& cached = indexCache[key];
+    cached.writeTime = writeTime;
+    cached.entries = entries;
+    return entries;
+}
+
+vector<string> CaseArchive::ListSpecimens(const sys::path& caseDir)
+{
+    vector<string> specimens;
+    if (IsArchived(caseDir))
+    {
+        for (auto& entry : ReadIndex(ArchiveFile(caseDir)))
+        {
+            if (entry.isDirectory && entry.path.find('\\') == string::npos)
+                specimens.push_back(entry.path);
+        }
+    }
+    else
+    {
+        specimens = DirectoryScanner::ListDirectories(caseDir);
+    }
+    sort(specimens.begin(), specimens.end());
+    return specimens;
+}
+
+vector<string> CaseArchive::ListImages(const sys::path& caseDir, const string& specimen)
+{
+    vector<string> images;
+    if (IsArchived(caseDir))
+    {
+        string prefix = NormalizedPathKey(specimen) + '\\';
+        for (auto& entry : ReadIndex(ArchiveFile(caseDir)))
+        {
+            if (entry.isDirectory || entry.path.size() <= prefix.size() || NormalizedPathKey(entry.path).compare(0, prefix.size(), prefix) != 0)
+                continue;
+            string name = entry.path.substr(prefix.size());
+            if (name.find('\\') == string::npos && IsCatalogImageFileName(name))
+                images.push_back(name);
+        }
+    }
+    else
+    {
+        DirectoryScanner scanner(caseDir / sys::path(specimen));
+        DirectoryEntry entry;
+        while (scanner.Next(entry))
+        {
+            if (!entry.isDirectory && IsCatalogImageFileName(entry.name))
+                images.push_back(entry.name);
+        }
+        scanner.ThrowIfFailed();
+    }
+    sort(images.begin(), images.end());
+    return images;
+}
+
+CaseArchiveJob& CaseArchiveJob::Instance()
+{
+    static CaseArchiveJob job;
+    return job;
+}
+
+bool CaseArchiveJob::Start(const sys::path& caseDir, const string& userName, bool extract)
+{
+    if (running.exchange(true))
+        return false;
+    {
+        lock_guard<mutex> guard(lock);
+        progress = CaseArchiveProgress();
+        progress.running = true;
+    }
+    sys::path directory = caseDir;
+    BackgroundWorker::LowPriority().Post([this, directory, userName, extract] ()
+    {
+        auto cancel = [] () { return BackgroundWorker::LowPriority().StopRequested(); };
+        auto update = [this] (size_t filesCopied, size_t totalFiles)
+        {
+            lock_guard<mutex> guard(lock);
+            progress.filesCopied = filesCopied;
+            progress.totalFiles = totalFiles;
+        };
+        string status;
+        try
+        {
+            if (extract)
+                CaseArchive::Extract(directory, userName, cancel, update);
+            else
+                CaseArchive::Create(directory, userName, cancel, update);
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugStringA(ex.what());
+            status = ex.what();
+        }
+        lock_guard<mutex> guard(lock);
+        progress.completed = status.empty();
+        progress.status = status;
+        progress.running = false;
+        running = false;
+    });
+    return true;
+}
+
+CaseArchiveProgress CaseArchiveJob::Progress() const
+{
+    lock_guard<mutex> guard(lock);
+    return progress;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <functional>
+#include <filesystem>
+
+/// Summary:
+///   A file or directory stored in a case archive.
+struct CaseArchiveEntry
+{
+    CaseArchiveEntry() : isDirectory(false), offset(0), size(0), writeTime(0) {}
+
+    std::string path;       // relative to the case directory (e.g. "2\7.jpg")
+    bool isDirectory;
+    uint64_t offset;        // of the file data within the archive. Always a multiple of CaseArchive::PageSize.
+    uint64_t size;
+    ULONGLONG writeTime;    // FILETIME ticks of the last write of the original file
+};
+
+/// Summary:
+///   Packs the contents of a closed case into a single archive file to reduce the number of files in a catalog.
+///   The archive replaces the contents of the case directory, which is kept so that the case still shows up in the catalog.
+///   File data is stored uncompressed at page aligned offsets so that it can be read or mapped directly.
+///   The index of the entries is stored at the end of the file and located through a fixed size header.
+///   The listing functions read the index of archived cases so callers do not need to know if a case is archived.
+class CaseArchive
+{
+public:
+    static const uint32_t PageSize = 4096;
+    static const std::string FileName;
+
+    /// Returns the path of the archive file of a case directory.
+    static std::tr2::sys::path ArchiveFile(const std::tr2::sys::path& caseDir);
+
+    /// Returns true if the case directory holds an archive.
+    static bool IsArchived(const std::tr2::sys::path& caseDir);
+
+    /// Summary:
+    ///   Packs the contents of a case directory into an archive and removes the originals.
+    ///   The case is locked through CaseLockManager until the originals have been removed.
+    /// Arguments:
+    ///   caseDir - The case directory
+    ///   userName - The name of the user to record in the case lock file
+    ///   cancel - Polled while files are copied. Create throws runtime_error when it returns true.
+    ///   progress - Called with the number of files copied and the number to copy
+    /// Throws:
+    ///   runtime_error if the case is locked, already archived, or could not be archived.
+    ///   The original files are only removed once the archive has been written and verified.
+    static void Create(const std::tr2::sys::path& caseDir, const std::string& userName,
+                       const std::function<bool()>& cancel = std::function<bool()>(),
+                       const std::function<void(size_t, size_t)>& progress = std::function<void(size_t, size_t)>());
+
+    /// Summary:
+    ///   Restores the contents of an archived case directory and removes the archive.
+    ///   The case is locked through CaseLockManager while its files are restored.
+    /// Arguments:
+    ///   As for Create
+    /// Throws:
+    ///   runtime_error if the case is locked or the contents could not be restored. The archive is kept in that case.
+    static void Extract(const std::tr2::sys::path& caseDir, const std::string& userName,
+                        const std::function<bool()>& cancel = std::function<bool()>(),
+                        const std::function<void(size_t, size_t)>& progress = std::function<void(size_t, size_t)>());
+
+    /// Summary:
+    ///   Reads the index of an archive. Indexes are cached until the archive file changes.
+    /// Throws:
+    ///   runtime_error if the archive is damaged
+    static std::vector<CaseArchiveEntry> ReadIndex(const std::tr2::sys::path& archiveFile);
+
+    /// Summary:
+    ///   Gets the sorted names of the specimen directories of a case, archived or not.
+    static std::vector<std::string> ListSpecimens(const std::tr2::sys::path& caseDir);
+
+    /// Summary:
+    ///   Gets the sorted names of the image files of a specimen, archived or not.
+    static std::vector<std::string> ListImages(const std::tr2::sys::path& caseDir, const std::string& specimen);
+};
+
+/// Summary:
+///   The state of the last case archive or restore.
+struct CaseArchiveProgress
+{
+    CaseArchiveProgress() : running(false), completed(false), filesCopied(0), totalFiles(0) {}
+
+    bool running;
+    bool completed;         // False while running and if the job failed
+    size_t filesCopied;
+    size_t totalFiles;
+    std::string status;     // Why the job failed. Empty while running or if it completed.
+};
+
+/// Summary:
+///   Archives or restores one case at a time with CaseArchive on the low priority background worker,
+///   so that copying a large case does not hold up the host.
+class CaseArchiveJob
+{
+    mutable std::mutex lock;
+    std::atomic<bool> running;
+    CaseArchiveProgress progress;
+
+    CaseArchiveJob() : running(false) {}
+    CaseArchiveJob(const CaseArchiveJob&);
+    CaseArchiveJob& operator = (const CaseArchiveJob&);
+
+    bool Start(const std::tr2::sys::path& caseDir, const std::string& userName, bool extract);
+
+public:
+    static CaseArchiveJob& Instance();
+
+    /// Summary:
+    ///   Starts archiving a case with CaseArchive::Create.
+    /// Returns:
+    ///   False if a job is already running
+    bool StartCreate(const std::tr2::sys::path& caseDir, const std::string& userName) { return Start(caseDir, userName, false); }
+
+    /// Summary:
+    ///   Starts restoring a case with CaseArchive::Extract.
+    /// Returns:
+    ///   False if a job is already running
+    bool StartExtract(const std::tr2::sys::path& caseDir, const std::string& userName) { return Start(caseDir, userName, true); }
+
+    bool IsRunning() const { return running; }
+
+    CaseArchiveProgress Progress() const;
+};
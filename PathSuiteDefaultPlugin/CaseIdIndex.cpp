@@ -0,0 +1,178 @@
+#include "stdafx.h"
+#include "CatalogFiles.h"
+#include "CaseIdIndex.h"
+#include "DirectoryScanner.h"
+#include "BackgroundWorker.h"
+
+using namespace std;
+using namespace std::tr2;
+
+namespace
+{
+    string ToLowerAscii(string text)
+    {
+        transform(text.begin(), text.end(), text.begin(), AsciiToLower<char>);
+        return text;
+    }
+
+    bool EntryLess(const pair<string, string>& a, const pair<string, string>& b)
+    {
+        return a.first < b.first;
+    }
+}
+
+CaseIdIndex& CaseIdIndex::Instance()
+{
+    static CaseIdIndex index;
+    return index;
+}
+
+vector<CaseIdIndex::entry_t> CaseIdIndex::ReadCaseIds(const sys::path& catalogPath)
+{
+    vector<entry_t> caseIds;
+    for (auto& caseId : DirectoryScanner::ListDirectories(catalogPath))
+    {
+        if (caseId != CONFIG_DIR_NAME)
+            caseIds.push_back(make_pair(ToLowerAscii(caseId), caseId));
+    }
+    sort(caseIds.begin(), caseIds.end(), EntryLess);
+    return caseIds;
+}
+
+// The lock must be held by the caller
+bool CaseIdIndex::IsCurrentCatalog(const sys::path& catalogPath) const
+{
+    return isBuilt && catalogKey == NormalizedPathKey(catalogPath);
+}
+
+// The lock must be held by the caller
+void CaseIdIndex::Insert(const string& caseId)
+{
+    entry_t entry(ToLowerAscii(caseId), caseId);
+    auto position = lower_bound(entries.begin(), entries.end(), entry, EntryLess);
+    if (position == entries.end() || position->first != entry.first)
+        entries.insert(position, entry);
+    ++generation;
+}
+
+// The lock must be held by the caller
+void CaseIdIndex::Erase(const string& caseId)
+{
+    entry_t entry(ToLowerAscii(caseId), caseId);
+    auto position = lower_bound(entries.begin(), entries.end(), entry, EntryLess);
+    if (position != entries.end() && position->first == entry.first)
+        entries.erase(position);
+    ++generation;
+}
+
+void CaseIdIndex::ScheduleBuild(const sys::path& catalogPath)
+{
+    lock_guard<mutex> guard(lock);
+    pendingCatalog = catalogPath;
+    buildRequested = true;
+    if (buildPending)
+        return;
+    buildPending = true;
+    BackgroundWorker::LowPriority().Post([this] () { RunBuilds(); });
+}
+
+// Runs on the background worker until the last catalog requested has been read
+void CaseIdIndex::RunBuilds()
+{
+    for (;;)
+    {
+        sys::path catalog;
+        unsigned startGeneration;
+        {
+            lock_guard<mutex> guard(lock);
+            if (!buildRequested)
+            {
+                buildPending = false;
+                return;
+            }
+            catalog = pendingCatalog;
+            buildRequested = false;
+            startGeneration = generation;
+        }
+        vector<entry_t> caseIds;
+        bool success = false;
+        try
+        {
+            caseIds = ReadCaseIds(catalog);
+            success = true;
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugStringA(ex.what());
+        }
+        lock_guard<mutex> guard(lock);
+        if (success && startGeneration == generation)
+        {
+            entries.swap(caseIds);
+            catalogKey = NormalizedPathKey(catalog);
+            isBuilt = true;
+        }
+        else if (success && !buildRequested && catalogKey == NormalizedPathKey(catalog))
+        {   // Cases were added or removed while the catalog was read, so the list read may be missing them
+            pendingCatalog = catalog;
+            buildRequested = true;
+        }
+    }
+}
+
+vector<string> CaseIdIndex::FindByPrefix(const sys::path& catalogPath, const string& prefix, size_t maxResults, bool& ready)
+{
+    unique_lock<mutex> guard(lock);
+    ready = IsCurrentCatalog(catalogPath);
+    if (!ready)
+    {   // Calls made while the catalog is read do not queue it again
+        bool queued = buildPending && NormalizedPathKey(pendingCatalog) == NormalizedPathKey(catalogPath);
+        guard.unlock();
+        if (!queued)
+            ScheduleBuild(catalogPath);
+        return vector<string>();
+    }
+
+    vector<string> matches;
+    entry_t key(ToLowerAscii(prefix), string());
+    for (auto item = lower_bound(entries.begin(), entries.end(), key, EntryLess);
+         item != entries.end() && matches.size() < maxResults && item->first.compare(0, key.first.size(), key.first) == 0;
+         ++item)
+    {
+        matches.push_back(item->second);
+    }
+    return matches;
+}
+
+void CaseIdIndex::Reset(const sys::path& catalogPath)
+{
+    lock_guard<mutex> guard(lock);
+    entries.clear();
+    catalogKey = NormalizedPathKey(catalogPath);
+    isBuilt = true;
+    ++generation;
+}
+
+void CaseIdIndex::OnCaseAdded(const sys::path& catalogPath, const string& caseId)
+{
+    lock_guard<mutex> guard(lock);
+    if (IsCurrentCatalog(catalogPath))
+        Insert(caseId);
+}
+
+void CaseIdIndex::OnCaseRemoved(const sys::path& catalogPath, const string& caseId)
+{
+    lock_guard<mutex> guard(lock);
+    if (IsCurrentCatalog(catalogPath))
+        Erase(caseId);
+}
+
+void CaseIdIndex::OnCaseRenamed(const sys::path& catalogPath, const string& oldCaseId, const string& newCaseId)
+{
+    lock_guard<mutex> guard(lock);
+    if (IsCurrentCatalog(catalogPath))
+    {
+        Erase(oldCaseId);
+        Insert(newCaseId);
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <utility>
+#include <filesystem>
+
+/// Summary:
+///   Sorted in memory list of the case IDs in the current catalog for fast prefix (type ahead) searches.
+///   The list is built from the catalog root directory and kept up to date by the plug-in actions that
+///   create, rename or remove cases. Searches are case insensitive.
+class CaseIdIndex
+{
+    typedef std::pair<std::string, std::string> entry_t; // lower case key, case ID as found on disk
+
+    std::mutex lock;
+    std::string catalogKey;         // normalized path of the catalog the index was built from
+    std::vector<entry_t> entries;   // sorted by key
+    unsigned generation;            // incremented on every change so that a stale background build can be discarded
+    bool isBuilt;
+    bool buildPending;              // a build task is queued or running
+    bool buildRequested;            // the build task must read pendingCatalog when it finishes the current one
+    std::tr2::sys::path pendingCatalog;
+
+    CaseIdIndex() : generation(0), isBuilt(false), buildPending(false), buildRequested(false) {}
+    CaseIdIndex(const CaseIdIndex&);
+    CaseIdIndex& operator = (const CaseIdIndex&);
+
+    static std::vector<entry_t> ReadCaseIds(const std::tr2::sys::path& catalogPath);
+    bool IsCurrentCatalog(const std::tr2::sys::path& catalogPath) const;
+    void Insert(const std::string& caseId);
+    void Erase(const std::string& caseId);
+    void RunBuilds();
+
+public:
+    static CaseIdIndex& Instance();
+
+    /// Summary:
+    ///   Queues a rebuild of the index for the catalog on the low priority background worker.
+    ///   If a build of another catalog is still queued, the build is for this catalog instead.
+    ///   If a build is running, this catalog is built once it finishes.
+    void ScheduleBuild(const std::tr2::sys::path& catalogPath);
+
+    /// Summary:
+    ///   Finds the case IDs that start with a prefix. If the index has not been built for this catalog yet,
+    ///   a build is queued and nothing is found. The catalog is never read on the calling thread.
+    /// Arguments:
+    ///   catalogPath - The path to the root of the catalog
+    ///   prefix - The text to match to the start of the case IDs
+    ///   maxResults - The maximum number of case IDs to return
+    ///   ready - Set to false if the index of the catalog is still being built
+    /// Returns:
+    ///   The matching case IDs in sorted order
+    std::vector<std::string> FindByPrefix(const std::tr2::sys::path& catalogPath, const std::string& prefix, size_t maxResults, bool& ready);
+
+    /// Summary:
+    ///   Replaces the index with an empty index for a newly created catalog.
+    void Reset(const std::tr2::sys::path& catalogPath);
+
+    // Updates the index after the plug-in changed the cases in a catalog.
+    // Changes to a catalog other than the one that is indexed are ignored.
+    void OnCaseAdded(const std::tr2::sys::path& catalogPath, const std::string& caseId);
+    void OnCaseRemoved(const std::tr2::sys::path& catalogPath, const std::string& caseId);
+    void OnCaseRenamed(const std::tr2::sys::path& catalogPath, const std::string& oldCaseId, const std::string& newCaseId);
+};
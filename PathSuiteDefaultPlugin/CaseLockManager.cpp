@@ -0,0 +1,304 @@
+#include "stdafx.h"
+#include <ctime>
+#include <ppl.h>
+#include <boost/uuid/uuid.hpp>
+#include <boost/uuid/random_generator.hpp>
+#include <boost/uuid/uuid_io.hpp>
+#include "CatalogFiles.h"
+#include "DirectoryScanner.h"
+#include "CaseLockManager.h"
+
+using namespace std;
+using namespace std::tr2;
+
+namespace
+{
+    ULONGLONG ToTicks(const FILETIME& ft)
+    {
+        return (static_cast<ULONGLONG>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    }
+
+    string LocalHostName()
+    {
+        char name[MAX_PATH] = {0};
+        DWORD length = MAX_PATH;
+        return GetComputerNameA(name, &length) ? string(name) : string("<unknown>");
+    }
+
+    // Gets the value of a "Key: value" line from the lock file text
+    string LockField(const string& text, const string& key)
+    {
+        string prefix = key + ": ";
+        for (auto& line : Explode(text, '\n'))
+        {
+            if (line.compare(0, prefix.size(), prefix) == 0)
+                return TrimCopy(line.substr(prefix.size()));
+        }
+        return string();
+    }
+
+    bool WriteNewLockFile(const sys::path& lockFile, const string& contents)
+    {
+        HANDLE file = CreateFileA(lockFile.string().c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_WRITE_THROUGH, NULL);
+        if (INVALID_HANDLE_VALUE == file)
+        {
+            DWORD error = GetLastError();
+            if (ERROR_FILE_EXISTS == error || ERROR_ALREADY_EXISTS == error)
+                return false;
+            throw runtime_error("Unable to create the case lock file " + lockFile.string() + " (error " + to_string(error) + ")");
+        }
+        DWORD written = 0;
+        BOOL success = WriteFile(file, contents.data(), static_cast<DWORD>(contents.size()), &written, NULL);
+        CloseHandle(file);
+        if (!success)
+            throw runtime_error("Unable to write the case lock file " + lockFile.string());
+        return true;
+    }
+
+    bool RenewLockFile(const sys::path& lockFile)
+    {
+        HANDLE file = CreateFileA(lockFile.string().c_str(), FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (INVALID_HANDLE_VALUE == file)
+            return false;
+        FILETIME now;
+        GetSystemTimeAsFileTime(&now);
+        BOOL success = SetFileTime(file, NULL, NULL, &now);
+        CloseHandle(file);
+        return success != FALSE;
+    }
+}
+
+CaseLockManager& CaseLockManager::Instance()
+{
+    static CaseLockManager manager;
+    return manager;
+}
+
+CaseLockManager::~CaseLockManager()
+{
+    ReleaseAll();
+}
+
+bool CaseLockManager::ReadLock(const sys::path& lockFile, CaseLockInfo& info)
+{
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(lockFile.string().c_str(), GetFileExInfoStandard, &attributes))
+        return false;
+    try
+    {
+        info.text = ReadFileToString(lockFile);
+    }
+    catch(const std::exception&)
+    {   // removed or still being created by another workstation
+        if (!sys::exists(lockFile))
+            return false;
+    }
+    info.userName = LockField(info.text, "User");
+    info.hostName = LockField(info.text, "Host");
+    info.id = LockField(info.text, "Id");
+
+    // The write time was set by the clock of the owner (or the file server), which may not agree with ours
+    info.isStale = Instance().UnchangedSeconds(lockFile, info.id, ToTicks(attributes.ftLastWriteTime)) > LeaseSeconds;
+    return true;
+}
+
+ULONGLONG CaseLockManager::UnchangedSeconds(const sys::path& lockFile, const string& id, ULONGLONG writeTime)
+{
+    ULONGLONG now = GetTickCount64();
+    lock_guard<mutex> guard(observationLock);
+    if (now - lastPruned > LeaseSeconds * 1000ULL)
+    {   // forget the lock files that are no longer being read
+        for (auto item = observations.begin(); item != observations.end(); )
+        {
+            if (now - item->second.lastSeen > 2 * LeaseSeconds * 1000ULL)
+                item = observations.erase(item);
+            else
+                ++item;
+        }
+        lastPruned = now;
+    }
+    Observation& observed = observations[NormalizedPathKey(lockFile)];
+    if (observed.firstSeen == 0 || observed.id != id || observed.writeTime != writeTime)
+    {
+        observed.id = id;
+        observed.writeTime = writeTime;
+        observed.firstSeen = now;
+    }
+    observed.lastSeen = now;
+    return (now - observed.firstSeen) / 1000;
+}
+
+// Removes an expired lock file. Another workstation may be doing the same thing at the same time
+// so the lock file is first renamed to a name unique to this attempt. Only one workstation can win the rename.
+// If the renamed file turns out not to be the expired lock (it was replaced in the meantime) it is put back.
+bool CaseLockManager::BreakStaleLock(const sys::path& lockFile, const string& staleId)
+{
+    sys::path claimedFile = lockFile;
+    claimedFile.replace_extension(".stale-" + to_string(boost::uuids::random_generator()()));
+    if (!MoveFileExA(lockFile.string().c_str(), claimedFile.string().c_str(), 0))
+        return false;
+    CaseLockInfo claimed;
+    if (ReadLock(claimedFile, claimed) && claimed.id != staleId)
+    {
+        MoveFileExA(claimedFile.string().c_str(), lockFile.string().c_str(), 0);
+        return false;
+    }
+    DeleteFileA(claimedFile.string().c_str());
+    return true;
+}
+
+// A claimed lock file is normally removed or put back within moments of the rename. One that is left behind
+// by a workstation that stopped in between is removed once its lease has expired, like any other stale lock.
+void CaseLockManager::RemoveOrphanedClaims(const sys::path& lockFile)
+{
+    string prefix = lockFile.stem() + ".stale-";
+    DirectoryScanner scanner(lockFile.parent_path());
+    DirectoryEntry entry;
+    while (scanner.Next(entry))
+    {
+        if (entry.isDirectory || entry.name.compare(0, prefix.size(), prefix) != 0)
+            continue;
+        sys::path claimedFile = lockFile.parent_path() / sys::path(entry.name);
+        CaseLockInfo claimed;
+        if (ReadLock(claimedFile, claimed) && claimed.isStale)
+            DeleteFileA(claimedFile.string().c_str());
+    }
+}
+
+bool CaseLockManager::Acquire(const sys::path& lockFile, const string& userName, string& currentHolder)
+{
+    string key = NormalizedPathKey(lockFile);
+    {
+        lock_guard<mutex> guard(lock);
+        auto owned = ownedLocks.find(key);
+        if (owned != ownedLocks.end())
+        {
+            CaseLockInfo existing;
+            if (ReadLock(lockFile, existing) && existing.id == owned->second.id)
+            {
+                RenewLockFile(lockFile);
+                return true;
+            }
+            ownedLocks.erase(owned); // the lease expired and was taken over by someone else
+        }
+    }
+
+    RemoveOrphanedClaims(lockFile);
+    for (int attempt = 0; attempt < 2; ++attempt)
+    {
+        string id = to_string(boost::uuids::random_generator()());
+        time_t lockedOn = time(nullptr);
+        ostringstream contents;
+        contents << "User: " << userName << endl
+                 << "Host: " << LocalHostName() << endl
+                 << "Locked On: " << ctime(&lockedOn)
+                 << "Id: " << id;
+        if (WriteNewLockFile(lockFile, contents.str()))
+        {
+            OwnedLock owned;
+            owned.lockFile = lockFile;
+            owned.id = id;
+            lock_guard<mutex> guard(lock);
+            ownedLocks[key] = owned;
+            StartHeartbeat();
+            return true;
+        }
+
+        CaseLockInfo existing;
+        if (!ReadLock(lockFile, existing))
+            continue; // released in the meantime
+        if (!existing.isStale || !BreakStaleLock(lockFile, existing.id))
+        {
+            currentHolder = existing.text;
+            return false;
+        }
+    }
+    CaseLockInfo existing;
+    ReadLock(lockFile, existing);
+    currentHolder = existing.text;
+    return false;
+}
+
+void CaseLockManager::Release(const sys::path& lockFile)
+{
+    OwnedLock owned;
+    {
+        lock_guard<mutex> guard(lock);
+        auto item = ownedLocks.find(NormalizedPathKey(lockFile));
+        if (item == ownedLocks.end())
+            return;
+        owned = item->second;
+        ownedLocks.erase(item);
+    }
+    CaseLockInfo existing;
+    if (ReadLock(owned.lockFile, existing) && existing.id == owned.id)
+        sys::remove(owned.lockFile);
+}
+
+void CaseLockManager::ReleaseAll()
+{
+    vector<sys::path> lockFiles;
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+        heartbeatWake.notify_all();
+        for (auto& item : ownedLocks)
+            lockFiles.push_back(item.second.lockFile);
+    }
+    if (heartbeat.joinable())
+        heartbeat.join();
+    for (auto& lockFile : lockFiles)
+        Release(lockFile);
+    lock_guard<mutex> guard(lock);
+    stopping = false;
+}
+
+bool CaseLockManager::IsOwned(const sys::path& lockFile)
+{
+    lock_guard<mutex> guard(lock);
+    return ownedLocks.find(NormalizedPathKey(lockFile)) != ownedLocks.end();
+}
+
+// The lock must be held by the caller
+void CaseLockManager::StartHeartbeat()
+{
+    if (!heartbeat.joinable() && !stopping)
+        heartbeat = thread(&CaseLockManager::RunHeartbeat, this);
+}
+
+void CaseLockManager::RunHeartbeat()
+{
+    unique_lock<mutex> guard(lock);
+    while (!stopping)
+    {
+        heartbeatWake.wait_for(guard, chrono::seconds(HeartbeatSeconds));
+        if (stopping)
+            break;
+        vector<pair<string, OwnedLock>> toRenew(ownedLocks.begin(), ownedLocks.end());
+        guard.unlock();
+
+        vector<string> lost;
+        for (auto& item : toRenew)
+        {
+            CaseLockInfo existing;
+            if (!ReadLock(item.second.lockFile, existing) || existing.id != item.second.id || !RenewLockFile(item.second.lockFile))
+                lost.push_back(item.first);
+        }
+
+        guard.lock();
+        for (auto& key : lost)
+            ownedLocks.erase(key);
+    }
+}
+
+vector<CaseLockInfo> CaseLockManager::QueryLocks(const vector<sys::path>& lockFiles)
+{
+    vector<CaseLockInfo> locks(lockFiles.size());
+    Instance(); // create the instance before ReadLock is called from several threads
+    concurrency::parallel_for(size_t(0), lockFiles.size(), [&] (size_t index)
+    {
+        if (!ReadLock(lockFiles[index], locks[index]) || locks[index].isStale)
+            locks[index] = CaseLockInfo();
+    });
+    return locks;
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <thread>
+#include <unordered_map>
+#include <condition_variable>
+#include <filesystem>
+
+/// Summary:
+///   The contents of a case lock file.
+struct CaseLockInfo
+{
+    CaseLockInfo() : isStale(false) {}
+
+    std::string text;     // The full text of the lock file, suitable for display to the user
+    std::string userName;
+    std::string hostName;
+    std::string id;       // Unique id of the lock. Used to verify ownership before renewing or removing a lock.
+    bool isStale;         // True if the lease of the lock has expired
+};
+
+/// Summary:
+///   Manages the case lock files that prevent two workstations from editing a case at the same time.
+///   Locks are leases. A lock file is created atomically and its last write time is renewed by a heartbeat
+///   thread while this workstation owns it. A lock that has not been renewed within the lease period
+///   belongs to a workstation that stopped unexpectedly and may be taken over by another workstation.
+///   The clocks of the workstations are not compared. The write time of a lock file is only used to tell
+///   that it was renewed, and the lease is timed by this workstation's own tick count from the moment it
+///   first saw the current renewal. A lock left behind by a crash therefore becomes stale one lease period
+///   after this workstation first reads it, however old the lock file is.
+class CaseLockManager
+{
+public:
+    static const unsigned LeaseSeconds = 5 * 60;
+    static const unsigned HeartbeatSeconds = 60;
+
+private:
+    struct OwnedLock
+    {
+        std::tr2::sys::path lockFile;
+        std::string id;
+    };
+
+    // The last renewal of a lock file seen by this workstation
+    struct Observation
+    {
+        Observation() : writeTime(0), firstSeen(0), lastSeen(0) {}
+
+        std::string id;
+        ULONGLONG writeTime;    // as recorded by the file system
+        ULONGLONG firstSeen;    // GetTickCount64 when this renewal was first read
+        ULONGLONG lastSeen;
+    };
+
+    std::mutex lock;
+    std::unordered_map<std::string, OwnedLock> ownedLocks; // keyed by the normalized lock file path
+    std::mutex observationLock;
+    std::unordered_map<std::string, Observation> observations; // keyed by the normalized lock file path
+    ULONGLONG lastPruned;
+    std::thread heartbeat;
+    std::condition_variable heartbeatWake;
+    bool stopping;
+
+    CaseLockManager() : lastPruned(0), stopping(false) {}
+    CaseLockManager(const CaseLockManager&);
+    CaseLockManager& operator = (const CaseLockManager&);
+
+    void StartHeartbeat();
+    void RunHeartbeat();
+    bool BreakStaleLock(const std::tr2::sys::path& lockFile, const std::string& staleId);
+    void RemoveOrphanedClaims(const std::tr2::sys::path& lockFile);
+    ULONGLONG UnchangedSeconds(const std::tr2::sys::path& lockFile, const std::string& id, ULONGLONG writeTime);
+
+public:
+    ~CaseLockManager();
+
+    static CaseLockManager& Instance();
+
+    /// Summary:
+    ///   Reads a lock file and determines if its lease has expired, that is if this workstation has seen
+    ///   the same renewal of the lock for longer than the lease period.
+    /// Returns:
+    ///   False if there is no lock file
+    static bool ReadLock(const std::tr2::sys::path& lockFile, CaseLockInfo& info);
+
+    /// Summary:
+    ///   Attempts to lock a case for this workstation.
+    /// Arguments:
+    ///   lockFile - The path of the lock file within the case directory
+    ///   userName - The name of the user to record in the lock file
+    ///   currentHolder - If the case is locked by another workstation this is set to the text of its lock file.
+    /// Returns:
+    ///   True if the lock is owned by this workstation. This includes locks that were already owned.
+    /// Throws:
+    ///   runtime_error if the lock file could not be created for a reason other than an existing lock
+    bool Acquire(const std::tr2::sys::path& lockFile, const std::string& userName, std::string& currentHolder);
+
+    /// Summary:
+    ///   Removes a lock owned by this workstation. Locks owned by another workstation are left in place.
+    void Release(const std::tr2::sys::path& lockFile);
+
+    /// Summary:
+    ///   Removes all locks owned by this workstation and stops the heartbeat.
+    void ReleaseAll();
+
+    /// Returns true if the lock file is owned by this workstation.
+    bool IsOwned(const std::tr2::sys::path& lockFile);
+
+    /// Summary:
+    ///   Reads many lock files in parallel.
+    /// Returns:
+    ///   The lock holder for each lock file in the same order as the input.
+    ///   The holder is empty if the case is not locked or its lease has expired.
+    static std::vector<CaseLockInfo> QueryLocks(const std::vector<std::tr2::sys::path>& lockFiles);
+};
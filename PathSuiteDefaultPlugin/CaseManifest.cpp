@@ -0,0 +1,429 @@
+#include "stdafx.h"
+#include <ppl.h>
+#include <set>
+#include "CatalogFiles.h"
+#include "CaseManifest.h"
+#include "CaseArchive.h"
+#include "DirectoryScanner.h"
+#include "BackgroundWorker.h"
+#include "Xxh64.h"
+
+using namespace std;
+using namespace std::tr2;
+
+namespace
+{
+    const string MANIFEST_DIR_NAME = "manifests";
+    const char MANIFEST_FILE_HEADER[] = "PSMAN 1";
+    const DWORD HASH_READ_SIZE = 1024 * 1024;
+
+    ULONGLONG ToTicks(const FILETIME& ft)
+    {
+        return (static_cast<ULONGLONG>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    }
+
+    struct CaseImage
+    {
+        string relativePath;
+        sys::path file;         // The image, or the archive that holds it
+        uint64_t archiveOffset; // Of the image data within the archive
+        bool archived;
+        ManifestEntry entry;
+        bool readable;
+    };
+
+    // Lists the images of a case with their size and write time. The images of an archived case
+    // are listed from the archive index with the size and write time of the original files.
+    vector<CaseImage> ListCaseImages(const sys::path& caseDir)
+    {
+        vector<CaseImage> images;
+        if (CaseArchive::IsArchived(caseDir))
+        {
+            sys::path archiveFile = CaseArchive::ArchiveFile(caseDir);
+            for (auto& archived : CaseArchive::ReadIndex(archiveFile))
+            {
+                size_t separator = archived.path.find('\\');
+                if (archived.isDirectory || separator == string::npos || archived.path.find('\\', separator + 1) != string::npos ||
+                    !IsCatalogImageFileName(archived.path.substr(separator + 1)))
+                    continue;
+                CaseImage image;
+                image.relativePath = archived.path;
+                image.file = archiveFile;
+                image.archiveOffset = archived.offset;
+                image.archived = true;
+                image.entry.size = archived.size;
+                image.entry.writeTime = archived.writeTime;
+                image.readable = true;
+                images.push_back(image);
+            }
+            return images;
+        }
+        for (auto& specimen : DirectoryScanner::ListDirectories(caseDir))
+        {
+            sys::path specimenDir = caseDir / sys::path(specimen);
+            DirectoryScanner scanner(specimenDir);
+            DirectoryEntry found;
+            while (scanner.Next(found))
+            {
+                if (found.isDirectory || !IsCatalogImageFileName(found.name))
+                    continue;
+                CaseImage image;
+                image.relativePath = specimen + '\\' + found.name;
+                image.file = specimenDir / sys::path(found.name);
+                image.archiveOffset = 0;
+                image.archived = false;
+                image.entry.size = found.size;
+                image.entry.writeTime = ToTicks(found.writeTime);
+                image.readable = true;
+                images.push_back(image);
+            }
+            scanner.ThrowIfFailed();
+        }
+        return images;
+    }
+}
+
+sys::path CaseManifest::ManifestFile(const sys::path& catalog, const string& caseId)
+{
+    return CatalogConfigDirectory(catalog) / sys::path(MANIFEST_DIR_NAME) / sys::path(caseId + ".manifest");
+}
+
+CaseManifest CaseManifest::Load(const sys::path& manifestFile)
+{
+    CaseManifest manifest;
+    ifstream file(manifestFile.string(), ios::in | ios::binary);
+    string line;
+    if (!getline(file, line) || TrimRightCopy(line) != MANIFEST_FILE_HEADER)
+        return manifest;
+    while (getline(file, line))
+    {
+        vector<string> fields = Explode(TrimRightCopy(line), '\t');
+        if (fields.size() != 4)
+            continue;
+        try
+        {
+            ManifestEntry entry;
+            entry.size = stoull(fields[1]);
+            entry.writeTime = stoull(fields[2]);
+            entry.hash = stoull(fields[3], nullptr, 16);
+            manifest.entries[fields[0]] = entry;
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugStringA(ex.what());
+        }
+    }
+    return manifest;
+}
+
+void CaseManifest::Save(const sys::path& manifestFile) const
+{
+    sys::create_directories(manifestFile.parent_path());
+    sys::path tempFile = manifestFile;
+    tempFile.replace_extension(".tmp");
+    {
+        ofstream file(tempFile.string(), ios::out | ios::trunc | ios::binary);
+        file.exceptions(ofstream::failbit | ofstream::badbit);
+        file << MANIFEST_FILE_HEADER << '\n';
+        char hash[17];
+        for (auto& item : entries)
+        {
+            sprintf_s(hash, "%016llx", static_cast<unsigned long long>(item.second.hash));
+            file << item.first << '\t' << item.second.size << '\t' << item.second.writeTime << '\t' << hash << '\n';
+        }
+    }
+    if (!MoveFileExA(tempFile.string().c_str(), manifestFile.string().c_str(), MOVEFILE_REPLACE_EXISTING))
+        throw runtime_error("Unable to replace the manifest " + manifestFile.string());
+}
+
+bool CaseManifest::HashFile(const sys::path& file, uint64_t& hash)
+{
+    HANDLE handle = CreateFileA(file.string().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+    unique_ptr<char[]> buffer(new char[HASH_READ_SIZE]);
+    Xxh64 state;
+    DWORD bytesRead = 0;
+    bool success;
+    while ((success = ReadFile(handle, buffer.get(), HASH_READ_SIZE, &bytesRead, NULL) != FALSE) && bytesRead > 0)
+        state.Update(buffer.get(), bytesRead);
+    CloseHandle(handle);
+    hash = state.Digest();
+    return success;
+}
+
+bool CaseManifest::HashFileRange(const sys::path& file, uint64_t offset, uint64_t size, uint64_t& hash)
+{
+    HANDLE handle = CreateFileA(file.string().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+    unique_ptr<char[]> buffer(new char[HASH_READ_SIZE]);
+    Xxh64 state;
+    LARGE_INTEGER position;
+    position.QuadPart = offset;
+    bool success = SetFilePointerEx(handle, position, NULL, FILE_BEGIN) != FALSE;
+    for (uint64_t remaining = size; success && remaining > 0; )
+    {
+        DWORD bytesRead = 0;
+        DWORD chunk = static_cast<DWORD>(min<uint64_t>(remaining, HASH_READ_SIZE));
+        success = ReadFile(handle, buffer.get(), chunk, &bytesRead, NULL) && bytesRead == chunk;
+        state.Update(buffer.get(), bytesRead);
+        remaining -= bytesRead;
+    }
+    CloseHandle(handle);
+    hash = state.Digest();
+    return success;
+}
+
+CaseManifest CaseManifest::Scan(const sys::path& catalog, const string& caseId, const CaseManifest& previous, bool rehashAll,
+                               const function<bool()>& cancel, const function<void(size_t, size_t)>& progress)
+{
+    vector<CaseImage> images = ListCaseImages(catalog / sys::path(caseId));
+    vector<size_t> toHash;
+    for (size_t i = 0; i < images.size(); ++i)
+    {
+        auto recorded = previous.entries.find(images[i].relativePath);
+        if (images[i].readable && !rehashAll && recorded != previous.entries.end() &&
+            recorded->second.size == images[i].entry.size && recorded->second.writeTime == images[i].entry.writeTime)
+            images[i].entry.hash = recorded->second.hash;
+        else if (images[i].readable)
+            toHash.push_back(i);
+    }
+
+    // Reading several files at once keeps the disk (or network share) busy while other files are being hashed
+    atomic<size_t> hashed(0);
+    if (progress)
+        progress(0, toHash.size());
+    concurrency::parallel_for(size_t(0), toHash.size(), [&] (size_t index)
+    {
+        CaseImage& image = images[toHash[index]];
+        if (cancel && cancel())
+            return;
+        image.readable = image.archived ? HashFileRange(image.file, image.archiveOffset, image.entry.size, image.entry.hash)
+                                        : HashFile(image.file, image.entry.hash);
+        if (progress)
+            progress(++hashed, toHash.size());
+    });
+    if (cancel && cancel())
+        throw runtime_error("The case scan was canceled.");
+
+    CaseManifest manifest;
+    for (auto& image : images)
+    {
+        if (image.readable)
+            manifest.entries[image.relativePath] = image.entry;
+    }
+    return manifest;
+}
+
+CaseManifest CaseManifest::Update(const sys::path& catalog, const string& caseId, const function<bool()>& cancel)
+{
+    sys::path manifestFile = ManifestFile(catalog, caseId);
+    CaseManifest previous = Load(manifestFile);
+    CaseManifest current = Scan(catalog, caseId, previous, false, cancel);
+    if (current.entries.size() != previous.entries.size() ||
+        !equal(current.entries.begin(), current.entries.end(), previous.entries.begin(),
+               [] (const pair<const string, ManifestEntry>& a, const pair<const string, ManifestEntry>& b)
+               {
+                   return a.first == b.first && a.second.hash == b.second.hash && a.second.size == b.second.size && a.second.writeTime == b.second.writeTime;
+               }))
+        current.Save(manifestFile);
+    return current;
+}
+
+void CaseManifest::OnCaseRenamed(const sys::path& catalog, const string& oldCaseId, const string& newCaseId)
+{
+    sys::path oldFile = ManifestFile(catalog, oldCaseId);
+    if (sys::exists(oldFile))
+        MoveFileExA(oldFile.string().c_str(), ManifestFile(catalog, newCaseId).string().c_str(), MOVEFILE_REPLACE_EXISTING);
+}
+
+size_t VerifyCaseImages(const sys::path& catalog, const string& caseId, vector<string>& problems,
+                        const function<bool()>& cancel, const function<void(size_t, size_t)>& progress)
+{
+    sys::path manifestFile = CaseManifest::ManifestFile(catalog, caseId);
+    CaseManifest recorded = CaseManifest::Load(manifestFile);
+    CaseManifest current = CaseManifest::Scan(catalog, caseId, recorded, true, cancel, progress);
+    size_t checked = current.entries.size();
+
+    // The images of an archived case exist if the archive holds them
+    sys::path caseDir = catalog / sys::path(caseId);
+    set<string> archivedPaths;
+    bool archived = CaseArchive::IsArchived(caseDir);
+    if (archived)
+    {
+        for (auto& entry : CaseArchive::ReadIndex(CaseArchive::ArchiveFile(caseDir)))
+            archivedPaths.insert(entry.path);
+    }
+
+    for (auto& item : recorded.entries)
+    {
+        auto found = current.entries.find(item.first);
+        if (found == current.entries.end())
+        {
+            bool exists = archived ? archivedPaths.count(item.first) > 0 : sys::exists(caseDir / sys::path(item.first));
+            problems.push_back((exists ? "unreadable\t" : "missing\t") + item.first);
+            if (exists)
+                current.entries[item.first] = item.second;
+        }
+        else if (found->second.size == item.second.size && found->second.writeTime == item.second.writeTime)
+        {
+            if (found->second.hash != item.second.hash)
+            {
+                problems.push_back("corrupt\t" + item.first);
+                found->second.hash = item.second.hash;
+            }
+        }
+        else
+            problems.push_back("changed\t" + item.first);
+    }
+    for (auto& item : current.entries)
+    {
+        if (recorded.entries.find(item.first) == recorded.entries.end())
+            problems.push_back("new\t" + item.first);
+    }
+    current.Save(manifestFile);
+    return checked;
+}
+
+CaseVerification& CaseVerification::Instance()
+{
+    static CaseVerification verification;
+    return verification;
+}
+
+bool CaseVerification::Start(const sys::path& catalog, const string& caseId)
+{
+    if (running.exchange(true))
+        return false;
+    {
+        lock_guard<mutex> guard(lock);
+        progress = CaseVerificationProgress();
+        progress.running = true;
+        progress.caseId = caseId;
+    }
+    sys::path catalogRoot = catalog;
+    BackgroundWorker::LowPriority().Post([this, catalogRoot, caseId] ()
+    {
+        vector<string> problems;
+        string status;
+        try
+        {
+            VerifyCaseImages(catalogRoot, caseId, problems,
+                [] () { return BackgroundWorker::LowPriority().StopRequested(); },
+                [this] (size_t hashed, size_t toHash)
+                {
+                    lock_guard<mutex> guard(lock);
+                    progress.imagesHashed = max(progress.imagesHashed, hashed); // the hashing threads may report out of order
+                    progress.imagesToHash = toHash;
+                });
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugStringA(ex.what());
+            status = ex.what();
+        }
+        lock_guard<mutex> guard(lock);
+        progress.completed = status.empty();
+        progress.intact = progress.completed && none_of(problems.begin(), problems.end(), [] (const string& problem)
+        {
+            return problem.compare(0, 8, "corrupt\t") == 0 || problem.compare(0, 8, "missing\t") == 0 || problem.compare(0, 11, "unreadable\t") == 0;
+        });
+        progress.problems.swap(problems);
+        progress.status = status;
+        progress.running = false;
+        running = false;
+    });
+    return true;
+}
+
+CaseVerificationProgress CaseVerification::Progress() const
+{
+    lock_guard<mutex> guard(lock);
+    return progress;
+}
+
+DuplicateImageScan& DuplicateImageScan::Instance()
+{
+    static DuplicateImageScan scan;
+    return scan;
+}
+
+bool DuplicateImageScan::Start(const sys::path& catalog)
+{
+    if (running.exchange(true))
+        return false;
+    {
+        lock_guard<mutex> guard(lock);
+        hasResult = false;
+        groups.clear();
+        failedCases.clear();
+        status.clear();
+    }
+    sys::path catalogRoot = catalog;
+    BackgroundWorker::LowPriority().Post([this, catalogRoot] ()
+    {
+        try
+        {
+            auto cancel = [] () { return BackgroundWorker::LowPriority().StopRequested(); };
+            vector<string> caseIds = DirectoryScanner::ListDirectories(catalogRoot);
+            caseIds.erase(remove(caseIds.begin(), caseIds.end(), CONFIG_DIR_NAME), caseIds.end());
+
+            // Cases are updated in parallel as well as the files within each case, so a catalog of many
+            // small cases keeps as many reads in flight as one with a few large cases.
+            // A case that cannot be read is left out of the result instead of failing the whole scan.
+            vector<CaseManifest> manifests(caseIds.size());
+            vector<string> caseErrors(caseIds.size());
+            concurrency::parallel_for(size_t(0), caseIds.size(), [&] (size_t index)
+            {
+                try
+                {
+                    manifests[index] = CaseManifest::Update(catalogRoot, caseIds[index], cancel);
+                }
+                catch(const std::exception& ex)
+                {
+                    caseErrors[index] = ex.what();
+                }
+            });
+            if (cancel())
+                throw runtime_error("The duplicate image scan was canceled.");
+
+            vector<string> failed;
+            map<pair<uint64_t, uint64_t>, vector<string>> imagesByContent; // (size, hash) -> paths
+            for (size_t index = 0; index < caseIds.size(); ++index)
+            {
+                if (!caseErrors[index].empty())
+                    failed.push_back(caseIds[index] + '\t' + caseErrors[index]);
+                for (auto& item : manifests[index].entries)
+                    imagesByContent[make_pair(item.second.size, item.second.hash)].push_back(caseIds[index] + '\\' + item.first);
+            }
+            vector<string> duplicates;
+            for (auto& item : imagesByContent)
+            {
+                if (item.second.size() > 1)
+                    duplicates.push_back(JoinWith(item.second.begin(), item.second.end(), "\t"));
+            }
+            lock_guard<mutex> guard(lock);
+            groups.swap(duplicates);
+            failedCases.swap(failed);
+            hasResult = true;
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugStringA(ex.what());
+            lock_guard<mutex> guard(lock);
+            status = ex.what();
+        }
+        running = false;
+    });
+    return true;
+}
+
+bool DuplicateImageScan::GetResult(vector<string>& duplicates, vector<string>& failed, string& failure)
+{
+    lock_guard<mutex> guard(lock);
+    duplicates = groups;
+    failed = failedCases;
+    failure = status;
+    return hasResult;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <stdint.h>
+#include <functional>
+#include <filesystem>
+
+/// Summary:
+///   The recorded state of a file in a case manifest.
+struct ManifestEntry
+{
+    ManifestEntry() : size(0), writeTime(0), hash(0) {}
+
+    uint64_t size;
+    ULONGLONG writeTime;    // FILETIME ticks of the last write
+    uint64_t hash;          // XXH64 of the contents
+};
+
+/// Summary:
+///   The content hashes of the images of a case, stored in the catalog .config\manifests directory.
+///   Entries are keyed by size and last write time so that a file is only hashed again when one of those change.
+///   The images of an archived case are read from the archive, which keeps the size and write time of the originals.
+class CaseManifest
+{
+public:
+    std::map<std::string, ManifestEntry> entries; // keyed by the image path relative to the case (e.g. "2\7.jpg")
+
+    static std::tr2::sys::path ManifestFile(const std::tr2::sys::path& catalog, const std::string& caseId);
+
+    /// Summary:
+    ///   Reads a manifest. A missing or damaged manifest results in an empty one.
+    static CaseManifest Load(const std::tr2::sys::path& manifestFile);
+    void Save(const std::tr2::sys::path& manifestFile) const;
+
+    /// Summary:
+    ///   Hashes the contents of a file with large sequential reads.
+    /// Returns:
+    ///   False if the file could not be read
+    static bool HashFile(const std::tr2::sys::path& file, uint64_t& hash);
+
+    /// Summary:
+    ///   Hashes size bytes of a file starting at offset, such as an image stored in a case archive.
+    /// Returns:
+    ///   False if the range could not be read
+    static bool HashFileRange(const std::tr2::sys::path& file, uint64_t offset, uint64_t size, uint64_t& hash);
+
+    /// Summary:
+    ///   Scans the images of a case and hashes them in parallel.
+    /// Arguments:
+    ///   catalog - The path to the root of the catalog
+    ///   caseId - The case to scan
+    ///   previous - The hashes of files whose size and write time match an entry of previous are reused
+    ///   rehashAll - If true every file is hashed and previous is not used
+    ///   cancel - Polled between files. The scan throws runtime_error when it returns true.
+    ///   progress - Called with the number of files hashed and the number to hash, once before hashing starts
+    ///              and after each file. It is called from the hashing threads.
+    /// Returns:
+    ///   A manifest of the images currently in the case. Images that could not be read are left out.
+    static CaseManifest Scan(const std::tr2::sys::path& catalog, const std::string& caseId, const CaseManifest& previous, bool rehashAll,
+                             const std::function<bool()>& cancel = std::function<bool()>(),
+                             const std::function<void(size_t, size_t)>& progress = std::function<void(size_t, size_t)>());
+
+    /// Summary:
+    ///   Brings the stored manifest of a case up to date, hashing only new and changed files.
+    static CaseManifest Update(const std::tr2::sys::path& catalog, const std::string& caseId, const std::function<bool()>& cancel = std::function<bool()>());
+
+    /// Summary:
+    ///   Moves the stored manifest of a case that was renamed. The manifest keys are relative to the case so they still apply.
+    static void OnCaseRenamed(const std::tr2::sys::path& catalog, const std::string& oldCaseId, const std::string& newCaseId);
+};
+
+/// Summary:
+///   Hashes every image of a case and compares the results to the stored manifest.
+///   Images whose contents changed while their size and write time did not are reported as corrupt
+///   and keep their recorded hash so they are reported again until they are replaced.
+///   Other differences are recorded in the manifest.
+/// Arguments:
+///   problems - Receives a line for each difference of the form "<kind>\t<image path relative to the case>",
+///              where kind is corrupt, missing, changed, new or unreadable.
+///   cancel, progress - As for CaseManifest::Scan
+/// Returns:
+///   The number of images checked
+size_t VerifyCaseImages(const std::tr2::sys::path& catalog, const std::string& caseId, std::vector<std::string>& problems,
+                        const std::function<bool()>& cancel = std::function<bool()>(),
+                        const std::function<void(size_t, size_t)>& progress = std::function<void(size_t, size_t)>());
+
+/// Summary:
+///   The state of the last case verification.
+struct CaseVerificationProgress
+{
+    CaseVerificationProgress() : running(false), completed(false), intact(false), imagesHashed(0), imagesToHash(0) {}
+
+    bool running;
+    bool completed;         // False while running and if the verification failed
+    bool intact;            // True if no image is corrupt, missing or unreadable
+    std::string caseId;
+    size_t imagesHashed;
+    size_t imagesToHash;
+    std::vector<std::string> problems;  // The differences found by VerifyCaseImages
+    std::string status;     // Why the verification failed. Empty while running or if it completed.
+};
+
+/// Summary:
+///   Verifies the images of a case with VerifyCaseImages on the low priority background worker,
+///   so that hashing a large case does not hold up the host.
+class CaseVerification
+{
+    mutable std::mutex lock;
+    std::atomic<bool> running;
+    CaseVerificationProgress progress;
+
+    CaseVerification() : running(false) {}
+    CaseVerification(const CaseVerification&);
+    CaseVerification& operator = (const CaseVerification&);
+
+public:
+    static CaseVerification& Instance();
+
+    /// Summary:
+    ///   Starts verifying a case.
+    /// Returns:
+    ///   False if a verification is already running
+    bool Start(const std::tr2::sys::path& catalog, const std::string& caseId);
+
+    bool IsRunning() const { return running; }
+
+    CaseVerificationProgress Progress() const;
+};
+
+/// Summary:
+///   Finds images with identical contents across a catalog on the low priority background worker.
+///   The manifests of the cases are brought up to date along the way so later scans are fast.
+///   Several cases are hashed at once, as are the files of each case.
+class DuplicateImageScan
+{
+    std::mutex lock;
+    std::atomic<bool> running;
+    bool hasResult;
+    std::vector<std::string> groups;
+    std::vector<std::string> failedCases;
+    std::string status;
+
+    DuplicateImageScan() : running(false), hasResult(false) {}
+    DuplicateImageScan(const DuplicateImageScan&);
+    DuplicateImageScan& operator = (const DuplicateImageScan&);
+
+public:
+    static DuplicateImageScan& Instance();
+
+    /// Summary:
+    ///   Starts a scan of a catalog. The result of the previous scan is discarded.
+    /// Returns:
+    ///   False if a scan is already running
+    bool Start(const std::tr2::sys::path& catalog);
+
+    bool IsRunning() const { return running; }
+
+    /// Summary:
+    ///   Gets the result of the last scan.
+    /// Arguments:
+    ///   duplicates - Receives a line for each set of identical images with the paths relative to the catalog separated by a tab
+    ///   failedCases - Receives a line of the form "<case ID>\t<reason>" for each case that could not be scanned.
+    ///                 The images of those cases are not part of the result.
+    ///   status - Receives why the scan failed or was canceled. Empty while running or if it completed.
+    /// Returns:
+    ///   False if the last scan has not completed
+    bool GetResult(std::vector<std::string>& duplicates, std::vector<std::string>& failedCases, std::string& status);
+};
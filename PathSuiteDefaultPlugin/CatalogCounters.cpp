@@ -0,0 +1,281 @@
+#include "stdafx.h"
+#include "CatalogFiles.h"
+#include "CatalogCounters.h"
+#include "CaseArchive.h"
+#include "DirectoryScanner.h"
+#include "BackgroundWorker.h"
+
+using namespace std;
+using namespace std::tr2;
+using boost::property_tree::ptree;
+
+namespace
+{
+    sys::path CatalogCountersFile(const sys::path& catalogPath)
+    {
+        return CatalogConfigDirectory(catalogPath) / sys::path(CATALOG_COUNTERS_FILENAME);
+    }
+
+    void SaveCounts(const sys::path& catalogPath, const CatalogCounts& counts)
+    {
+        if (!sys::exists(CatalogConfigDirectory(catalogPath)))
+            return; // not a catalog (yet)
+        ptree pt;
+        pt.put("counts.cases", counts.cases);
+        pt.put("counts.specimens", counts.specimens);
+        pt.put("counts.images", counts.images);
+        pt.put("counts.reconciled", counts.reconciledOn);
+        SavePropertyTree(CatalogCountersFile(catalogPath), pt);
+    }
+}
+
+int CatalogItemDepth(const sys::path& catalogPath, const sys::path& item)
+{
+    string root = NormalizedPathKey(catalogPath);
+    string target = NormalizedPathKey(item);
+    if (root.empty() || target.size() < root.size() || target.compare(0, root.size(), root) != 0)
+        return -1;
+    if (target.size() == root.size())
+        return 0;
+    if (target[root.size()] != '\\')
+        return -1; // a sibling that shares a common prefix
+    string relative = target.substr(root.size() + 1);
+    string firstElement = relative.substr(0, relative.find('\\'));
+    if (firstElement == NormalizedPathKey(CONFIG_DIR_NAME))
+        return -1;
+    int depth = 1 + static_cast<int>(count(relative.begin(), relative.end(), '\\'));
+    return depth <= 3 ? depth : -1;
+}
+
+CatalogCounts CountCatalogContents(const sys::path& catalogPath, const function<bool()>& cancel)
+{
+    CatalogCounts counts;
+    for (auto& caseName : DirectoryScanner::ListDirectories(catalogPath))
+    {
+        sys::path caseDir = catalogPath / sys::path(caseName);
+        if (caseName == CONFIG_DIR_NAME)
+            continue;
+        if (cancel && cancel())
+            throw runtime_error("The catalog count was canceled.");
+        ++counts.cases;
+        if (CaseArchive::IsArchived(caseDir))
+        {
+            for (auto& entry : CaseArchive::ReadIndex(CaseArchive::ArchiveFile(caseDir)))
+            {
+                size_t depth = count(entry.path.begin(), entry.path.end(), '\\');
+                if (entry.isDirectory && depth == 0)
+                    ++counts.specimens;
+                else if (!entry.isDirectory && depth == 1 && IsCatalogImageFileName(sys::path(entry.path).filename()))
+                    ++counts.images;
+            }
+            continue;
+        }
+        for (auto& specimen : DirectoryScanner::ListDirectories(caseDir))
+        {
+            ++counts.specimens;
+            DirectoryScanner scanner(caseDir / sys::path(specimen));
+            DirectoryEntry entry;
+            while (scanner.Next(entry))
+            {
+                if (!entry.isDirectory && IsCatalogImageFileName(entry.name))
+                    ++counts.images;
+            }
+            scanner.ThrowIfFailed();
+        }
+    }
+    counts.reconciledOn = time(nullptr);
+    return counts;
+}
+
+CatalogCounters& CatalogCounters::Instance()
+{
+    static CatalogCounters counters;
+    return counters;
+}
+
+// The lock must be held by the caller
+CatalogCounts& CatalogCounters::Load(const sys::path& catalogPath)
+{
+    string key = NormalizedPathKey(catalogPath);
+    auto item = cache.find(key);
+    if (item != cache.end())
+        return item->second;
+
+    CatalogCounts& counts = cache[key];
+    sys::path countersFile = CatalogCountersFile(catalogPath);
+    try
+    {
+        if (sys::exists(countersFile))
+        {
+            ptree pt = GetPropertyTree(countersFile);
+            counts.cases = pt.get("counts.cases", 0LL);
+            counts.specimens = pt.get("counts.specimens", 0LL);
+            counts.images = pt.get("counts.images", 0LL);
+            counts.reconciledOn = pt.get<time_t>("counts.reconciled", 0);
+        }
+    }
+    catch(const std::exception& ex)
+    {   // A damaged file is treated as a catalog that has not been counted yet
+        OutputDebugStringA(ex.what());
+        counts = CatalogCounts();
+    }
+    return counts;
+}
+
+// Writes a copy of the cached counts so the lock is not held while the file is saved
+void CatalogCounters::Save(const sys::path& catalogPath)
+{
+    lock_guard<mutex> saveGuard(saveLock);
+    CatalogCounts counts;
+    {
+        lock_guard<mutex> guard(lock);
+        counts = Load(catalogPath);
+    }
+    SaveCounts(catalogPath, counts);
+}
+
+CatalogCounts CatalogCounters::Get(const sys::path& catalogPath)
+{
+    CatalogCounts counts;
+    {
+        lock_guard<mutex> guard(lock);
+        counts = Load(catalogPath);
+    }
+    if (counts.reconciledOn == 0)
+        ScheduleRecount(catalogPath);
+    return counts;
+}
+
+void CatalogCounters::Reset(const sys::path& catalogPath)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        CatalogCounts& counts = cache[NormalizedPathKey(catalogPath)];
+        counts = CatalogCounts();
+        counts.reconciledOn = time(nullptr);
+    }
+    Save(catalogPath);
+}
+
+void CatalogCounters::ScheduleRecount(const sys::path& catalogPath)
+{
+    string key = NormalizedPathKey(catalogPath);
+    {
+        lock_guard<mutex> guard(lock);
+        if (recountPending[key])
+            return;
+        recountPending[key] = true;
+    }
+    sys::path catalog = catalogPath;
+    BackgroundWorker::LowPriority().Post([this, catalog, key] () { Recount(catalog, key); });
+}
+
+// Runs on the background worker
+void CatalogCounters::Recount(const sys::path& catalogPath, const string& key)
+{
+    CatalogCounts counts;
+    bool counted = false;
+    for (int attempt = 1; ; ++attempt)
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            recountChanges[key] = RecountChanges();
+        }
+        counted = false;
+        try
+        {
+            counts = CountCatalogContents(catalogPath, [] () { return BackgroundWorker::LowPriority().StopRequested(); });
+            counted = true;
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugStringA(ex.what());
+        }
+        lock_guard<mutex> guard(lock);
+        RecountChanges changes = recountChanges[key];
+        if (counted && changes.count > 0 && attempt < MaxRecountAttempts)
+            continue;
+        recountChanges.erase(key);
+        recountPending[key] = false;
+        if (counted)
+        {
+            counts.cases = max(0LL, counts.cases + changes.cases);
+            counts.specimens = max(0LL, counts.specimens + changes.specimens);
+            counts.images = max(0LL, counts.images + changes.images);
+            cache[key] = counts;
+        }
+        break;
+    }
+    if (counted)
+    {
+        try
+        {
+            Save(catalogPath);
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugStringA(ex.what());
+        }
+    }
+}
+
+void CatalogCounters::ScheduleRecountIfStale(const sys::path& catalogPath, time_t maxAgeSeconds)
+{
+    time_t reconciledOn;
+    {
+        lock_guard<mutex> guard(lock);
+        reconciledOn = Load(catalogPath).reconciledOn;
+    }
+    if (reconciledOn == 0 || time(nullptr) - reconciledOn > maxAgeSeconds)
+        ScheduleRecount(catalogPath);
+}
+
+void CatalogCounters::Adjust(const sys::path& catalogPath, long long cases, long long specimens, long long images)
+{
+    {
+        lock_guard<mutex> guard(lock);
+        auto changes = recountChanges.find(NormalizedPathKey(catalogPath));
+        if (changes != recountChanges.end())
+        {
+            ++changes->second.count;
+            changes->second.cases += cases;
+            changes->second.specimens += specimens;
+            changes->second.images += images;
+        }
+        CatalogCounts& counts = Load(catalogPath);
+        if (counts.reconciledOn == 0)
+            return; // nothing to adjust until the first count completes
+        counts.cases = max(0LL, counts.cases + cases);
+        counts.specimens = max(0LL, counts.specimens + specimens);
+        counts.images = max(0LL, counts.images + images);
+    }
+    Save(catalogPath);
+}
+
+void CatalogCounters::OnDirectoryCreated(const sys::path& catalogPath, const sys::path& newDirectory, int createdLevels)
+{
+    int depth = CatalogItemDepth(catalogPath, newDirectory);
+    if (depth <= 0)
+        return;
+    long long cases = 0, specimens = 0;
+    for (int level = max(1, depth - createdLevels + 1); level <= depth; ++level)
+    {
+        if (level == 1)
+            ++cases;
+        else if (level == 2)
+            ++specimens;
+    }
+    if (cases || specimens)
+        Adjust(catalogPath, cases, specimens, 0);
+}
+
+void CatalogCounters::OnItemRemoved(const sys::path& catalogPath, const sys::path& removedItem, bool wasDirectory)
+{
+    int depth = CatalogItemDepth(catalogPath, removedItem);
+    if (wasDirectory && depth == 1)
+        Adjust(catalogPath, -1, 0, 0);
+    else if (wasDirectory && depth == 2)
+        Adjust(catalogPath, 0, -1, 0);
+    else if (!wasDirectory && depth == 3 && IsCatalogImageFileName(removedItem.filename()))
+        Adjust(catalogPath, 0, 0, -1);
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <ctime>
+#include <functional>
+#include <filesystem>
+
+/// Summary:
+///   Number of items contained in an image catalog.
+struct CatalogCounts
+{
+    CatalogCounts() : cases(0), specimens(0), images(0), reconciledOn(0) {}
+
+    long long cases;
+    long long specimens;
+    long long images;
+    time_t reconciledOn; // The time of the last full recount. Zero if the catalog has never been counted.
+};
+
+/// Summary:
+///   Performs a full scan of the catalog and counts the cases, specimens and images within it.
+///   This can take a long time for a large catalog. Use the CatalogCounters object for interactive requests.
+/// Arguments:
+///   catalogPath - The path to the root of the catalog
+///   cancel - Polled between cases. The scan stops early and throws std::runtime_error when it returns true.
+CatalogCounts CountCatalogContents(const std::tr2::sys::path& catalogPath, const std::function<bool()>& cancel = std::function<bool()>());
+
+/// Summary:
+///   Keeps a running count of the cases, specimens and images in each catalog without rescanning it.
+///   The counts are stored in the catalog .config directory, adjusted whenever the plug-in itself
+///   creates or removes an item, and reconciled by a full recount on a low priority background thread
+///   to pick up changes made outside of the plug-in.
+///   The recount may or may not see an item the plug-in creates or removes while it runs, so a recount that
+///   overlaps such a change is run again. If changes keep coming, the last recount keeps the adjustments made
+///   while it ran and the next recount corrects any difference.
+class CatalogCounters
+{
+    static const int MaxRecountAttempts = 3;
+
+    // The adjustments made to a catalog while it is recounted
+    struct RecountChanges
+    {
+        RecountChanges() : count(0), cases(0), specimens(0), images(0) {}
+
+        unsigned count;
+        long long cases;
+        long long specimens;
+        long long images;
+    };
+
+    std::mutex lock;
+    std::mutex saveLock;    // Taken before lock by Save so that the last save writes the latest counts
+    std::map<std::string, CatalogCounts> cache; // keyed by normalized catalog path
+    std::map<std::string, bool> recountPending;
+    std::map<std::string, RecountChanges> recountChanges; // keyed by normalized catalog path, while a recount runs
+
+    CatalogCounters() {}
+    CatalogCounters(const CatalogCounters&);
+    CatalogCounters& operator = (const CatalogCounters&);
+
+    CatalogCounts& Load(const std::tr2::sys::path& catalogPath);
+    void Save(const std::tr2::sys::path& catalogPath);
+    void Recount(const std::tr2::sys::path& catalogPath, const std::string& key);
+    void Adjust(const std::tr2::sys::path& catalogPath, long long cases, long long specimens, long long images);
+
+public:
+    static CatalogCounters& Instance();
+
+    /// Summary:
+    ///   Gets the current counts for the catalog without scanning it.
+    ///   A background recount is scheduled if the catalog has never been counted.
+    /// Returns:
+    ///   The counts. If reconciledOn is zero then the counts are not yet known.
+    CatalogCounts Get(const std::tr2::sys::path& catalogPath);
+
+    /// Summary:
+    ///   Sets the counts for a newly created catalog, which is known to be empty.
+    void Reset(const std::tr2::sys::path& catalogPath);
+
+    /// Summary:
+    ///   Queues a full recount of the catalog on the low priority background worker.
+    ///   Requests for a catalog that already has a recount queued are ignored.
+    void ScheduleRecount(const std::tr2::sys::path& catalogPath);
+
+    /// Summary:
+    ///   Schedules a recount if the counts were last reconciled more than maxAgeSeconds ago.
+    void ScheduleRecountIfStale(const std::tr2::sys::path& catalogPath, time_t maxAgeSeconds);
+
+    /// Summary:
+    ///   Updates the counts after the plug-in created a directory within the catalog.
+    ///   Missing intermediate directories created along with it are counted as well.
+    /// Arguments:
+    ///   catalogPath - The path to the root of the catalog
+    ///   newDirectory - The directory that was created.
+    ///   createdLevels - The number of directories created. Only the last createdLevels path elements are new.
+    void OnDirectoryCreated(const std::tr2::sys::path& catalogPath, const std::tr2::sys::path& newDirectory, int createdLevels = 1);
+
+    /// Summary:
+    ///   Updates the counts after the plug-in removed a file or an empty directory within the catalog.
+    void OnItemRemoved(const std::tr2::sys::path& catalogPath, const std::tr2::sys::path& removedItem, bool wasDirectory);
+};
+
+/// Summary:
+///   Gets the depth of a path within a catalog.
+/// Returns:
+///   1 for a case directory, 2 for a specimen directory, 3 for an image within a specimen,
+///   0 for the catalog root itself, or -1 if the path is not within the catalog (or is deeper than an image).
+int CatalogItemDepth(const std::tr2::sys::path& catalogPath, const std::tr2::sys::path& item);
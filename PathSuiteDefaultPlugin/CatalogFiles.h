@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <locale>
+#include <algorithm>
+#include <filesystem>
+#include <boost/property_tree/ptree.hpp>
+
+// Names of the files and folders that make up the catalog configuration.
+const std::string CONFIG_DIR_NAME                     = ".config";
+const std::string CATALOG_MAIN_CONFIG_FILENAME        = "HEAD";
+const std::string CATALOG_VARIABLES_FILENAME          = "catalog.var";
+const std::string CATALOG_COUNTERS_FILENAME           = "counters";
+const std::string CATALOG_SEARCH_INDEX_FILENAME       = "search.idx";
+const std::string ACCESSION_PREFIX_FILENAME           = "AccessionPrefixes.txt";
+
+// Catalog path helpers (implemented in PathSuiteDefaultPlugin.cpp)
+std::tr2::sys::path CatalogConfigDirectory(const std::tr2::sys::path& catalogPath);
+std::tr2::sys::path CatalogConfigDirectory();
+std::tr2::sys::path CatalogMainConfigFile(const std::tr2::sys::path& catalogPath);
+std::tr2::sys::path CatalogMainConfigFile();
+std::tr2::sys::path CatalogPrefsFile(const std::tr2::sys::path& catalogPath);
+
+boost::property_tree::ptree GetPropertyTree(const std::tr2::sys::path& fileName);
+void SavePropertyTree(const std::tr2::sys::path& fileName, const boost::property_tree::ptree& pt);
+
+/// Summary:
+///   Returns true if the file name follows the catalog image naming convention (e.g. "12.jpg" or "3.jp2").
+inline bool IsCatalogImageFileName(const std::string& fileName)
+{
+    auto ch = fileName.begin();
+    auto digitsEnd = std::find_if(ch, fileName.end(), [] (char c) { return c < '0' || c > '9'; });
+    if (digitsEnd == ch || std::distance(digitsEnd, fileName.end()) != 4)
+        return false;
+    return digitsEnd[0] == '.' && (digitsEnd[1] | 0x20) == 'j' && (digitsEnd[2] | 0x20) == 'p' &&
+           ((digitsEnd[3] | 0x20) == 'g' || digitsEnd[3] == '2');
+}
+
+/// Summary:
+///   Converts a path to a form that can be compared or hashed as a string.
+///   Windows paths are case insensitive and may use either slash.
+inline std::string NormalizedPathKey(const std::tr2::sys::path& p)
+{
+    std::string normalized = p.string();
+    std::replace(normalized.begin(), normalized.end(), '/', '\\');
+    while (!normalized.empty() && (normalized.back() == '\\' || normalized.back() == '.'))
+    {
+        if (normalized.back() == '.' && normalized.size() > 1 && normalized[normalized.size() - 2] != '\\')
+            break; // a trailing dot that is part of a name
+        normalized.pop_back();
+    }
+    std::transform(normalized.begin(), normalized.end(), normalized.begin(), [] (char c) { return std::tolower(c, std::locale::classic()); });
+    return normalized;
+}
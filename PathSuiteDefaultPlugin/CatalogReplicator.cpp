@@ -0,0 +1,349 @@
+#include "stdafx.h"
+#include <map>
+#include <ppl.h>
+#include "CatalogFiles.h"
+#include "CatalogReplicator.h"
+#include "DirectoryScanner.h"
+#include "PathSuiteHostVars.h"
+
+using namespace std;
+using namespace std::tr2;
+
+namespace
+{
+    const string RENAME_JOURNAL_FILENAME = "renames.journal";
+    const string REPLICA_STATE_FILENAME = ".replica-state";
+    const string CASE_LOCK_FILENAME = "case.lock";
+
+    // Lists a directory keyed by lower case name. File names on Windows are not case sensitive.
+    // Returns false if the directory could not be read completely. A missing directory is listed as empty.
+    bool ListDirectoryEntries(const sys::path& directory, map<string, DirectoryEntry>& entries)
+    {
+        entries.clear();
+        DirectoryScanner scanner(directory);
+        DirectoryEntry entry;
+        while (scanner.Next(entry))
+            entries[NormalizedPathKey(entry.name)] = entry;
+        return !scanner.Failed();
+    }
+
+    bool IsExistingDirectory(const sys::path& directory)
+    {
+        DWORD attributes = GetFileAttributesA(directory.string().c_str());
+        return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    }
+
+    bool RemoveTree(const sys::path& item, bool isDirectory)
+    {
+        if (!isDirectory)
+        {
+            SetFileAttributesA(item.string().c_str(), FILE_ATTRIBUTE_NORMAL);
+            return DeleteFileA(item.string().c_str()) != FALSE;
+        }
+        map<string, DirectoryEntry> children;
+        if (!ListDirectoryEntries(item, children))
+            return false;
+        for (auto& child : children)
+            RemoveTree(item / sys::path(child.second.name), child.second.isDirectory);
+        return RemoveDirectoryA(item.string().c_str()) != FALSE;
+    }
+
+    struct CopyContext
+    {
+        atomic<long long>* bytesCopied;
+        atomic<bool>* stopRequested;
+        long long reported;
+    };
+
+    DWORD CALLBACK CopyProgress(LARGE_INTEGER, LARGE_INTEGER transferred, LARGE_INTEGER, LARGE_INTEGER, DWORD, DWORD, HANDLE, HANDLE, LPVOID data)
+    {
+        CopyContext* context = static_cast<CopyContext*>(data);
+        *context->bytesCopied += transferred.QuadPart - context->reported;
+        context->reported = transferred.QuadPart;
+        return *context->stopRequested ? PROGRESS_CANCEL : PROGRESS_CONTINUE;
+    }
+
+    // The most copies queued before they are made, so memory does not grow with the size of the catalog
+    const size_t CopyBatchSize = 256;
+}
+
+CatalogReplicator& CatalogReplicator::Instance()
+{
+    static CatalogReplicator replicator;
+    return replicator;
+}
+
+CatalogReplicator::CatalogReplicator() :
+    running(false), stopRequested(false), filesScanned(0), filesCopied(0), bytesCopied(0), itemsRemoved(0), renamesApplied(0), errors(0),
+    startTicks(0), endTicks(0), lastPublishTicks(0), publishedFinalProgress(true), publishFailed(false)
+{
+}
+
+CatalogReplicator::~CatalogReplicator()
+{
+    Stop();
+}
+
+void CatalogReplicator::SetStatus(const string& text)
+{
+    lock_guard<mutex> guard(lock);
+    status = text;
+}
+
+bool CatalogReplicator::Start(const sys::path& catalog, const sys::path& replica, const vector<string>& caseIds)
+{
+    if (running)
+        return false;
+    if (job.joinable())
+        job.join();
+    string catalogKey = NormalizedPathKey(catalog) + '\\';
+    string replicaKey = NormalizedPathKey(replica) + '\\';
+    if (catalogKey.compare(0, replicaKey.size(), replicaKey) == 0 || replicaKey.compare(0, catalogKey.size(), catalogKey) == 0)
+        throw runtime_error("The replica and the catalog cannot be within each other.");
+    // Replication removes anything that is not in the catalog so never replicate into an unrelated directory
+    if (sys::exists(replica) && !sys::is_empty(replica) && !sys::exists(replica / sys::path(REPLICA_STATE_FILENAME)))
+        throw runtime_error("The replica folder must be empty or a replica of the catalog.");
+    running = true;
+    stopRequested = false;
+    filesScanned = filesCopied = bytesCopied = itemsRemoved = renamesApplied = errors = 0;
+    startTicks = GetTickCount64();
+    publishedFinalProgress = false;
+    publishFailed = false;
+    SetStatus("Starting");
+    job = thread(&CatalogReplicator::Run, this, catalog, replica, caseIds);
+    return true;
+}
+
+void CatalogReplicator::Stop()
+{
+    stopRequested = true;
+    if (job.joinable())
+        job.join();
+}
+
+ReplicationProgress CatalogReplicator::Progress()
+{
+    ReplicationProgress progress;
+    progress.running = running;
+    progress.filesScanned = filesScanned;
+    progress.filesCopied = filesCopied;
+    progress.bytesCopied = bytesCopied;
+    progress.itemsRemoved = itemsRemoved;
+    progress.renamesApplied = renamesApplied;
+    progress.errors = errors;
+    lock_guard<mutex> guard(lock);
+    progress.status = status;
+    if (startTicks)
+        progress.elapsedSeconds = ((progress.running ? GetTickCount64() : endTicks) - startTicks) / 1000.0;
+    return progress;
+}
+
+void CatalogReplicator::PublishProgress()
+{
+    ULONGLONG now = GetTickCount64();
+    if (publishFailed || publishedFinalProgress || (running && now - lastPublishTicks < PublishIntervalMilliseconds))
+        return;
+    lastPublishTicks = now;
+    ReplicationProgress progress = Progress();
+    publishedFinalProgress = !progress.running;
+    double megabytes = progress.bytesCopied / (1024.0 * 1024.0);
+    // The host variables are optional. If a macro has not defined them the progress is not published again
+    // until the next replication starts.
+    try
+    {
+        MGR::ReplicationRunning::Value(progress.running);
+        MGR::ReplicationFilesCopied::Value(static_cast<int>(progress.filesCopied));
+        MGR::ReplicationMegabytesCopied::Value(megabytes);
+        MGR::ReplicationMegabytesPerSecond::Value(progress.elapsedSeconds > 0 ? megabytes / progress.elapsedSeconds : 0.0);
+        MGR::ReplicationStatus::Value(progress.status);
+    }
+    catch(const std::exception& ex)
+    {
+        publishFailed = true;
+        OutputDebugString(ex.what());
+    }
+}
+
+void CatalogReplicator::RecordCaseRename(const sys::path& catalog, const string& oldCaseId, const string& newCaseId)
+{
+    ofstream journal((CatalogConfigDirectory(catalog) / sys::path(RENAME_JOURNAL_FILENAME)).string(), ios::out | ios::app | ios::binary);
+    journal << oldCaseId << '\t' << newCaseId << '\n';
+}
+
+// Applies the case renames recorded since the replica was last replicated.
+// The replica keeps the number of journal entries it has applied. The count only moves past a rename once it
+// has been applied, or needs no change in the replica, so a rename that fails is retried by the next replication.
+// The renames after it wait for it because a later rename may depend on it.
+void CatalogReplicator::ApplyRenames(const sys::path& catalog, const sys::path& replica)
+{
+    sys::path stateFile = replica / sys::path(REPLICA_STATE_FILENAME);
+    size_t applied = 0;
+    {
+        ifstream state(stateFile.string());
+        state >> applied;
+    }
+    ifstream journal((CatalogConfigDirectory(catalog) / sys::path(RENAME_JOURNAL_FILENAME)).string(), ios::in | ios::binary);
+    string line;
+    size_t entry = 0;
+    for (; getline(journal, line); ++entry)
+    {
+        if (entry < applied)
+            continue;
+        vector<string> names = Explode(TrimRightCopy(line), '\t');
+        if (names.size() != 2)
+            continue;
+        sys::path oldCase = replica / sys::path(names[0]);
+        sys::path newCase = replica / sys::path(names[1]);
+        // When the old case is not in the replica, or both are, mirroring the catalog brings the replica up to date
+        if (!sys::exists(oldCase) || sys::exists(newCase))
+            continue;
+        if (!MoveFileExA(oldCase.string().c_str(), newCase.string().c_str(), 0))
+        {
+            ++errors;
+            break;
+        }
+        ++renamesApplied;
+    }
+    if (entry > applied)
+    {
+        ofstream state(stateFile.string(), ios::out | ios::trunc);
+        state << entry;
+    }
+}
+
+// Copies the new and changed files of a directory tree and optionally removes the items that are not in the source.
+// The copies are made in batches of up to CopyBatchSize files as the tree is walked.
+void CatalogReplicator::MirrorDirectory(const sys::path& source, const sys::path& target, bool removeExtraItems)
+{
+    vector<CopyTask> copies;
+    copies.reserve(CopyBatchSize);
+    vector<pair<sys::path, sys::path>> directories(1, make_pair(source, target));
+    while (!directories.empty() && !stopRequested)
+    {
+        sys::path sourceDir = directories.back().first;
+        sys::path targetDir = directories.back().second;
+        directories.pop_back();
+        if (!sys::exists(targetDir) && !CreateDirectoryA(targetDir.string().c_str(), NULL))
+        {
+            ++errors;
+            continue;
+        }
+        // Items are only removed from the replica once both listings are known to be complete.
+        // A source directory that cannot be read (or that reads as missing because its share dropped)
+        // must never look empty, or everything in its replica would be removed.
+        map<string, DirectoryEntry> sourceEntries, targetEntries;
+        if (!ListDirectoryEntries(sourceDir, sourceEntries) || (sourceEntries.empty() && !IsExistingDirectory(sourceDir)) ||
+            !ListDirectoryEntries(targetDir, targetEntries))
+        {
+            ++errors;
+            continue;
+        }
+        for (auto& item : sourceEntries)
+        {
+            const DirectoryEntry& entry = item.second;
+            if (AreEqualIgnoreCase(entry.name, CASE_LOCK_FILENAME))
+                continue;
+            if (entry.isDirectory)
+            {
+                directories.push_back(make_pair(sourceDir / sys::path(entry.name), targetDir / sys::path(entry.name)));
+                continue;
+            }
+            ++filesScanned;
+            auto existing = targetEntries.find(item.first);
+            if (existing == targetEntries.end() || existing->second.isDirectory || existing->second.size != entry.size ||
+                CompareFileTime(&existing->second.writeTime, &entry.writeTime) != 0)
+            {
+                CopyTask task;
+                task.source = sourceDir / sys::path(entry.name);
+                task.target = targetDir / sys::path(entry.name);
+                copies.push_back(task);
+                if (copies.size() >= CopyBatchSize)
+                {
+                    CopyFiles(copies);
+                    copies.clear();
+                }
+            }
+        }
+        if (!removeExtraItems)
+            continue;
+        for (auto& item : targetEntries)
+        {
+            if (AreEqualIgnoreCase(item.second.name, REPLICA_STATE_FILENAME))
+                continue;
+            auto sourceEntry = sourceEntries.find(item.first);
+            bool keep = sourceEntry != sourceEntries.end() && sourceEntry->second.isDirectory == item.second.isDirectory;
+            if (!keep && RemoveTree(targetDir / sys::path(item.second.name), item.second.isDirectory))
+                ++itemsRemoved;
+        }
+    }
+    CopyFiles(copies);
+}
+
+void CatalogReplicator::CopyFiles(const vector<CopyTask>& copies)
+{
+    // Each copy waits on the disks or network most of the time so copying several at once keeps them busy.
+    // Files are copied to a temporary name first so an interrupted copy never leaves a partial file in the replica.
+    concurrency::parallel_for(size_t(0), copies.size(), [&] (size_t index)
+    {
+        if (stopRequested)
+            return;
+        const CopyTask& task = copies[index];
+        string partial = task.target.string() + ".partial";
+        CopyContext context = {&bytesCopied, &stopRequested, 0};
+        if (CopyFileExA(task.source.string().c_str(), partial.c_str(), CopyProgress, &context, NULL, 0) &&
+            MoveFileExA(partial.c_str(), task.target.string().c_str(), MOVEFILE_REPLACE_EXISTING))
+            ++filesCopied;
+        else
+        {
+            DeleteFileA(partial.c_str());
+            if (!stopRequested)
+                ++errors;
+        }
+    });
+}
+
+void CatalogReplicator::Run(const sys::path& catalog, const sys::path& replica, const vector<string>& caseIds)
+{
+    try
+    {
+        sys::create_directories(replica);
+        {   // marks the directory as a replica
+            ofstream state((replica / sys::path(REPLICA_STATE_FILENAME)).string(), ios::out | ios::app);
+        }
+        SetStatus("Applying renames");
+        ApplyRenames(catalog, replica);
+        if (caseIds.empty())
+        {
+            SetStatus("Replicating the catalog");
+            MirrorDirectory(catalog, replica, true);
+        }
+        else
+        {
+            MirrorDirectory(CatalogConfigDirectory(catalog), CatalogConfigDirectory(replica), true);
+            for (auto& caseId : caseIds)
+            {
+                if (stopRequested)
+                    break;
+                SetStatus("Replicating " + caseId);
+                if (sys::exists(catalog / sys::path(caseId)))
+                    MirrorDirectory(catalog / sys::path(caseId), replica / sys::path(caseId), true);
+            }
+        }
+        ostringstream result;
+        result << (stopRequested ? "Stopped. " : "Done. ") << filesCopied << " files copied";
+        if (errors > 0)
+            result << ", " << errors << " errors";
+        SetStatus(result.str());
+    }
+    catch(const std::exception& ex)
+    {
+        OutputDebugStringA(ex.what());
+        ++errors;
+        SetStatus(string("Failed. ") + ex.what());
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        endTicks = GetTickCount64();
+    }
+    running = false;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <filesystem>
+
+/// Summary:
+///   A snapshot of the progress of a replication.
+struct ReplicationProgress
+{
+    ReplicationProgress() : running(false), filesScanned(0), filesCopied(0), bytesCopied(0), itemsRemoved(0), renamesApplied(0), errors(0), elapsedSeconds(0) {}
+
+    bool running;
+    long long filesScanned;
+    long long filesCopied;
+    long long bytesCopied;
+    long long itemsRemoved;
+    long long renamesApplied;
+    long long errors;
+    double elapsedSeconds;
+    std::string status;     // A short description of what is being done, or the result when done
+};
+
+/// Summary:
+///   Mirrors a catalog, or selected cases of it, to a replica directory on another volume.
+///   Only files whose size or last write time differ are copied. Copies are made by CopyFileEx, which lets
+///   the system copy the data without passing it through the plug-in (and lets SMB servers copy it server side),
+///   several files at a time. Files that no longer exist in the catalog are removed from the replicated cases.
+///   A directory whose catalog or replica listing cannot be read completely is skipped and counted as an error,
+///   so nothing is ever removed from the replica on the strength of a failed listing.
+///   Cases renamed by the plug-in are recorded in a journal in the catalog .config directory and renamed on the
+///   replica before it is compared, so a rename does not cause the case to be copied again.
+///   Replication runs on its own thread. It never calls the host; PublishProgress copies the progress to host
+///   variables from the UI thread.
+class CatalogReplicator
+{
+    struct CopyTask
+    {
+        std::tr2::sys::path source;
+        std::tr2::sys::path target;
+    };
+
+    std::thread job;
+    std::mutex lock;
+    std::string status;
+    std::atomic<bool> running;
+    std::atomic<bool> stopRequested;
+    std::atomic<long long> filesScanned, filesCopied, bytesCopied, itemsRemoved, renamesApplied, errors;
+    ULONGLONG startTicks, endTicks, lastPublishTicks;
+    bool publishedFinalProgress;
+    bool publishFailed;                 // A host variable could not be set. Cleared by Start.
+
+    static const ULONGLONG PublishIntervalMilliseconds = 500;
+
+    CatalogReplicator();
+    CatalogReplicator(const CatalogReplicator&);
+    CatalogReplicator& operator = (const CatalogReplicator&);
+
+    void Run(const std::tr2::sys::path& catalog, const std::tr2::sys::path& replica, const std::vector<std::string>& caseIds);
+    void ApplyRenames(const std::tr2::sys::path& catalog, const std::tr2::sys::path& replica);
+    void MirrorDirectory(const std::tr2::sys::path& source, const std::tr2::sys::path& target, bool removeExtraItems);
+    void CopyFiles(const std::vector<CopyTask>& copies);
+    void SetStatus(const std::string& text);
+
+public:
+    ~CatalogReplicator();
+
+    static CatalogReplicator& Instance();
+
+    /// Summary:
+    ///   Starts replicating a catalog.
+    /// Arguments:
+    ///   catalog - The path to the root of the catalog
+    ///   replica - The directory to mirror the catalog to. It is created if it does not exist.
+    ///   caseIds - The cases to replicate. If empty, the whole catalog is replicated.
+    /// Returns:
+    ///   False if a replication is already running
+    bool Start(const std::tr2::sys::path& catalog, const std::tr2::sys::path& replica, const std::vector<std::string>& caseIds);
+
+    /// Summary:
+    ///   Stops a replication that is running and waits for it to finish the files being copied.
+    void Stop();
+
+    ReplicationProgress Progress();
+
+    /// Summary:
+    ///   Copies the progress to the MGR_*Replication* host variables. Must be called from the host UI thread.
+    ///   The variables are updated at most twice a second while a replication is running,
+    ///   and once more when it completes. If a variable cannot be set the error is written to the debug log
+    ///   and the progress is not published again until the next replication starts.
+    void PublishProgress();
+
+    /// Summary:
+    ///   Records that a case was renamed so that the rename is applied to replicas of the catalog.
+    static void RecordCaseRename(const std::tr2::sys::path& catalog, const std::string& oldCaseId, const std::string& newCaseId);
+};
@@ -0,0 +1,417 @@
+#include "stdafx.h"
+#include <map>
+#include <thread>
+#include <fstream>
+#include <condition_variable>
+#include "CatalogFiles.h"
+#include "CatalogReport.h"
+#include "CaseArchive.h"
+#include "DirectoryScanner.h"
+#include "FileOperationBatch.h"
+#include "MappedFile.h"
+
+using namespace std;
+using namespace std::tr2;
+
+namespace
+{
+    const string CASE_VARIABLES_FILENAME = "case.var";
+    const size_t OUTPUT_BUFFER_SIZE = 1024 * 1024;
+
+    ULONGLONG ToTicks(const FILETIME& ft)
+    {
+        return (static_cast<ULONGLONG>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    }
+
+    // Formats FILETIME ticks as a UTC date and time (e.g. "2014-03-07T16:05:09Z"). Zero is an empty string.
+    string FormatTime(ULONGLONG ticks)
+    {
+        FILETIME ft;
+        ft.dwLowDateTime = static_cast<DWORD>(ticks);
+        ft.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+        SYSTEMTIME st;
+        if (ticks == 0 || !FileTimeToSystemTime(&ft, &st))
+            return string();
+        char text[32];
+        sprintf_s(text, "%04u-%02u-%02uT%02u:%02u:%02uZ", st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond);
+        return text;
+    }
+
+    void AddImage(CaseReport& report, const string& fileName, uint64_t size, ULONGLONG writeTime)
+    {
+        ++report.images;
+        if (fileName.back() == '2')
+            ++report.losslessImages;
+        else
+            ++report.lossyImages;
+        report.imageBytes += size;
+        if (report.firstImageTime == 0 || writeTime < report.firstImageTime)
+            report.firstImageTime = writeTime;
+        report.lastImageTime = max(report.lastImageTime, writeTime);
+    }
+
+    void AppendCsvField(string& row, boost::string_ref field)
+    {
+        if (!row.empty())
+            row.push_back(',');
+        if (field.find_first_of(",\"\r\n") == boost::string_ref::npos)
+        {
+            row.append(field.begin(), field.end());
+            return;
+        }
+        row.push_back('"');
+        for (char ch : field)
+        {
+            if (ch == '"')
+                row.push_back('"');
+            row.push_back(ch);
+        }
+        row.push_back('"');
+    }
+
+    void AppendJsonString(string& line, boost::string_ref text)
+    {
+        static const char hex[] = "0123456789abcdef";
+        line.push_back('"');
+        for (char ch : text)
+        {
+            switch (ch)
+            {
+            case '"':  line.append("\\\""); break;
+            case '\\': line.append("\\\\"); break;
+            case '\n': line.append("\\n"); break;
+            case '\r': line.append("\\r"); break;
+            case '\t': line.append("\\t"); break;
+            default:
+                if (static_cast<unsigned char>(ch) < 0x20)
+                {
+                    line.append("\\u00");
+                    line.push_back(hex[ch >> 4]);
+                    line.push_back(hex[ch & 0xF]);
+                }
+                else
+                    line.push_back(ch);
+            }
+        }
+        line.push_back('"');
+    }
+
+    void AppendJsonMember(string& line, const char* name, boost::string_ref value)
+    {
+        line.push_back(line.size() > 1 ? ',' : '{');
+        AppendJsonString(line, name);
+        line.push_back(':');
+        AppendJsonString(line, value);
+    }
+
+    void AppendJsonMember(string& line, const char* name, uint64_t value)
+    {
+        line.push_back(line.size() > 1 ? ',' : '{');
+        AppendJsonString(line, name);
+        line.push_back(':');
+        line.append(to_string(value));
+    }
+
+    void AppendJsonVariables(string& line, const variable_list_t& variables)
+    {
+        line.append(line.size() > 1 ? ",\"variables\":{" : "{\"variables\":{");
+        for (size_t index = 0; index < variables.size(); ++index)
+        {
+            if (index > 0)
+                line.push_back(',');
+            AppendJsonString(line, variables[index].first);
+            line.push_back(':');
+            AppendJsonString(line, variables[index].second);
+        }
+        line.push_back('}');
+    }
+
+    const char* const CSV_COLUMNS[] = { "case", "prefix", "archived", "specimens", "images", "lossless", "lossy", "bytes", "first_image", "last_image", "error" };
+
+    string FormatCsvRow(const CaseReport& report, const vector<string>& variableColumns)
+    {
+        string row;
+        AppendCsvField(row, report.caseId);
+        AppendCsvField(row, report.prefix);
+        AppendCsvField(row, report.archived ? "1" : "0");
+        AppendCsvField(row, to_string(static_cast<uint64_t>(report.specimens)));
+        AppendCsvField(row, to_string(static_cast<uint64_t>(report.images)));
+        AppendCsvField(row, to_string(static_cast<uint64_t>(report.losslessImages)));
+        AppendCsvField(row, to_string(static_cast<uint64_t>(report.lossyImages)));
+        AppendCsvField(row, to_string(report.imageBytes));
+        AppendCsvField(row, FormatTime(report.firstImageTime));
+        AppendCsvField(row, FormatTime(report.lastImageTime));
+        AppendCsvField(row, report.error);
+        for (auto& column : variableColumns)
+        {
+            auto variable = find_if(report.variables.begin(), report.variables.end(), [&] (const pair<string, string>& item) { return item.first == column; });
+            AppendCsvField(row, variable != report.variables.end() ? boost::string_ref(variable->second) : boost::string_ref());
+        }
+        row.append("\r\n");
+        return row;
+    }
+
+    string FormatJsonLine(const CaseReport& report)
+    {
+        string line;
+        AppendJsonMember(line, "case", report.caseId);
+        AppendJsonMember(line, "prefix", report.prefix);
+        line.append(report.archived ? ",\"archived\":true" : ",\"archived\":false");
+        AppendJsonMember(line, "specimens", report.specimens);
+        AppendJsonMember(line, "images", report.images);
+        AppendJsonMember(line, "lossless", report.losslessImages);
+        AppendJsonMember(line, "lossy", report.lossyImages);
+        AppendJsonMember(line, "bytes", report.imageBytes);
+        AppendJsonMember(line, "first_image", FormatTime(report.firstImageTime));
+        AppendJsonMember(line, "last_image", FormatTime(report.lastImageTime));
+        if (!report.error.empty())
+            AppendJsonMember(line, "error", report.error);
+        AppendJsonVariables(line, report.variables);
+        line.append("}\n");
+        return line;
+    }
+}
+
+variable_list_t ReadVariableFile(const sys::path& fileName)
+{
+    variable_list_t variables;
+    MappedFile file;
+    if (!file.Open(fileName.string()))
+        return variables;
+    for (auto line : file.Lines())
+    {
+        line = TrimView(line);
+        if (line.empty() || line[0] == ';' || line[0] == '#' || line[0] == '[')
+            continue;
+        size_t equals = line.find('=');
+        if (equals == boost::string_ref::npos)
+            continue;
+        boost::string_ref name = TrimRightView(line.substr(0, equals));
+        boost::string_ref value = TrimLeftView(line.substr(equals + 1));
+        variables.push_back(make_pair(string(name.begin(), name.end()), string(value.begin(), value.end())));
+    }
+    return variables;
+}
+
+CaseReport ReadCaseReport(const sys::path& catalog, const string& caseId)
+{
+    CaseReport report;
+    report.caseId = caseId;
+    report.prefix.assign(caseId.begin(), find_if(caseId.begin(), caseId.end(), [] (char ch) { return !isalpha(static_cast<unsigned char>(ch)); }));
+    sys::path caseDir = catalog / sys::path(caseId);
+    try
+    {
+        report.variables = ReadVariableFile(caseDir / sys::path(CASE_VARIABLES_FILENAME));
+        report.archived = CaseArchive::IsArchived(caseDir);
+        if (report.archived)
+        {
+            for (auto& entry : CaseArchive::ReadIndex(CaseArchive::ArchiveFile(caseDir)))
+            {
+                size_t depth = count(entry.path.begin(), entry.path.end(), '\\');
+                string fileName = sys::path(entry.path).filename();
+                if (entry.isDirectory && depth == 0)
+                    ++report.specimens;
+                else if (!entry.isDirectory && depth == 1 && IsCatalogImageFileName(fileName))
+                    AddImage(report, fileName, entry.size, entry.writeTime);
+            }
+            return report;
+        }
+        for (auto& specimen : DirectoryScanner::ListDirectories(caseDir))
+        {
+            ++report.specimens;
+            DirectoryScanner scanner(caseDir / sys::path(specimen));
+            DirectoryEntry entry;
+            while (scanner.Next(entry))
+            {
+                if (!entry.isDirectory && IsCatalogImageFileName(entry.name))
+                    AddImage(report, entry.name, entry.size, ToTicks(entry.writeTime));
+            }
+            scanner.ThrowIfFailed();
+        }
+    }
+    catch(const std::exception& ex)
+    {
+        report.error = ex.what();
+    }
+    return report;
+}
+
+CatalogReportExport& CatalogReportExport::Instance()
+{
+    static CatalogReportExport reportExport;
+    return reportExport;
+}
+
+CatalogReportExport::~CatalogReportExport()
+{
+    Stop();
+}
+
+bool CatalogReportExport::Start(const sys::path& catalog, const sys::path& outputFile, ReportFormat format)
+{
+    if (running.exchange(true))
+        return false;
+    if (job.joinable())
+        job.join();
+    stopRequested = false;
+    {
+        lock_guard<mutex> guard(lock);
+        progress = ReportExportProgress();
+        progress.running = true;
+    }
+    job = thread([=] ()
+    {
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+        string status;
+        try
+        {
+            Export(catalog, outputFile, format);
+        }
+        catch(const std::exception& ex)
+        {
+            status = ex.what();
+        }
+        lock_guard<mutex> guard(lock);
+        progress.running = false;
+        progress.status = status;
+        running = false;
+    });
+    return true;
+}
+
+void CatalogReportExport::Stop()
+{
+    stopRequested = true;
+    if (job.joinable())
+        job.join();
+}
+
+ReportExportProgress CatalogReportExport::Progress() const
+{
+    lock_guard<mutex> guard(lock);
+    return progress;
+}
+
+void CatalogReportExport::Export(const sys::path& catalog, const sys::path& outputFile, ReportFormat format)
+{
+    vector<string> caseIds = DirectoryScanner::ListDirectories(catalog);
+    caseIds.erase(remove(caseIds.begin(), caseIds.end(), CONFIG_DIR_NAME), caseIds.end());
+    {
+        lock_guard<mutex> guard(lock);
+        progress.totalCases = caseIds.size();
+    }
+
+    // The buffer must be set after the file is opened and before anything is written. The library replaces
+    // a buffer set on a closed file stream with its own small one when the file is opened.
+    vector<char> outputBuffer(OUTPUT_BUFFER_SIZE);
+    ofstream output(outputFile.string(), ios::out | ios::binary | ios::trunc);
+    if (!output)
+        throw runtime_error("Unable to create the report file " + outputFile.string());
+    output.rdbuf()->pubsetbuf(outputBuffer.data(), outputBuffer.size());
+
+    variable_list_t catalogVariables = ReadVariableFile(CatalogConfigDirectory(catalog) / sys::path(CATALOG_VARIABLES_FILENAME));
+    vector<string> variableColumns;
+    if (format == ReportFormat::Csv)
+    {
+        string header;
+        for (auto column : CSV_COLUMNS)
+            AppendCsvField(header, column);
+        for (auto& variable : catalogVariables)
+        {
+            variableColumns.push_back(variable.first);
+            AppendCsvField(header, variable.first);
+        }
+        header.append("\r\n");
+        output << header;
+    }
+    else
+    {
+        string line;
+        AppendJsonMember(line, "catalog", catalog.string());
+        AppendJsonMember(line, "cases", caseIds.size());
+        AppendJsonVariables(line, catalogVariables);
+        line.append("}\n");
+        output << line;
+    }
+
+    // Readers take the next case and wait while it is more than WindowSize cases ahead of the writer.
+    // This thread writes the records in catalog order as they become available.
+    mutex windowLock;
+    condition_variable windowChanged;
+    map<size_t, string> ready;
+    size_t nextCase = 0;
+    size_t written = 0;
+    bool canceled = false;
+    auto reader = [&] ()
+    {
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+        for (;;)
+        {
+            size_t index;
+            {
+                unique_lock<mutex> guard(windowLock);
+                while (!canceled && nextCase < caseIds.size() && nextCase >= written + WindowSize)
+                    windowChanged.wait(guard);
+                if (canceled || nextCase >= caseIds.size())
+                    return;
+                index = nextCase++;
+            }
+            CaseReport report = ReadCaseReport(catalog, caseIds[index]);
+            string record = format == ReportFormat::Csv ? FormatCsvRow(report, variableColumns) : FormatJsonLine(report);
+            lock_guard<mutex> guard(windowLock);
+            ready[index].swap(record);
+            windowChanged.notify_all();
+        }
+    };
+
+    // Reading a case is mostly waiting on the file system, so there are more readers than cores
+    size_t readerCount = min(caseIds.size(), max<size_t>(FileOperationBatch::DefaultQueueDepth, 2 * thread::hardware_concurrency()));
+    vector<thread> readers;
+    for (size_t count = 0; count < readerCount; ++count)
+        readers.push_back(thread(reader));
+
+    try
+    {
+        while (written < caseIds.size())
+        {
+            string record;
+            {
+                unique_lock<mutex> guard(windowLock);
+                while (ready.empty() || ready.begin()->first != written)
+                {
+                    if (stopRequested)
+                        throw runtime_error("The report export was canceled.");
+                    windowChanged.wait_for(guard, chrono::milliseconds(100));
+                }
+                record.swap(ready.begin()->second);
+                ready.erase(ready.begin());
+            }
+            output << record;
+            if (!output)
+                throw runtime_error("Unable to write the report file " + outputFile.string());
+            {
+                lock_guard<mutex> guard(windowLock);
+                ++written;
+                windowChanged.notify_all();
+            }
+            lock_guard<mutex> guard(lock);
+            progress.casesWritten = written;
+        }
+    }
+    catch(...)
+    {
+        {
+            lock_guard<mutex> guard(windowLock);
+            canceled = true;
+            windowChanged.notify_all();
+        }
+        for (auto& readerThread : readers)
+            readerThread.join();
+        throw;
+    }
+    for (auto& readerThread : readers)
+        readerThread.join();
+    output.close();
+    if (!output)
+        throw runtime_error("Unable to write the report file " + outputFile.string());
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <utility>
+#include <stdint.h>
+#include <filesystem>
+
+/// Summary:
+///   The name and value of each line of a variable file (case.var or catalog.var) in file order.
+///   Each line has the form "name=value". Blank lines, [section] lines and lines that start with ';' or '#' are skipped.
+typedef std::vector<std::pair<std::string, std::string>> variable_list_t;
+
+/// Summary:
+///   Reads a variable file.
+/// Returns:
+///   The variables. A missing file has none.
+variable_list_t ReadVariableFile(const std::tr2::sys::path& fileName);
+
+/// Summary:
+///   The details of a case used by the catalog reports.
+struct CaseReport
+{
+    CaseReport() : archived(false), specimens(0), images(0), losslessImages(0), lossyImages(0), imageBytes(0), firstImageTime(0), lastImageTime(0) {}
+
+    std::string caseId;
+    std::string prefix;         // The letters the case ID starts with (e.g. "S" for "S12-345")
+    bool archived;
+    size_t specimens;
+    size_t images;
+    size_t losslessImages;      // .jp2 images
+    size_t lossyImages;         // .jpg images
+    uint64_t imageBytes;
+    ULONGLONG firstImageTime;   // FILETIME ticks of the oldest image write. Zero if there are no images.
+    ULONGLONG lastImageTime;    // FILETIME ticks of the newest image write
+    variable_list_t variables;  // from case.var
+    std::string error;          // Set if the case could not be read completely
+};
+
+/// Summary:
+///   Reads the details of a case from its directory listing, or from its archive index if it is archived, and its case.var file.
+CaseReport ReadCaseReport(const std::tr2::sys::path& catalog, const std::string& caseId);
+
+enum class ReportFormat
+{
+    Csv,        // A header row followed by a row for each case
+    JsonLines   // A JSON object on each line. The first describes the catalog and the rest each describe a case.
+};
+
+/// Summary:
+///   The state of the last catalog report export.
+struct ReportExportProgress
+{
+    ReportExportProgress() : running(false), casesWritten(0), totalCases(0) {}
+
+    bool running;
+    size_t casesWritten;
+    size_t totalCases;
+    std::string status;     // Empty while running or after a successful export
+};
+
+/// Summary:
+///   Writes a report of every case of a catalog to a file on its own thread, so a long export does not hold up
+///   the tasks of the low priority background worker.
+///   The cases are read by several threads at once so the export keeps many file system requests in flight.
+///   The readers run at the lowest thread priority so that the host stays responsive while they work.
+///   Each case is written as soon as it and the cases before it have been read, in the order the catalog lists them.
+///   At most WindowSize cases are held in memory, so memory use does not grow with the size of the catalog.
+///   The CSV columns are the case aggregates followed by the variables named in the catalog's catalog.var.
+///   The JSON lines include every variable of case.var.
+class CatalogReportExport
+{
+public:
+    static const size_t WindowSize = 256;
+
+private:
+    mutable std::mutex lock;
+    std::thread job;
+    std::atomic<bool> running;
+    std::atomic<bool> stopRequested;
+    ReportExportProgress progress;
+
+    CatalogReportExport() : running(false), stopRequested(false) {}
+    CatalogReportExport(const CatalogReportExport&);
+    CatalogReportExport& operator = (const CatalogReportExport&);
+
+    void Export(const std::tr2::sys::path& catalog, const std::tr2::sys::path& outputFile, ReportFormat format);
+
+public:
+    ~CatalogReportExport();
+
+    static CatalogReportExport& Instance();
+
+    /// Summary:
+    ///   Starts an export.
+    /// Returns:
+    ///   False if an export is already running
+    bool Start(const std::tr2::sys::path& catalog, const std::tr2::sys::path& outputFile, ReportFormat format);
+
+    /// Summary:
+    ///   Cancels an export that is running and waits for its threads to finish.
+    void Stop();
+
+    bool IsRunning() const { return running; }
+
+    ReportExportProgress Progress() const;
+};
@@ -0,0 +1,646 @@
+#include "stdafx.h"
+#include <ppl.h>
+#include <unordered_map>
+#include "CatalogFiles.h"
+#include "CatalogCounters.h"
+#include "CatalogSearchIndex.h"
+#include "BackgroundWorker.h"
+#include "DirectoryScanner.h"
+#include "CaseArchive.h"
+
+using namespace std;
+using namespace std::tr2;
+
+namespace
+{
+    const char INDEX_FILE_HEADER[] = "PSIDX 1";
+
+    string ToLowerAscii(string text)
+    {
+        transform(text.begin(), text.end(), text.begin(), AsciiToLower<char>);
+        return text;
+    }
+
+    // Newlines and tabs are used as separators in the index file
+    string SingleLine(string text)
+    {
+        replace_if(text.begin(), text.end(), [] (char c) { return c == '\n' || c == '\r' || c == '\t'; }, ' ');
+        return text;
+    }
+
+    // The words of a document are taken from its path (without the image file extension) and its text.
+    vector<string> DocumentWords(const CatalogSearchIndex::Document& doc)
+    {
+        string path = doc.path;
+        if (IsCatalogImageFileName(sys::path(path).filename()))
+            path.erase(path.rfind('.'));
+        vector<string> words = CatalogSearchIndex::Tokenize(path + ' ' + doc.text);
+        sort(words.begin(), words.end());
+        words.erase(unique(words.begin(), words.end()), words.end());
+        return words;
+    }
+
+    void AddPostings(CatalogSearchIndex::Index& index, uint32_t id, const vector<string>& words)
+    {
+        for (auto& word : words)
+        {
+            auto& ids = index.postings[word];
+            auto position = lower_bound(ids.begin(), ids.end(), id);
+            if (position == ids.end() || *position != id)
+                ids.insert(position, id);
+        }
+    }
+
+    void RemovePostings(CatalogSearchIndex::Index& index, uint32_t id, const vector<string>& words)
+    {
+        for (auto& word : words)
+        {
+            auto item = index.postings.find(word);
+            if (item == index.postings.end())
+                continue;
+            auto position = lower_bound(item->second.begin(), item->second.end(), id);
+            if (position != item->second.end() && *position == id)
+                item->second.erase(position);
+            if (item->second.empty())
+                index.postings.erase(item);
+        }
+    }
+
+    // True if a lower case relative path is a case or an item within it
+    bool IsWithinCase(const string& path, const string& caseKey)
+    {
+        return path.compare(0, caseKey.size(), caseKey) == 0 && (path.size() == caseKey.size() || path[caseKey.size()] == '\\');
+    }
+
+    sys::path SearchIndexFile(const sys::path& catalog)
+    {
+        return CatalogConfigDirectory(catalog) / sys::path(CATALOG_SEARCH_INDEX_FILENAME);
+    }
+}
+
+CatalogSearchIndex& CatalogSearchIndex::Instance()
+{
+    static CatalogSearchIndex index;
+    return index;
+}
+
+vector<string> CatalogSearchIndex::Tokenize(const string& text)
+{
+    vector<string> words;
+    auto isWordChar = [] (char c) { return std::isalnum(c, std::locale::classic()); };
+    auto wordStart = find_if(text.begin(), text.end(), isWordChar);
+    while (wordStart != text.end())
+    {
+        auto wordEnd = find_if_not(wordStart, text.end(), isWordChar);
+        words.push_back(ToLowerAscii(string(wordStart, wordEnd)));
+        wordStart = find_if(wordEnd, text.end(), isWordChar);
+    }
+    return words;
+}
+
+shared_ptr<CatalogSearchIndex::Index> CatalogSearchIndex::Build(const sys::path& catalog, const map<string, string>& itemText, const function<bool()>& cancel)
+{
+    vector<string> caseIds = DirectoryScanner::ListDirectories(catalog);
+    caseIds.erase(remove(caseIds.begin(), caseIds.end(), CONFIG_DIR_NAME), caseIds.end());
+
+    // Each case is scanned independently. The results are merged in case order so the ids are stable.
+    vector<vector<Document>> caseDocuments(caseIds.size());
+    concurrency::parallel_for(size_t(0), caseIds.size(), [&] (size_t caseIndex)
+    {
+        if (cancel && cancel())
+            return;
+        auto& docs = caseDocuments[caseIndex];
+        const string& caseId = caseIds[caseIndex];
+        sys::path caseDir = catalog / sys::path(caseId);
+        Document caseDoc;
+        caseDoc.path = caseId;
+        docs.push_back(caseDoc);
+        try
+        {
+            // Archived cases are listed from their archive index
+            for (auto& specimen : CaseArchive::ListSpecimens(caseDir))
+            {
+                if (cancel && cancel())
+                    return;
+                Document specimenDoc;
+                specimenDoc.path = caseId + '\\' + specimen;
+                docs.push_back(specimenDoc);
+                for (auto& image : CaseArchive::ListImages(caseDir, specimen))
+                {
+                    if (cancel && cancel())
+                        return;
+                    Document imageDoc;
+                    imageDoc.path = specimenDoc.path + '\\' + image;
+                    docs.push_back(imageDoc);
+                }
+            }
+        }
+        catch(const std::exception& ex)
+        {   // Index what could be read. The case will be picked up by a later build.
+            OutputDebugStringA(ex.what());
+        }
+    });
+    if (cancel && cancel())
+        throw runtime_error("The search index build was canceled.");
+
+    auto index = make_shared<Index>();
+    for (auto& docs : caseDocuments)
+    {
+        for (auto& doc : docs)
+        {
+            uint32_t id = static_cast<uint32_t>(index->documents.size());
+            string key = ToLowerAscii(doc.path);
+            auto text = itemText.find(key);
+            if (text != itemText.end())
+                doc.text = text->second;
+            index->idByPath[key] = id;
+            index->documents.push_back(move(doc));
+        }
+        docs.clear();
+    }
+    for (uint32_t id = 0; id < index->documents.size(); ++id)
+    {
+        for (auto& word : DocumentWords(index->documents[id]))
+            index->postings[word].push_back(id); // ids are visited in order so each list stays sorted
+    }
+    return index;
+}
+
+void CatalogSearchIndex::Save(const sys::path& indexFile, const Index& index)
+{
+    // The documents of removed cases have an empty path and no postings
+    vector<uint32_t> savedIds(index.documents.size());
+    uint32_t savedCount = 0;
+    for (size_t id = 0; id < index.documents.size(); ++id)
+    {
+        savedIds[id] = savedCount;
+        if (!index.documents[id].path.empty())
+            ++savedCount;
+    }
+
+    ofstream file(indexFile.string(), ios::out | ios::trunc | ios::binary);
+    file.exceptions(ofstream::failbit | ofstream::badbit);
+    file << INDEX_FILE_HEADER << '\n' << savedCount << '\n';
+    for (auto& doc : index.documents)
+    {
+        if (!doc.path.empty())
+            file << doc.path << '\t' << SingleLine(doc.text) << '\n';
+    }
+    file << index.postings.size() << '\n';
+    for (auto& posting : index.postings)
+    {
+        file << posting.first << ' ' << posting.second.size();
+        for (auto id : posting.second)
+            file << ' ' << savedIds[id];
+        file << '\n';
+    }
+}
+
+shared_ptr<CatalogSearchIndex::Index> CatalogSearchIndex::Load(const sys::path& indexFile)
+{
+    ifstream file(indexFile.string(), ios::in | ios::binary);
+    string line;
+    if (!getline(file, line) || line != INDEX_FILE_HEADER)
+        return nullptr;
+
+    auto index = make_shared<Index>();
+    size_t count = 0;
+    if (!getline(file, line))
+        return nullptr;
+    count = stoul(line);
+    index->documents.reserve(count);
+    for (size_t i = 0; i < count && getline(file, line); ++i)
+    {
+        Document doc;
+        auto separator = line.find('\t');
+        doc.path = line.substr(0, separator);
+        if (separator != string::npos)
+            doc.text = line.substr(separator + 1);
+        index->idByPath[ToLowerAscii(doc.path)] = static_cast<uint32_t>(index->documents.size());
+        index->documents.push_back(move(doc));
+    }
+    if (index->documents.size() != count || !getline(file, line))
+        return nullptr;
+    count = stoul(line);
+    for (size_t i = 0; i < count && getline(file, line); ++i)
+    {
+        istringstream entry(line);
+        string word;
+        size_t idCount = 0;
+        entry >> word >> idCount;
+        auto& ids = index->postings[word];
+        ids.resize(idCount);
+        for (auto& id : ids)
+            entry >> id;
+        if (!entry || (!ids.empty() && ids.back() >= index->documents.size()))
+            return nullptr;
+    }
+    return index->postings.size() == count ? index : nullptr;
+}
+
+// Gets the index for the catalog. If another catalog was indexed the index of this one is loaded, or built if it
+// cannot be loaded, on the background worker and there is no index until that completes.
+shared_ptr<CatalogSearchIndex::Index> CatalogSearchIndex::Acquire(const sys::path& catalog)
+{
+    lock_guard<mutex> guard(lock);
+    if (NormalizedPathKey(catalog) == catalogKey)
+        return current;
+    SelectCatalog(catalog);
+    RequestRefresh(false);
+    return nullptr;
+}
+
+// Forgets the index of the current catalog and the text recorded for it.
+// The lock must be held by the caller.
+void CatalogSearchIndex::SelectCatalog(const sys::path& catalog)
+{
+    catalogKey = NormalizedPathKey(catalog);
+    catalogPath = catalog;
+    ++catalogGeneration;
+    current.reset();
+    recordedText.clear();
+    caseChanges.clear();
+    modifiedTicks = 0;
+}
+
+// Starts the save delay when the current index is first changed after it was saved.
+// The lock must be held by the caller.
+void CatalogSearchIndex::NoteModified()
+{
+    if (current && current->modified && modifiedTicks == 0)
+        modifiedTicks = GetTickCount64();
+}
+
+// Asks the background worker to load or build the index of the current catalog. A task that is already
+// queued or running takes the request when it finishes what it is doing.
+// The lock must be held by the caller.
+void CatalogSearchIndex::RequestRefresh(bool build)
+{
+    if (build)
+        buildRequested = true;
+    else
+        loadRequested = true;
+    if (!building.exchange(true))
+        BackgroundWorker::LowPriority().Post([this] () { Refresh(); });
+}
+
+bool CatalogSearchIndex::ScheduleBuild(const sys::path& catalog)
+{
+    lock_guard<mutex> guard(lock);
+    if (NormalizedPathKey(catalog) != catalogKey)
+        SelectCatalog(catalog);
+    else if (buildRequested || buildRunning)
+        return false;
+    // The text recorded in the saved index is carried over to the new index, so it is loaded first
+    if (!current)
+        loadRequested = true;
+    RequestRefresh(true);
+    return true;
+}
+
+// Runs on the background worker until there are no more requests
+void CatalogSearchIndex::Refresh()
+{
+    for (;;)
+    {
+        sys::path catalog;
+        string key;
+        unsigned generation;
+        bool load, build;
+        {
+            lock_guard<mutex> guard(lock);
+            if (!loadRequested && !buildRequested)
+            {
+                building = false;
+                caseChanges.clear();
+                return;
+            }
+            catalog = catalogPath;
+            key = catalogKey;
+            generation = catalogGeneration;
+            load = loadRequested;
+            build = buildRequested;
+            loadRequested = buildRequested = false;
+            buildRunning = build;
+        }
+        try
+        {
+            shared_ptr<Index> index;
+            if (load)
+            {
+                try
+                {
+                    index = Load(SearchIndexFile(catalog));
+                }
+                catch(const std::exception& ex)
+                {
+                    OutputDebugStringA(ex.what());
+                }
+                if (index)
+                    Install(key, index);
+            }
+            if (build || !index)
+            {
+                map<string, string> itemText;
+                {
+                    lock_guard<mutex> guard(lock);
+                    buildRunning = true;
+                    itemText = recordedText;
+                }
+                auto cancel = [this, generation] () { return BackgroundWorker::LowPriority().StopRequested() || catalogGeneration != generation; };
+                index = Build(catalog, itemText, cancel);
+                if (sys::exists(CatalogConfigDirectory(catalog)))
+                    Save(SearchIndexFile(catalog), *index);
+                Install(key, index);
+            }
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugStringA(ex.what());
+        }
+        lock_guard<mutex> guard(lock);
+        buildRunning = false;
+    }
+}
+
+// Makes a loaded or built index current if its catalog is still the current one.
+// The text recorded and the cases changed since the worker task started are applied to it. An index may already
+// include some of those changes, so applying a change again must leave the index as it is.
+void CatalogSearchIndex::Install(const string& key, const shared_ptr<Index>& index)
+{
+    lock_guard<mutex> guard(lock);
+    if (key != catalogKey)
+        return;
+    for (auto& change : caseChanges)
+        ApplyCaseChange(*index, change);
+    for (auto& doc : index->documents)
+    {
+        if (!doc.text.empty())
+            recordedText.insert(make_pair(ToLowerAscii(doc.path), doc.text));
+    }
+    for (auto& item : recordedText)
+    {
+        auto id = index->idByPath.find(item.first);
+        if (id == index->idByPath.end() || index->documents[id->second].text != SingleLine(item.second))
+            ApplyText(*index, item.first, item.second);
+    }
+    current = index;
+    modifiedTicks = 0;
+    NoteModified();
+}
+
+// Updates the documents of a case that was created, removed or renamed.
+// The lock must be held by the caller
+void CatalogSearchIndex::ApplyCaseChange(Index& index, const CaseChange& change)
+{
+    if (!change.oldCaseId.empty())
+    {
+        if (!change.newCaseId.empty() && index.idByPath.find(ToLowerAscii(change.newCaseId)) != index.idByPath.end())
+            return; // already renamed
+        string oldKey = ToLowerAscii(change.oldCaseId);
+        vector<uint32_t> ids;
+        for (auto item = index.idByPath.lower_bound(oldKey); item != index.idByPath.end() && item->first.compare(0, oldKey.size(), oldKey) == 0; )
+        {
+            if (IsWithinCase(item->first, oldKey))
+            {
+                ids.push_back(item->second);
+                item = index.idByPath.erase(item);
+            }
+            else
+                ++item;
+        }
+        for (auto id : ids)
+        {
+            Document& doc = index.documents[id];
+            RemovePostings(index, id, DocumentWords(doc));
+            if (change.newCaseId.empty())
+            {   // Left in place so that the ids of the other documents do not change. Save leaves it out.
+                doc.path.clear();
+                doc.text.clear();
+                continue;
+            }
+            doc.path = change.newCaseId + doc.path.substr(change.oldCaseId.size());
+            index.idByPath[ToLowerAscii(doc.path)] = id;
+            AddPostings(index, id, DocumentWords(doc));
+        }
+        index.modified = index.modified || !ids.empty();
+    }
+    else if (index.idByPath.find(ToLowerAscii(change.newCaseId)) == index.idByPath.end())
+    {
+        uint32_t id = static_cast<uint32_t>(index.documents.size());
+        Document doc;
+        doc.path = change.newCaseId;
+        index.documents.push_back(doc);
+        index.idByPath[ToLowerAscii(doc.path)] = id;
+        AddPostings(index, id, DocumentWords(index.documents[id]));
+        index.modified = true;
+    }
+}
+
+void CatalogSearchIndex::RecordCaseChange(const sys::path& catalog, const CaseChange& change)
+{
+    lock_guard<mutex> guard(lock);
+    if (NormalizedPathKey(catalog) != catalogKey)
+        return;
+    if (building)
+        caseChanges.push_back(change);
+    if (current)
+        ApplyCaseChange(*current, change);
+    NoteModified();
+    if (change.oldCaseId.empty())
+        return;
+    // The text recorded for the items of the case moves with it
+    string oldKey = ToLowerAscii(change.oldCaseId);
+    map<string, string> moved;
+    for (auto item = recordedText.lower_bound(oldKey); item != recordedText.end() && item->first.compare(0, oldKey.size(), oldKey) == 0; )
+    {
+        if (!IsWithinCase(item->first, oldKey))
+        {
+            ++item;
+            continue;
+        }
+        if (!change.newCaseId.empty())
+            moved[ToLowerAscii(change.newCaseId) + item->first.substr(oldKey.size())] = item->second;
+        item = recordedText.erase(item);
+    }
+    recordedText.insert(moved.begin(), moved.end());
+}
+
+void CatalogSearchIndex::OnCaseAdded(const sys::path& catalog, const string& caseId)
+{
+    CaseChange change;
+    change.newCaseId = caseId;
+    RecordCaseChange(catalog, change);
+}
+
+void CatalogSearchIndex::OnCaseRemoved(const sys::path& catalog, const string& caseId)
+{
+    CaseChange change;
+    change.oldCaseId = caseId;
+    RecordCaseChange(catalog, change);
+}
+
+void CatalogSearchIndex::OnCaseRenamed(const sys::path& catalog, const string& oldCaseId, const string& newCaseId)
+{
+    CaseChange change;
+    change.oldCaseId = oldCaseId;
+    change.newCaseId = newCaseId;
+    RecordCaseChange(catalog, change);
+}
+
+// The lock must be held by the caller
+void CatalogSearchIndex::ApplyText(Index& index, const string& path, const string& text)
+{
+    string key = ToLowerAscii(path);
+    auto item = index.idByPath.find(key);
+    uint32_t id;
+    if (item == index.idByPath.end())
+    {   // An item that was added after the index was built
+        id = static_cast<uint32_t>(index.documents.size());
+        Document doc;
+        doc.path = path;
+        index.documents.push_back(doc);
+        index.idByPath[key] = id;
+    }
+    else
+    {
+        id = item->second;
+        RemovePostings(index, id, DocumentWords(index.documents[id]));
+    }
+    index.documents[id].text = SingleLine(text);
+    AddPostings(index, id, DocumentWords(index.documents[id]));
+    index.modified = true;
+}
+
+void CatalogSearchIndex::SetItemText(const sys::path& catalog, const sys::path& item, const string& text)
+{
+    if (CatalogItemDepth(catalog, item) <= 0)
+        return;
+    // The relative path keeps the case of the item path but the root is matched without regard to case
+    string itemPath = item.string();
+    replace(itemPath.begin(), itemPath.end(), '/', '\\');
+    string relativePath = itemPath.substr(NormalizedPathKey(catalog).size() + 1);
+
+    auto index = Acquire(catalog);
+    lock_guard<mutex> guard(lock);
+    recordedText[ToLowerAscii(relativePath)] = text;
+    if (index)
+        ApplyText(*index, relativePath, text);
+    NoteModified();
+}
+
+void CatalogSearchIndex::SaveIfDue()
+{
+    lock_guard<mutex> guard(lock);
+    if (saveQueued || modifiedTicks == 0 || GetTickCount64() - modifiedTicks < SaveDelayMilliseconds)
+        return;
+    saveQueued = true;
+    BackgroundWorker::LowPriority().Post([this] ()
+    {
+        try
+        {
+            SaveIfModified();
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugStringA(ex.what());
+        }
+        lock_guard<mutex> guard(lock);
+        saveQueued = false;
+    });
+}
+
+void CatalogSearchIndex::SaveIfModified()
+{
+    // The index is copied so that it can be written while SetItemText and the case changes keep updating it
+    shared_ptr<Index> index;
+    Index saved;
+    sys::path catalog;
+    {
+        lock_guard<mutex> guard(lock);
+        if (!current || !current->modified)
+            return;
+        index = current;
+        saved = *current;
+        catalog = catalogPath;
+        current->modified = false;
+        modifiedTicks = 0;
+    }
+    try
+    {
+        Save(SearchIndexFile(catalog), saved);
+    }
+    catch(...)
+    {
+        lock_guard<mutex> guard(lock);
+        if (current == index)
+        {
+            current->modified = true;
+            NoteModified();
+        }
+        throw;
+    }
+}
+
+vector<string> CatalogSearchIndex::Search(const sys::path& catalog, const string& query, size_t offset, size_t limit, size_t& totalMatches)
+{
+    totalMatches = 0;
+    vector<string> results;
+    auto index = Acquire(catalog);
+    vector<string> terms = Tokenize(query);
+    if (!index || terms.empty())
+        return results;
+
+    lock_guard<mutex> guard(lock);
+    unordered_map<uint32_t, int> scores;
+    for (size_t termIndex = 0; termIndex < terms.size(); ++termIndex)
+    {
+        const string& term = terms[termIndex];
+        unordered_map<uint32_t, int> termScores; // an exact word match scores higher than a prefix match
+        for (auto posting = index->postings.lower_bound(term);
+             posting != index->postings.end() && posting->first.compare(0, term.size(), term) == 0;
+             ++posting)
+        {
+            int score = posting->first.size() == term.size() ? 2 : 1;
+            for (auto id : posting->second)
+            {
+                int& best = termScores[id];
+                best = max(best, score);
+            }
+        }
+        if (termIndex == 0)
+        {
+            scores.swap(termScores);
+            continue;
+        }
+        for (auto item = scores.begin(); item != scores.end(); )
+        {
+            auto termScore = termScores.find(item->first);
+            if (termScore == termScores.end())
+                item = scores.erase(item);
+            else
+            {
+                item->second += termScore->second;
+                ++item;
+            }
+        }
+    }
+
+    // Higher score first, then items nearer the top of the catalog (cases before their specimens and images)
+    vector<pair<uint32_t, int>> ranked(scores.begin(), scores.end());
+    auto depth = [&] (uint32_t id) { return count(index->documents[id].path.begin(), index->documents[id].path.end(), '\\'); };
+    sort(ranked.begin(), ranked.end(), [&] (const pair<uint32_t, int>& a, const pair<uint32_t, int>& b) -> bool
+    {
+        if (a.second != b.second)
+            return a.second > b.second;
+        auto depthA = depth(a.first), depthB = depth(b.first);
+        if (depthA != depthB)
+            return depthA < depthB;
+        return index->documents[a.first].path < index->documents[b.first].path;
+    });
+
+    totalMatches = ranked.size();
+    for (size_t i = offset; i < ranked.size() && results.size() < limit; ++i)
+        results.push_back(index->documents[ranked[i].first].path);
+    return results;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <stdint.h>
+#include <filesystem>
+
+/// Summary:
+///   Inverted index of the words in the case, specimen and image names of a catalog
+///   along with the image titles and memos recorded by the host application.
+///   The index is stored in the catalog .config directory. It is loaded, or rebuilt, on the low priority background
+///   worker, and cases created, removed or renamed by the plug-in are applied to it as they happen.
+///   Searches use the last completed index and never wait for a load or a build.
+///   Changes made after the index was loaded are written by the background worker SaveDelayMilliseconds after
+///   the first of them, so a burst of changes results in a single write.
+class CatalogSearchIndex
+{
+public:
+    static const unsigned SaveDelayMilliseconds = 2000;
+
+    struct Document
+    {
+        std::string path;   // relative to the catalog root (e.g. "S12-345\2\7.jpg")
+        std::string text;   // additional text for the item (e.g. the image title and memo)
+    };
+
+    struct Index
+    {
+        Index() : modified(false) {}
+
+        std::vector<Document> documents;
+        std::map<std::string, std::vector<uint32_t>> postings; // word -> sorted document ids
+        std::map<std::string, uint32_t> idByPath;              // lower case path -> document id
+        bool modified;                                         // true if changed since it was saved
+    };
+
+private:
+    // A case created (oldCaseId empty), removed (newCaseId empty) or renamed by the plug-in
+    struct CaseChange
+    {
+        std::string oldCaseId;
+        std::string newCaseId;
+    };
+
+    std::mutex lock;
+    std::string catalogKey;
+    std::tr2::sys::path catalogPath;
+    std::atomic<unsigned> catalogGeneration;         // incremented when another catalog is selected, to cancel its build
+    std::shared_ptr<Index> current;
+    std::map<std::string, std::string> recordedText; // all text recorded by SetItemText, keyed by lower case path
+    std::vector<CaseChange> caseChanges;             // made while the worker has a task, applied to the indexes it produces
+    std::atomic<bool> building;                      // true while a load or build is queued or running
+    bool loadRequested;
+    bool buildRequested;
+    bool buildRunning;
+    ULONGLONG modifiedTicks;                         // when the current index was first changed since it was saved, 0 if it was not
+    bool saveQueued;                                 // true while a save is queued on the worker
+
+    CatalogSearchIndex() : catalogGeneration(0), building(false), loadRequested(false), buildRequested(false), buildRunning(false),
+        modifiedTicks(0), saveQueued(false) {}
+    CatalogSearchIndex(const CatalogSearchIndex&);
+    CatalogSearchIndex& operator = (const CatalogSearchIndex&);
+
+    std::shared_ptr<Index> Acquire(const std::tr2::sys::path& catalog);
+    void SelectCatalog(const std::tr2::sys::path& catalog);
+    void RequestRefresh(bool build);
+    void Refresh();
+    void Install(const std::string& key, const std::shared_ptr<Index>& index);
+    void NoteModified();
+    void RecordCaseChange(const std::tr2::sys::path& catalog, const CaseChange& change);
+    static void ApplyText(Index& index, const std::string& path, const std::string& text);
+    static void ApplyCaseChange(Index& index, const CaseChange& change);
+
+public:
+    static CatalogSearchIndex& Instance();
+
+    /// Summary:
+    ///   Splits text into lower case words made of letters and digits.
+    static std::vector<std::string> Tokenize(const std::string& text);
+
+    /// Summary:
+    ///   Scans the catalog in parallel and creates a new index.
+    /// Arguments:
+    ///   catalog - The path to the root of the catalog
+    ///   itemText - Text to add to items in the new index, keyed by lower case relative path
+    ///   cancel - Polled while scanning. The build stops and throws runtime_error if it returns true.
+    static std::shared_ptr<Index> Build(const std::tr2::sys::path& catalog, const std::map<std::string, std::string>& itemText, const std::function<bool()>& cancel);
+
+    /// Summary:
+    ///   Writes an index. The documents of removed cases are left out and the document ids are renumbered.
+    static void Save(const std::tr2::sys::path& indexFile, const Index& index);
+    static std::shared_ptr<Index> Load(const std::tr2::sys::path& indexFile);
+
+    /// Summary:
+    ///   Starts a rebuild of the index for the catalog on the low priority background worker.
+    /// Returns:
+    ///   False if a build is already in progress.
+    bool ScheduleBuild(const std::tr2::sys::path& catalog);
+
+    /// Returns true while the index is being loaded or built.
+    bool IsBuilding() const { return building; }
+
+    // Updates the index after the plug-in changed the cases in a catalog.
+    // Changes to a catalog other than the one that is indexed are ignored.
+    void OnCaseAdded(const std::tr2::sys::path& catalog, const std::string& caseId);
+    void OnCaseRemoved(const std::tr2::sys::path& catalog, const std::string& caseId);
+    void OnCaseRenamed(const std::tr2::sys::path& catalog, const std::string& oldCaseId, const std::string& newCaseId);
+
+    /// Summary:
+    ///   Queues a save of the index on the low priority background worker if it was first changed at least
+    ///   SaveDelayMilliseconds ago. Returns without waiting for the save, so it may be called from the host's thread.
+    void SaveIfDue();
+
+    /// Summary:
+    ///   Writes the index to the catalog if it was changed since it was last saved.
+    ///   If the write fails the index is saved again after another delay.
+    /// Throws:
+    ///   runtime_error if the index could not be written
+    void SaveIfModified();
+
+    /// Summary:
+    ///   Records the title and memo of an image so that it can be found by a search.
+    /// Arguments:
+    ///   catalog - The path to the root of the catalog
+    ///   item - The full path of the image file
+    ///   text - The text to associate to the image
+    void SetItemText(const std::tr2::sys::path& catalog, const std::tr2::sys::path& item, const std::string& text);
+
+    /// Summary:
+    ///   Finds the items that contain every word in the query. A query word matches any indexed word that starts with it.
+    ///   Results are ranked by the number of exact word matches, then by path.
+    /// Arguments:
+    ///   catalog - The path to the root of the catalog
+    ///   query - The words to search for
+    ///   offset, limit - The page of results to return
+    ///   totalMatches - Set to the total number of matching items
+    /// Returns:
+    ///   The paths of the matching items relative to the catalog root
+    std::vector<std::string> Search(const std::tr2::sys::path& catalog, const std::string& query, size_t offset, size_t limit, size_t& totalMatches);
+};
@@ -4,45 +4,59 @@
 #include <vector>
 #include <fstream>
 #include <filesystem>
+#include <string.h>
+#include "MappedFile.h"
 
 const char InvalidFilePathChars[] = {'\\', '/', ':', '*', '?', '"', '<', '>', '|'}; 
 
 
 /// Summary:
-/// Reads the entire contents of a file in text mode into a string.
+/// Reads the entire contents of a file in text mode into a string. "\r\n" line endings are read as "\n".
 /// Arg:
 ///     fileName - The path to the file to read
 /// Returns:
 ///     A string containing the contents of the file
+/// Throws:
+///     runtime_error if the file could not be read
 inline std::string ReadFileToString(const std::string& fileName)
 {
-    std::ifstream file;
-    file.exceptions(std::ifstream::failbit | std::ifstream::badbit );
-    file.open(fileName);
-    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    MappedFile file(fileName);
+    const char* next = file.Data();
+    const char* end = next + file.Size();
+    std::string contents;
+    contents.reserve(file.Size());
+    while (next != end)
+    {
+        const char* cr = static_cast<const char*>(memchr(next, '\r', end - next));
+        if (!cr)
+        {
+            contents.append(next, end);
+            break;
+        }
+        contents.append(next, cr);
+        if (cr + 1 == end || cr[1] != '\n')
+            contents.push_back('\r');
+        next = cr + 1;
+    }
+    return contents;
 }
 
 /// Summary:
 /// Reads the entire contents of a file and places each line of text into its own string.
+/// Use MappedFile::Lines or MappedFile::ForEachLine to read the lines without copying them.
 /// Arg:
 ///     fileName - The path to the file to read
 /// Returns:
 ///     vector<string> containing each line of the file. The order of the strings in the vector are the same as were in the file.
+///     The vector is empty if the file could not be opened.
 inline std::vector<std::string> ReadFileToStrings(const std::string& fileName)
 {
-    using std::getline;
-
-    std::ifstream file;
-    file.exceptions(std::ifstream::badbit);
-    file.open(fileName);
     std::vector<std::string> lines;
-    while (file)
-    {
-        std::string newLine;
-        std::getline(file, newLine);
-        if (file || !newLine.empty())
-            lines.push_back(std::move(newLine));
-    }
+    MappedFile file;
+    if (!file.Open(fileName))
+        return lines;
+    for (auto line : file.Lines())
+        lines.push_back(std::string(line.begin(), line.end()));
     return lines;
 }
 
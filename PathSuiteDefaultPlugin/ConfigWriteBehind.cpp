@@ -0,0 +1,182 @@
+#include "stdafx.h"
+#include <chrono>
+#include <boost/property_tree/json_parser.hpp>
+#include "CatalogFiles.h"
+#include "ConfigWriteBehind.h"
+
+using namespace std;
+using namespace std::tr2;
+using boost::property_tree::ptree;
+
+void WriteFileAtomically(const sys::path& fileName, const string& contents)
+{
+    // GetTempFileName creates an empty file with a name no other writer has in the directory
+    char tempName[MAX_PATH];
+    string directory = fileName.parent_path().empty() ? "." : fileName.parent_path().string();
+    if (!GetTempFileNameA(directory.c_str(), "cfg", 0, tempName))
+        throw runtime_error("Unable to create a temporary file in " + directory + " (error " + to_string(GetLastError()) + ")");
+    string tempFile = tempName;
+    HANDLE file = CreateFileA(tempFile.c_str(), GENERIC_WRITE, 0, NULL, TRUNCATE_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (INVALID_HANDLE_VALUE == file)
+    {
+        DWORD error = GetLastError();
+        DeleteFileA(tempFile.c_str());
+        throw runtime_error("Unable to create " + tempFile + " (error " + to_string(error) + ")");
+    }
+    DWORD written = 0;
+    BOOL success = WriteFile(file, contents.data(), static_cast<DWORD>(contents.size()), &written, NULL) &&
+                   written == contents.size() &&
+                   FlushFileBuffers(file);
+    DWORD error = GetLastError();
+    CloseHandle(file);
+    if (!success || !MoveFileExA(tempFile.c_str(), fileName.string().c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        if (success)
+            error = GetLastError();
+        DeleteFileA(tempFile.c_str());
+        throw runtime_error("Unable to write " + fileName.string() + " (error " + to_string(error) + ")");
+    }
+}
+
+ConfigWriteBehind& ConfigWriteBehind::Instance()
+{
+    static ConfigWriteBehind writer;
+    return writer;
+}
+
+ConfigWriteBehind::~ConfigWriteBehind()
+{
+    Stop();
+}
+
+void ConfigWriteBehind::Save(const sys::path& fileName, const ptree& document)
+{
+    lock_guard<mutex> guard(lock);
+    string key = NormalizedPathKey(fileName);
+    auto item = pending.find(key);
+    if (item != pending.end())
+    {
+        item->second.document = document;
+        ++item->second.version;
+        item->second.failures = 0;
+        return;
+    }
+    PendingDocument& added = pending[key];
+    added.fileName = fileName;
+    added.document = document;
+    added.firstChanged = GetTickCount64();
+    added.version = 0;
+    added.failures = 0;
+    if (timer.joinable())
+        timerWake.notify_all();
+    else
+    {
+        stopping = false;
+        timer = thread(&ConfigWriteBehind::RunTimer, this);
+    }
+}
+
+bool ConfigWriteBehind::TryGetPending(const sys::path& fileName, ptree& document)
+{
+    lock_guard<mutex> guard(lock);
+    auto item = pending.find(NormalizedPathKey(fileName));
+    if (item == pending.end())
+        return false;
+    document = item->second.document;
+    return true;
+}
+
+void ConfigWriteBehind::FlushWhere(bool onlyDue)
+{
+    lock_guard<mutex> flushGuard(flushLock);
+    vector<pair<string, PendingDocument>> toWrite;
+    {
+        lock_guard<mutex> guard(lock);
+        ULONGLONG now = GetTickCount64();
+        for (auto& item : pending)
+        {
+            if (!onlyDue || now - item.second.firstChanged >= FlushDelayMilliseconds)
+                toWrite.push_back(item);
+        }
+    }
+
+    // Documents stay queued while they are written so reads never see the file's older contents
+    for (auto& item : toWrite)
+    {
+        const PendingDocument& document = item.second;
+        bool written = false;
+        try
+        {
+            ostringstream json;
+            boost::property_tree::write_json(json, document.document);
+            WriteFileAtomically(document.fileName, json.str());
+            written = true;
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugStringA(ex.what());
+        }
+        lock_guard<mutex> guard(lock);
+        auto queued = pending.find(item.first);
+        if (queued == pending.end() || queued->second.version != document.version)
+            continue; // saved again while it was written. The newer contents are written by a later flush.
+        if (written)
+            pending.erase(queued);
+        else if (++queued->second.failures >= MaxWriteAttempts)
+        {
+            OutputDebugStringA(("Gave up writing " + document.fileName.string() + " after " + to_string(queued->second.failures) + " attempts").c_str());
+            pending.erase(queued);
+        }
+        else
+            queued->second.firstChanged = GetTickCount64(); // try again after another delay
+    }
+}
+
+void ConfigWriteBehind::FlushDue()
+{
+    lock_guard<mutex> guard(lock);
+    timerWake.notify_all();
+}
+
+void ConfigWriteBehind::Flush()
+{
+    FlushWhere(false);
+}
+
+void ConfigWriteBehind::Stop()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+        timerWake.notify_all();
+    }
+    if (timer.joinable())
+        timer.join();
+    Flush();
+}
+
+void ConfigWriteBehind::RunTimer()
+{
+    unique_lock<mutex> guard(lock);
+    while (!stopping)
+    {
+        if (pending.empty())
+        {
+            timerWake.wait(guard);
+            continue;
+        }
+        ULONGLONG nextDue = pending.begin()->second.firstChanged;
+        for (auto& item : pending)
+            nextDue = min(nextDue, item.second.firstChanged);
+        nextDue += FlushDelayMilliseconds;
+        ULONGLONG now = GetTickCount64();
+        if (now < nextDue)
+        {
+            timerWake.wait_for(guard, chrono::milliseconds(nextDue - now));
+            continue;
+        }
+        guard.unlock();
+        FlushWhere(true);
+        guard.lock();
+    }
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <condition_variable>
+#include <filesystem>
+#include <boost/property_tree/ptree.hpp>
+
+/// Summary:
+///   Replaces a file with new contents so that readers, and the file after a crash, have either the
+///   old or the new contents and never a partial write. The contents are written to a temporary file
+///   with a unique name in the same directory, flushed to disk and then renamed over the original.
+///   Writers in other processes, or on other workstations sharing the catalog, never write the same temporary file.
+/// Throws:
+///   runtime_error if the file could not be written
+void WriteFileAtomically(const std::tr2::sys::path& fileName, const std::string& contents);
+
+/// Summary:
+///   Delays and combines the writes of catalog configuration documents.
+///   A saved document is kept in memory and written FlushDelayMilliseconds after it first changed,
+///   so a burst of changes to the same document results in a single write of its final contents.
+///   Reads of a document that has not been written yet are answered from memory.
+///   Documents are written with WriteFileAtomically by a timer thread, or when Flush is called.
+///   A document that fails to be written is tried again after another delay. After MaxWriteAttempts
+///   failures in a row it is dropped and reported to the debug output, and reads see the file again.
+class ConfigWriteBehind
+{
+public:
+    static const unsigned FlushDelayMilliseconds = 2000;
+    static const unsigned MaxWriteAttempts = 5;
+
+private:
+    struct PendingDocument
+    {
+        std::tr2::sys::path fileName;
+        boost::property_tree::ptree document;
+        ULONGLONG firstChanged; // GetTickCount64, which unlike the VS2012 steady_clock is not changed with the system time
+        unsigned version;   // Incremented by each Save so a flush can tell if the document changed while it was written
+        unsigned failures;  // Failed writes since the last Save
+    };
+
+    std::mutex lock;
+    std::mutex flushLock;   // Only one flush writes files at a time so an older document can not replace a newer one
+    std::unordered_map<std::string, PendingDocument> pending; // keyed by the normalized file name
+    std::thread timer;
+    std::condition_variable timerWake;
+    bool stopping;
+
+    ConfigWriteBehind() : stopping(false) {}
+    ConfigWriteBehind(const ConfigWriteBehind&);
+    ConfigWriteBehind& operator = (const ConfigWriteBehind&);
+
+    void FlushWhere(bool onlyDue);
+    void RunTimer();
+
+public:
+    ~ConfigWriteBehind();
+
+    static ConfigWriteBehind& Instance();
+
+    /// Summary:
+    ///   Queues a document to be written. It replaces any queued contents of the same file.
+    void Save(const std::tr2::sys::path& fileName, const boost::property_tree::ptree& document);
+
+    /// Summary:
+    ///   Gets the queued contents of a file.
+    /// Returns:
+    ///   False if there are no queued contents and the file should be read instead
+    bool TryGetPending(const std::tr2::sys::path& fileName, boost::property_tree::ptree& document);
+
+    /// Summary:
+    ///   Wakes the timer thread to write the documents that have waited at least FlushDelayMilliseconds.
+    ///   Returns without waiting for the writes, so it may be called from the host's thread.
+    void FlushDue();
+
+    /// Summary:
+    ///   Writes all queued documents and waits until they are written.
+    void Flush();
+
+    /// Summary:
+    ///   Writes all queued documents and stops the timer. Documents saved later start the timer again.
+    void Stop();
+};
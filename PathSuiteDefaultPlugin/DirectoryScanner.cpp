@@ -0,0 +1,104 @@
+#include "stdafx.h"
+#include <system_error>
+#include "DirectoryScanner.h"
+
+using namespace std;
+using namespace std::tr2;
+
+namespace
+{
+    // Windows 7 and later. The SDK only declares these when targeting Windows 7.
+    const FINDEX_INFO_LEVELS FindInfoBasic = static_cast<FINDEX_INFO_LEVELS>(1);   // FindExInfoBasic, skips the 8.3 short name
+    const DWORD FindLargeFetch = 2;                                                 // FIND_FIRST_EX_LARGE_FETCH
+
+    volatile bool basicFindSupported = true;
+
+    HANDLE FindFirst(const sys::path& directory, WIN32_FIND_DATAA& findData)
+    {
+        string pattern = (directory / sys::path("*")).string();
+        if (basicFindSupported)
+        {
+            HANDLE find = FindFirstFileExA(pattern.c_str(), FindInfoBasic, &findData, FindExSearchNameMatch, NULL, FindLargeFetch);
+            if (find != INVALID_HANDLE_VALUE || GetLastError() != ERROR_INVALID_PARAMETER)
+                return find;
+            basicFindSupported = false; // Windows XP and Vista
+        }
+        return FindFirstFileExA(pattern.c_str(), FindExInfoStandard, &findData, FindExSearchNameMatch, NULL, 0);
+    }
+}
+
+DirectoryScanner::DirectoryScanner(const sys::path& directory) :
+    directoryName(directory.string()), error(ERROR_SUCCESS)
+{
+    find = FindFirst(directory, findData);
+    hasData = find != INVALID_HANDLE_VALUE;
+    if (!hasData)
+    {
+        DWORD findError = GetLastError();
+        if (findError != ERROR_FILE_NOT_FOUND && findError != ERROR_PATH_NOT_FOUND)
+            error = findError;
+    }
+}
+
+DirectoryScanner::~DirectoryScanner()
+{
+    if (find != INVALID_HANDLE_VALUE)
+        FindClose(find);
+}
+
+bool DirectoryScanner::Next(DirectoryEntry& entry)
+{
+    while (hasData)
+    {
+        const char* name = findData.cFileName;
+        bool isDotEntry = name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+        if (!isDotEntry)
+        {
+            entry.name = name;
+            entry.isDirectory = (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+            entry.size = entry.isDirectory ? 0 : (static_cast<uint64_t>(findData.nFileSizeHigh) << 32) | findData.nFileSizeLow;
+            entry.writeTime = findData.ftLastWriteTime;
+        }
+        hasData = FindNextFileA(find, &findData) != FALSE;
+        if (!hasData)
+        {
+            DWORD nextError = GetLastError();
+            if (nextError != ERROR_NO_MORE_FILES)
+                error = nextError;
+        }
+        if (!isDotEntry)
+            return true;
+    }
+    return false;
+}
+
+void DirectoryScanner::ThrowIfFailed() const
+{
+    if (error != ERROR_SUCCESS)
+        throw system_error(static_cast<int>(error), system_category(), "Unable to list the directory " + directoryName);
+}
+
+vector<DirectoryEntry> DirectoryScanner::List(const sys::path& directory)
+{
+    vector<DirectoryEntry> entries;
+    DirectoryScanner scanner(directory);
+    DirectoryEntry entry;
+    while (scanner.Next(entry))
+        entries.push_back(entry);
+    scanner.ThrowIfFailed();
+    return entries;
+}
+
+vector<string> DirectoryScanner::ListDirectories(const sys::path& directory)
+{
+    vector<string> names;
+    DirectoryScanner scanner(directory);
+    DirectoryEntry entry;
+    while (scanner.Next(entry))
+    {
+        if (entry.isDirectory)
+            names.push_back(entry.name);
+    }
+    scanner.ThrowIfFailed();
+    return names;
+}
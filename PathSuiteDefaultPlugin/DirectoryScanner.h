@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <filesystem>
+
+/// Summary:
+///   An entry of a directory listing with the details the file system returns in the listing itself.
+struct DirectoryEntry
+{
+    std::string name;
+    bool isDirectory;
+    uint64_t size;          // Zero for directories
+    FILETIME writeTime;
+};
+
+/// Summary:
+///   Reads the entries of a directory with their type, size and last write time.
+///   The details come from the directory listing, which the file system returns many entries at a time.
+///   Testing each entry with sys::is_directory or sys::file_size costs a separate request per entry,
+///   which is a network round trip for catalogs on a file share.
+///   The "." and ".." entries are skipped. A directory that is missing has no entries.
+///   Any other failure to read the directory (e.g. access denied or a share that went offline) ends the
+///   listing and is kept in Error(), so a partial listing is never mistaken for the whole directory.
+class DirectoryScanner
+{
+    std::string directoryName;
+    HANDLE find;
+    WIN32_FIND_DATAA findData;
+    bool hasData;   // findData holds an entry that has not been returned yet
+    DWORD error;
+
+    DirectoryScanner(const DirectoryScanner&);
+    DirectoryScanner& operator = (const DirectoryScanner&);
+
+public:
+    explicit DirectoryScanner(const std::tr2::sys::path& directory);
+    ~DirectoryScanner();
+
+    /// Summary:
+    ///   Reads the next entry.
+    /// Returns:
+    ///   False when there are no more entries
+    bool Next(DirectoryEntry& entry);
+
+    /// The Win32 error that ended the listing early. ERROR_SUCCESS if the listing is complete.
+    DWORD Error() const { return error; }
+
+    bool Failed() const { return error != ERROR_SUCCESS; }
+
+    /// Throws:
+    ///   system_error if the listing ended early because of an error
+    void ThrowIfFailed() const;
+
+    /// Summary:
+    ///   Returns all the entries of a directory in the order the file system lists them.
+    /// Throws:
+    ///   system_error if the directory exists but cannot be read completely
+    static std::vector<DirectoryEntry> List(const std::tr2::sys::path& directory);
+
+    /// Summary:
+    ///   Returns the names of the subdirectories of a directory in the order the file system lists them.
+    /// Throws:
+    ///   system_error if the directory exists but cannot be read completely
+    static std::vector<std::string> ListDirectories(const std::tr2::sys::path& directory);
+};
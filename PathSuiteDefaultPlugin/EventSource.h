@@ -2,6 +2,7 @@
 #include "SpotPlugin.h"
 #include "PluginHost.h"
 #include "MulticastEventDelegate.h"
+#include "StallWatchdog.h"
 #include <functional>
 
 
@@ -32,8 +33,12 @@ private:
 
     void HandleEvent(uintptr_t rawArgs)
     {
+        StallWatchdog::CallScope scope(StallWatchdog::CallKind::Event, targetEvent);
         auto realArg = argTransformFunc(rawArgs);
-        eventDelegate(realArg);
+        eventDelegate.Invoke(realArg, [](const EventDelegate<arg_type>& d)
+        {
+            StallWatchdog::Instance().EnterDelegate(&d, typeid(d));
+        });
     }
 
 
@@ -0,0 +1,73 @@
+#include "stdafx.h"
+#include <atomic>
+#include <thread>
+#include "FileOperationBatch.h"
+
+using namespace std;
+using namespace std::tr2;
+
+FileOperationBatch::FileOperationBatch(size_t queueDepth) : queueDepth(max(queueDepth, size_t(1)))
+{
+}
+
+void FileOperationBatch::Add(OperationType type, const sys::path& source, const sys::path& target)
+{
+    Operation operation;
+    operation.type = type;
+    operation.source = source;
+    operation.target = target;
+    operation.error = ERROR_SUCCESS;
+    operations.push_back(operation);
+}
+
+void FileOperationBatch::AddRename(const sys::path& source, const sys::path& target)
+{
+    Add(Rename, source, target);
+}
+
+void FileOperationBatch::AddDelete(const sys::path& file)
+{
+    Add(Delete, file, sys::path());
+}
+
+DWORD FileOperationBatch::Run(const Operation& operation)
+{
+    BOOL success = FALSE;
+    switch (operation.type)
+    {
+    case Rename:
+        success = MoveFileExA(operation.source.string().c_str(), operation.target.string().c_str(), 0);
+        break;
+    case Delete:
+        SetFileAttributesA(operation.source.string().c_str(), FILE_ATTRIBUTE_NORMAL);
+        success = DeleteFileA(operation.source.string().c_str());
+        break;
+    }
+    return success ? ERROR_SUCCESS : GetLastError();
+}
+
+size_t FileOperationBatch::Execute(const function<bool()>& cancel)
+{
+    atomic<size_t> next(0);
+    atomic<size_t> failed(0);
+    auto worker = [&] ()
+    {
+        for (size_t index = next++; index < operations.size(); index = next++)
+        {
+            Operation& operation = operations[index];
+            operation.error = (cancel && cancel()) ? ERROR_CANCELLED : Run(operation);
+            if (operation.error != ERROR_SUCCESS)
+                ++failed;
+        }
+    };
+
+    // The calling thread is one of the workers
+    vector<thread> workers;
+    size_t workerCount = min(queueDepth, operations.size());
+    for (size_t count = 1; count < workerCount; ++count)
+        workers.push_back(thread(worker));
+    worker();
+    for (auto& workerThread : workers)
+        workerThread.join();
+    return failed;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <filesystem>
+
+/// Summary:
+///   Runs many independent file system operations with several of them in flight at once.
+///   Renames and deletes spend nearly all their time waiting on the disk or, for a catalog on a
+///   file share, on a network round trip. Keeping queueDepth requests outstanding hides most of that wait.
+///   The operations must not depend on each other because they complete in no particular order.
+class FileOperationBatch
+{
+public:
+    enum OperationType
+    {
+        Rename,
+        Delete      // a file, including one that is read only
+    };
+
+    struct Operation
+    {
+        OperationType type;
+        std::tr2::sys::path source;
+        std::tr2::sys::path target;     // The new name of a Rename
+        DWORD error;                    // After Execute, ERROR_SUCCESS or the reason the operation failed
+    };
+
+    static const size_t DefaultQueueDepth = 16;
+
+private:
+    std::vector<Operation> operations;
+    size_t queueDepth;
+
+    FileOperationBatch(const FileOperationBatch&);
+    FileOperationBatch& operator = (const FileOperationBatch&);
+
+    void Add(OperationType type, const std::tr2::sys::path& source, const std::tr2::sys::path& target);
+    static DWORD Run(const Operation& operation);
+
+public:
+    /// Arguments:
+    ///   queueDepth - The maximum number of operations in flight at once. One runs the operations in order.
+    explicit FileOperationBatch(size_t queueDepth = DefaultQueueDepth);
+
+    /// Adds a rename. It fails if the target already exists.
+    void AddRename(const std::tr2::sys::path& source, const std::tr2::sys::path& target);
+
+    void AddDelete(const std::tr2::sys::path& file);
+
+    size_t Size() const { return operations.size(); }
+
+    const std::vector<Operation>& Operations() const { return operations; }
+
+    /// Summary:
+    ///   Runs all the operations and waits for them to finish.
+    /// Arguments:
+    ///   cancel - Optional. Polled before each operation is started. Operations not started fail with ERROR_CANCELLED.
+    /// Returns:
+    ///   The number of operations that failed
+    size_t Execute(const std::function<bool()>& cancel = std::function<bool()>());
+};
@@ -232,6 +232,17 @@ namespace internal // implementation specific namespace not for general usage
             return GetTextVariable(name);
         }
 
+        // Reads a text argument that may be longer than the default read length (e.g. a list of items)
+        template<size_t MaxReadLength>
+        static std::string Text(int index)
+        {
+            static char name[] = "_argT*";
+            if (index <= 0 || index > 5)
+                throw std::logic_error("invalid macro stack index");
+            name[5] = '0' + index;
+            return GetTextVariable<MaxReadLength>(name);
+        }
+
         static bool Bool(int index)
         {
             static char name[] = "_argB*";
@@ -298,8 +309,104 @@ namespace internal // implementation specific namespace not for general usage
         }
     };
 
+    //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    /// Summary:
+    ///     Maps a C++ type to the host variable type and the host message that reads and writes it.
+    ///     Integer variables are numeric variables on the host.
+    template<typename T>
+    struct VariableTraits;
+
+    template<>
+    struct VariableTraits<bool>
+    {
+        static const VariableType type = VariableType::Bool;
+        static bool Get(const char* name) { return GetBoolVariable(name); }
+        static void Set(const char* name, bool value) { SetBoolVariable(name, value); }
+    };
+
+    template<>
+    struct VariableTraits<int>
+    {
+        static const VariableType type = VariableType::Integer;
+        static int Get(const char* name) { return static_cast<int>(GetNumericVariable(name)); }
+        static void Set(const char* name, int value) { SetNumericVariable(name, value); }
+    };
+
+    template<>
+    struct VariableTraits<double>
+    {
+        static const VariableType type = VariableType::Numeric;
+        static double Get(const char* name) { return GetNumericVariable(name); }
+        static void Set(const char* name, double value) { SetNumericVariable(name, value); }
+    };
+
+    template<>
+    struct VariableTraits<std::string>
+    {
+        static const VariableType type = VariableType::Text;
+        static std::string Get(const char* name) { return GetTextVariable(name); }
+        static void Set(const char* name, const std::string& value) { SetTextVariable(name, value); }
+    };
+
+    /// The access of a VarRef
+    struct ReadOnly  { static const bool readOnly = true; };
+    struct ReadWrite { static const bool readOnly = false; };
+
+namespace internal
+{
+    // True if a value of type U may be written to a variable of type T without changing its kind.
+    // Numbers convert between int and double, but not to or from bool.
+    template<typename T, typename U>
+    struct AcceptsValue : std::integral_constant<bool, std::is_arithmetic<U>::value && !std::is_same<U, bool>::value> {};
+
+    template<typename U>
+    struct AcceptsValue<bool, U> : std::is_same<U, bool> {};
+
+    template<typename U>
+    struct AcceptsValue<std::string, U> : std::is_convertible<const U&, std::string> {};
+} // end namespace internal
+
+    /// Summary:
+    ///     A handle to a host variable whose name, type and access are fixed at compile time.
+    ///     Reads and writes call the host directly, without a variable object, virtual calls or a lookup by name.
+    ///     Writing a read only variable or writing a value of another kind does not compile.
+    ///     Declare handles with the HOST_VARIABLE macro.
+    /// Template Arguments:
+    ///     NameTag - A type with a static Name() function that returns the host name of the variable
+    ///     T       - bool, int, double or std::string
+    ///     Access  - ReadOnly or ReadWrite
+    template<typename NameTag, typename T, typename Access = ReadWrite>
+    struct VarRef
+    {
+        typedef T value_type;
+        static const VariableType type = VariableTraits<T>::type;
+        static const bool readOnly = Access::readOnly;
+
+        static const char* Name() { return NameTag::Name(); }
+
+        /// Throws:
+        ///     runtime_error if unable to get the variable value
+        static T Value() { return VariableTraits<T>::Get(NameTag::Name()); }
+
+        /// Throws:
+        ///     runtime_error if unable to set the variable value
+        template<typename U>
+        static void Value(const U& value)
+        {
+            static_assert(!Access::readOnly, "The host variable is read only");
+            static_assert(internal::AcceptsValue<T, U>::value, "The value does not match the type of the host variable");
+            VariableTraits<T>::Set(NameTag::Name(), value);
+        }
+    };
+
 } // end namespace HostInterop
 
+/// Declares a HostInterop::VarRef named Identifier for the host variable HostName.
+/// Access is ReadOnly or ReadWrite.
+#define HOST_VARIABLE(Identifier, HostName, Type, Access) \
+    struct Identifier##_name { static const char* Name() { return HostName; } }; \
+    typedef HostInterop::VarRef<Identifier##_name, Type, HostInterop::Access> Identifier;
+
 struct var_script_item_t  { bool readonly; const char* szName; HostInterop::VariableType type; HostInterop::ScopeFlags scope; };
 
 //~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
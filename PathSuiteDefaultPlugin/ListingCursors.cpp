@@ -0,0 +1,113 @@
+#include "stdafx.h"
+#include "ListingCursors.h"
+#include "DirectoryScanner.h"
+
+using namespace std;
+using namespace std::tr2;
+
+ListingCursors& ListingCursors::Instance()
+{
+    static ListingCursors listingCursors;
+    return listingCursors;
+}
+
+void ListingCursors::CloseExpired()
+{
+    time_t now = time(nullptr);
+    for (auto item = cursors.begin(); item != cursors.end(); )
+    {
+        if (now - item->second.lastUsed > IdleSeconds)
+            item = cursors.erase(item);
+        else
+            ++item;
+    }
+    while (cursors.size() >= MaxOpenCursors)
+    {
+        auto oldest = min_element(cursors.begin(), cursors.end(), [] (const pair<const string, Cursor>& a, const pair<const string, Cursor>& b)
+        {
+            return a.second.lastUsed < b.second.lastUsed;
+        });
+        cursors.erase(oldest);
+    }
+}
+
+string ListingCursors::Open(const source_t& source)
+{
+    CloseExpired();
+    string token = "LC" + to_string(nextId++) + "-" + to_string(GetTickCount() & 0xFFFF);
+    Cursor& cursor = cursors[token];
+    cursor.source = source;
+    cursor.hasNext = cursor.source(cursor.next);
+    cursor.lastUsed = time(nullptr);
+    return token;
+}
+
+bool ListingCursors::Read(const string& token, size_t limit, vector<string>& page)
+{
+    auto item = cursors.find(token);
+    if (item == cursors.end())
+        return false;
+    Cursor& cursor = item->second;
+    while (cursor.hasNext && page.size() < limit)
+    {
+        page.push_back(move(cursor.next));
+        cursor.hasNext = cursor.source(cursor.next);
+    }
+    if (!cursor.hasNext)
+    {
+        cursors.erase(item);
+        return false;
+    }
+    cursor.lastUsed = time(nullptr);
+    return true;
+}
+
+void ListingCursors::Close(const string& token)
+{
+    cursors.erase(token);
+}
+
+ListingCursors::source_t ListingCursors::FromList(const vector<string>& items)
+{
+    auto list = make_shared<vector<string>>(items);
+    auto position = make_shared<size_t>(0);
+    return [list, position] (string& item) -> bool
+    {
+        if (*position >= list->size())
+            return false;
+        item = (*list)[(*position)++];
+        return true;
+    };
+}
+
+ListingCursors::source_t ListingCursors::FromDirectory(const sys::path& directory, const function<bool(const DirectoryEntry&)>& predicate)
+{
+    struct Batches
+    {
+        Batches(const sys::path& directory) : scanner(directory), next(0) {}
+        DirectoryScanner scanner;
+        vector<string> batch;   // sorted like the plain listings
+        size_t next;
+    };
+    auto state = make_shared<Batches>(directory);
+    return [state, predicate] (string& item) -> bool
+    {
+        if (state->next == state->batch.size())
+        {
+            state->batch.clear();
+            state->next = 0;
+            DirectoryEntry entry;
+            while (state->batch.size() < SortBatchSize && state->scanner.Next(entry))
+            {
+                if (predicate(entry))
+                    state->batch.push_back(entry.name);
+            }
+            state->scanner.ThrowIfFailed();
+            if (state->batch.empty())
+                return false;
+            sort(state->batch.begin(), state->batch.end());
+        }
+        item = move(state->batch[state->next++]);
+        return true;
+    };
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+#include <functional>
+#include <filesystem>
+
+struct DirectoryEntry;
+
+/// Summary:
+///   Holds the state of listings that are read one page at a time.
+///   A listing is opened with a source of items and is identified by an opaque token that the
+///   macro passes back to read each page. Items are only produced as pages are read so the first
+///   page is available without enumerating the whole listing.
+///   Cursors that are not read for IdleSeconds, or the least recently used cursor when more than
+///   MaxOpenCursors are open, are closed automatically.
+///   This object is not thread safe. It is only used from the host UI thread.
+class ListingCursors
+{
+public:
+    /// Produces the next item of a listing. Returns false when there are no more items.
+    typedef std::function<bool(std::string&)> source_t;
+
+    static const size_t MaxOpenCursors = 32;
+    static const size_t SortBatchSize = 1024;
+    static const time_t IdleSeconds = 10 * 60;
+
+private:
+    struct Cursor
+    {
+        source_t source;
+        std::string next;   // the item that will start the next page
+        bool hasNext;
+        time_t lastUsed;
+    };
+
+    std::map<std::string, Cursor> cursors; // keyed by token
+    unsigned nextId;
+
+    ListingCursors() : nextId(1) {}
+    ListingCursors(const ListingCursors&);
+    ListingCursors& operator = (const ListingCursors&);
+
+    void CloseExpired();
+
+public:
+    static ListingCursors& Instance();
+
+    /// Summary:
+    ///   Opens a cursor over a listing.
+    /// Returns:
+    ///   The token of the cursor
+    std::string Open(const source_t& source);
+
+    /// Summary:
+    ///   Reads the next page of a listing. The cursor is closed when the last item is read.
+    /// Arguments:
+    ///   token - The token returned by Open
+    ///   limit - The maximum number of items to read
+    ///   page - Receives the items
+    /// Returns:
+    ///   True if more items remain. False if the listing is exhausted or the token is unknown or expired.
+    bool Read(const std::string& token, size_t limit, std::vector<std::string>& page);
+
+    /// Summary:
+    ///   Closes a cursor before the end of its listing. Unknown tokens are ignored.
+    void Close(const std::string& token);
+
+    /// Summary:
+    ///   Creates a source that returns the items of a list in order.
+    static source_t FromList(const std::vector<std::string>& items);
+
+    /// Summary:
+    ///   Creates a source that returns the names of the entries of a directory that satisfy a predicate.
+    ///   The entries are read SortBatchSize at a time and each batch is sorted like the plain and page listings,
+    ///   so a directory with up to SortBatchSize matching entries is listed in exactly their order.
+    ///   A larger directory is only sorted within each batch. NTFS lists names in nearly the same order,
+    ///   apart from the case of letters and a few punctuation characters, so such batches rarely overlap.
+    /// Arguments:
+    ///   directory - The directory to list
+    ///   predicate - Called with each entry. The entry includes its type so no further file system access is needed.
+    static source_t FromDirectory(const std::tr2::sys::path& directory, const std::function<bool(const DirectoryEntry&)>& predicate);
+};
@@ -0,0 +1,219 @@
+#include "stdafx.h"
+#include <iomanip>
+#include "LiveVideoMonitor.h"
+#include "StandardHostVariables.h"
+#include "PathSuiteHostVars.h"
+
+using namespace std;
+
+namespace
+{
+    // Frames beyond this many in a single tick are counted but not added to the window
+    const int MaxFramesPerTick = 1000;
+
+    int64_t PerformanceCounterMicroseconds()
+    {
+        static LARGE_INTEGER frequency;
+        if (frequency.QuadPart == 0)
+            QueryPerformanceFrequency(&frequency);
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return (counter.QuadPart / frequency.QuadPart) * 1000000 + (counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+    }
+
+    // The value at a fraction of the way through sorted values
+    double Percentile(const vector<int64_t>& sorted, double fraction)
+    {
+        return sorted[static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5)] / 1000.0;
+    }
+}
+
+LiveVideoMonitor::LiveVideoMonitor(clock_func_t clock) :
+    clock(clock), enabled(false), publishFailed(false), readFailed(false), nextReadTime(0), lastCount(0), lastFrameTime(0), startTime(0), lastPublishTime(0), lastSummaryTime(0), expectedInterval(0)
+{
+}
+
+LiveVideoMonitor& LiveVideoMonitor::Instance()
+{
+    static LiveVideoMonitor monitor(PerformanceCounterMicroseconds);
+    return monitor;
+}
+
+void LiveVideoMonitor::Sample()
+{
+    if (!enabled)
+        return;
+    int64_t now = clock();
+    if (!stats.running && now < nextReadTime)
+        return;
+    bool running = false;
+    int frameCount = 0;
+    try
+    {
+        running = StdVars::LiveImgRunning::Value();
+        frameCount = running ? StdVars::LiveImgCount::Value() : 0;
+        readFailed = false;
+    }
+    catch(const std::exception& ex)
+    {
+        if (!readFailed)
+            OutputDebugString(ex.what());
+        readFailed = true;
+        nextReadTime = now + ReadRetryMicroseconds;
+        if (stats.running)
+            End(now);
+        return;
+    }
+    if (!running)
+        nextReadTime = now + RunningCheckIntervalMicroseconds;
+    Sample(running, frameCount);
+}
+
+void LiveVideoMonitor::Sample(bool running, int frameCount)
+{
+    if (!enabled)
+        return;
+    int64_t now = clock();
+    if (!stats.running)
+    {
+        if (running)
+            Begin(now, frameCount);
+        return;
+    }
+    if (!running || frameCount < lastCount)
+    {
+        // The count goes back when the live video is restarted between ticks
+        End(now);
+        if (running)
+            Begin(now, frameCount);
+        return;
+    }
+    if (frameCount > lastCount)
+    {
+        AddFrames(now, frameCount - lastCount);
+        lastCount = frameCount;
+    }
+    if (now - lastPublishTime >= PublishIntervalMicroseconds)
+    {
+        UpdateStats(now);
+        Publish();
+        lastPublishTime = now;
+    }
+    if (now - lastSummaryTime >= SummaryIntervalMicroseconds)
+    {
+        WriteSummary("Live video");
+        lastSummaryTime = now;
+    }
+}
+
+void LiveVideoMonitor::Enable(bool enable)
+{
+    if (!enable && stats.running)
+        End(clock());
+    enabled = enable;
+}
+
+void LiveVideoMonitor::Begin(int64_t now, int count)
+{
+    stats = LiveVideoStats();
+    stats.running = true;
+    lastCount = count;
+    lastFrameTime = now;
+    startTime = lastPublishTime = lastSummaryTime = now;
+    expectedInterval = 0;
+    window.clear();
+    publishFailed = false;
+    Publish();
+}
+
+void LiveVideoMonitor::End(int64_t now)
+{
+    UpdateStats(now);
+    stats.running = false;
+    Publish();
+    WriteSummary("Live video stopped");
+}
+
+void LiveVideoMonitor::AddFrames(int64_t now, int newFrames)
+{
+    // The first frame only marks the time the frames started to arrive
+    if (stats.frames == 0)
+    {
+        stats.frames = newFrames;
+        lastFrameTime = now;
+        return;
+    }
+    int64_t interval = (now - lastFrameTime) / newFrames;
+    if (newFrames == 1 && expectedInterval > 0 && interval * 2 > expectedInterval * 3)
+        stats.droppedFrames += static_cast<size_t>((interval + expectedInterval / 2) / expectedInterval - 1);
+    for (int frame = 1; frame <= min(newFrames, MaxFramesPerTick); ++frame)
+    {
+        FrameTime frameTime = { lastFrameTime + interval * frame, interval };
+        window.push_back(frameTime);
+    }
+    stats.frames += newFrames;
+    stats.fps = interval > 0 ? 1000000.0 / interval : 0.0;
+    lastFrameTime = now;
+}
+
+void LiveVideoMonitor::UpdateStats(int64_t now)
+{
+    while (!window.empty() && window.front().time <= now - WindowMicroseconds)
+        window.pop_front();
+    if (now - lastFrameTime >= WindowMicroseconds)
+        stats.fps = 0;
+    int64_t span = now - startTime < WindowMicroseconds ? now - startTime : WindowMicroseconds;
+    stats.windowFps = span > 0 ? window.size() * 1000000.0 / span : 0.0;
+    if (window.empty())
+    {
+        stats.intervalP50 = stats.intervalP95 = stats.intervalP99 = 0;
+        return;
+    }
+    vector<int64_t> intervals;
+    intervals.reserve(window.size());
+    for (auto& frame : window)
+        intervals.push_back(frame.interval);
+    sort(intervals.begin(), intervals.end());
+    stats.intervalP50 = Percentile(intervals, 0.50);
+    stats.intervalP95 = Percentile(intervals, 0.95);
+    stats.intervalP99 = Percentile(intervals, 0.99);
+    expectedInterval = static_cast<int64_t>(stats.intervalP50 * 1000);
+}
+
+// The host variables are optional. If a macro has not defined them the figures are only logged.
+void LiveVideoMonitor::Publish()
+{
+    if (publishFailed)
+        return;
+    try
+    {
+        MGR::LiveVideoMonitored::Value(stats.running);
+        MGR::LiveFps::Value(stats.fps);
+        MGR::LiveWindowFps::Value(stats.windowFps);
+        MGR::LiveFrameIntervalP50::Value(stats.intervalP50);
+        MGR::LiveFrameIntervalP95::Value(stats.intervalP95);
+        MGR::LiveFrameIntervalP99::Value(stats.intervalP99);
+        MGR::LiveDroppedFrames::Value(static_cast<int>(stats.droppedFrames));
+    }
+    catch(const std::exception& ex)
+    {
+        publishFailed = true;
+        OutputDebugString(ex.what());
+    }
+}
+
+string LiveVideoMonitor::Summary() const
+{
+    ostringstream summary;
+    summary << fixed << setprecision(1)
+            << stats.frames << " frames, " << stats.fps << " fps, " << stats.windowFps << " fps over "
+            << WindowMicroseconds / 1000000 << " s, frame interval p50 " << stats.intervalP50 << " ms p95 "
+            << stats.intervalP95 << " ms p99 " << stats.intervalP99 << " ms, " << stats.droppedFrames << " dropped frames";
+    return summary.str();
+}
+
+void LiveVideoMonitor::WriteSummary(const char* heading) const
+{
+    string line = string(heading).append(": ").append(Summary()).append("\n");
+    OutputDebugStringA(line.c_str());
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <functional>
+
+/// Summary:
+///   Frame rate figures of the live video.
+struct LiveVideoStats
+{
+    LiveVideoStats() : running(false), frames(0), fps(0), windowFps(0), intervalP50(0), intervalP95(0), intervalP99(0), droppedFrames(0) {}
+
+    bool running;
+    size_t frames;          // Frames counted since the live video started
+    double fps;             // From the time between the last two frames
+    double windowFps;       // Over the last LiveVideoMonitor::WindowMicroseconds
+    double intervalP50;     // Percentiles of the time between frames within the window, in milliseconds
+    double intervalP95;
+    double intervalP99;
+    size_t droppedFrames;   // Estimated from gaps between frames longer than 1.5 times the median interval
+};
+
+/// Summary:
+///   Measures the frame rate of the live video so a slow live view can be traced to the camera, the host or a plug-in.
+///   The monitor is off until it is enabled. While it is on, LiveImgRunning is checked every RunningCheckIntervalMicroseconds
+///   and, while it is set, LiveImgCount is read on every idle tick with a high resolution clock.
+///   When the count went up by several frames between ticks the time is shared evenly between them, so a host that
+///   is slow to go idle shows as late ticks rather than dropped frames. A gap much longer than the median interval
+///   with a single new frame is counted as dropped frames.
+///   The figures are published to the MGR_dLive... and MGR_iLiveDroppedFrames host variables every
+///   PublishIntervalMicroseconds and a summary is written to the debug log every SummaryIntervalMicroseconds
+///   and when the live video stops.
+///   Must only be used on the host's thread.
+class LiveVideoMonitor
+{
+public:
+    typedef std::function<int64_t()> clock_func_t;  // A monotonic time in microseconds
+
+    static const int64_t WindowMicroseconds = 2000000;
+    static const int64_t PublishIntervalMicroseconds = 500000;
+    static const int64_t SummaryIntervalMicroseconds = 10000000;
+    static const int64_t RunningCheckIntervalMicroseconds = 250000;
+    static const int64_t ReadRetryMicroseconds = 10000000;
+
+private:
+    struct FrameTime
+    {
+        int64_t time;
+        int64_t interval;   // microseconds since the frame before it
+    };
+
+    clock_func_t clock;
+    bool enabled;
+    bool publishFailed;
+    bool readFailed;                // Reading the host variables failed. It is reported once and retried after ReadRetryMicroseconds.
+    int64_t nextReadTime;           // Until the live video runs or after a failed read, no read is made before this time
+    LiveVideoStats stats;
+    int lastCount;
+    int64_t lastFrameTime;
+    int64_t startTime;
+    int64_t lastPublishTime;
+    int64_t lastSummaryTime;
+    int64_t expectedInterval;       // The median interval when last published. Zero until it is known.
+    std::deque<FrameTime> window;   // The frames within the window, oldest first
+
+    LiveVideoMonitor(const LiveVideoMonitor&);
+    LiveVideoMonitor& operator = (const LiveVideoMonitor&);
+
+    void Begin(int64_t now, int count);
+    void End(int64_t now);
+    void AddFrames(int64_t now, int newFrames);
+    void UpdateStats(int64_t now);
+    void Publish();
+    void WriteSummary(const char* heading) const;
+
+public:
+    explicit LiveVideoMonitor(clock_func_t clock);
+
+    /// Summary:
+    ///   The monitor of the host's live video. Its clock is QueryPerformanceCounter.
+    static LiveVideoMonitor& Instance();
+
+    /// Summary:
+    ///   Reads the live video variables of the host and updates the figures.
+    void Sample();
+
+    /// Summary:
+    ///   Updates the figures from a reading of the live video state.
+    /// Arguments:
+    ///   running    - The value of LiveImgRunning
+    ///   frameCount - The value of LiveImgCount
+    void Sample(bool running, int frameCount);
+
+    /// Summary:
+    ///   Turns the monitor on or off. It is off by default. Turning it off ends the current measurement.
+    void Enable(bool enable);
+
+    bool IsEnabled() const { return enabled; }
+
+    const LiveVideoStats& Stats() const { return stats; }
+
+    /// Summary:
+    ///   The figures as a line of text, as written to the debug log.
+    std::string Summary() const;
+};
@@ -0,0 +1,137 @@
+#include "stdafx.h"
+#include <string.h>
+#include <limits>
+#include "MappedFile.h"
+
+using namespace std;
+
+namespace
+{
+    const DWORD SHARE_ALL = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+
+    // Closes a handle when it goes out of scope
+    struct ScopedHandle
+    {
+        HANDLE handle;
+        explicit ScopedHandle(HANDLE handle) : handle(handle) {}
+        ~ScopedHandle()
+        {
+            if (handle && handle != INVALID_HANDLE_VALUE)
+                CloseHandle(handle);
+        }
+    };
+
+    // Unmaps a view when it goes out of scope
+    struct ScopedView
+    {
+        const void* view;
+        explicit ScopedView(const void* view) : view(view) {}
+        ~ScopedView()
+        {
+            if (view)
+                UnmapViewOfFile(view);
+        }
+    };
+
+    boost::string_ref WithoutCarriageReturn(boost::string_ref line)
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+        return line;
+    }
+}
+
+MappedFile::MappedFile(const string& fileName) : file(INVALID_HANDLE_VALUE), mapping(NULL), view(nullptr), length(0)
+{
+    if (!Open(fileName))
+        throw runtime_error("Unable to read the file " + fileName + " (error " + to_string(GetLastError()) + ")");
+}
+
+bool MappedFile::Open(const string& fileName)
+{
+    Close();
+    file = CreateFileA(fileName.c_str(), GENERIC_READ, SHARE_ALL, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (INVALID_HANDLE_VALUE == file)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || static_cast<uint64_t>(size.QuadPart) > (numeric_limits<size_t>::max)())
+    {
+        Close();
+        return false;
+    }
+    length = static_cast<size_t>(size.QuadPart);
+    if (length == 0)
+        return true;    // an empty file can not be mapped
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    view = mapping ? static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+    if (!view)
+    {
+        DWORD error = GetLastError();
+        Close();
+        SetLastError(error);
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (view)
+        UnmapViewOfFile(view);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    file = INVALID_HANDLE_VALUE;
+    mapping = NULL;
+    view = nullptr;
+    length = 0;
+}
+
+bool MappedFile::ForEachLine(const string& fileName, const function<bool(boost::string_ref)>& callback)
+{
+    ScopedHandle file(CreateFileA(fileName.c_str(), GENERIC_READ, SHARE_ALL, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+    if (INVALID_HANDLE_VALUE == file.handle)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file.handle, &size))
+        throw runtime_error("Unable to read the file " + fileName);
+    if (size.QuadPart == 0)
+        return true;
+    ScopedHandle mapping(CreateFileMappingA(file.handle, NULL, PAGE_READONLY, 0, 0, NULL));
+    if (!mapping.handle)
+        throw runtime_error("Unable to read the file " + fileName + " (error " + to_string(GetLastError()) + ")");
+
+    uint64_t fileSize = static_cast<uint64_t>(size.QuadPart);
+    string carried; // the start of a line that continues in the next window
+    bool keepGoing = true;
+    for (uint64_t offset = 0; keepGoing && offset < fileSize; offset += WindowSize)
+    {
+        size_t windowLength = static_cast<size_t>(min<uint64_t>(WindowSize, fileSize - offset));
+        ScopedView window(MapViewOfFile(mapping.handle, FILE_MAP_READ, static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset), windowLength));
+        if (!window.view)
+            throw runtime_error("Unable to read the file " + fileName + " (error " + to_string(GetLastError()) + ")");
+        const char* lineStart = static_cast<const char*>(window.view);
+        const char* windowEnd = lineStart + windowLength;
+        while (keepGoing)
+        {
+            const char* lineEnd = static_cast<const char*>(memchr(lineStart, '\n', windowEnd - lineStart));
+            if (!lineEnd)
+                break;
+            if (carried.empty())
+                keepGoing = callback(WithoutCarriageReturn(boost::string_ref(lineStart, lineEnd - lineStart)));
+            else
+            {
+                carried.append(lineStart, lineEnd);
+                keepGoing = callback(WithoutCarriageReturn(carried));
+                carried.clear();
+            }
+            lineStart = lineEnd + 1;
+        }
+        if (keepGoing)
+            carried.append(lineStart, windowEnd);
+    }
+    if (keepGoing && !carried.empty())
+        callback(WithoutCarriageReturn(carried));
+    return true;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <stdint.h>
+#include <boost/utility/string_ref.hpp>
+#include "Utilities.h"
+
+/// Summary:
+///   The contents of a file mapped read only into memory. The text and lines are views of the
+///   mapping and are only valid while the MappedFile is open.
+///   Other processes may read, write or delete the file while it is open.
+class MappedFile
+{
+    HANDLE file;
+    HANDLE mapping;
+    const char* view;
+    size_t length;
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator = (const MappedFile&);
+
+public:
+    /// The number of bytes ForEachLine maps at a time. A multiple of the allocation granularity.
+    static const size_t WindowSize = 16 * 1024 * 1024;
+
+    MappedFile() : file(INVALID_HANDLE_VALUE), mapping(NULL), view(nullptr), length(0) {}
+
+    /// Summary:
+    ///   Opens and maps a file.
+    /// Throws:
+    ///   runtime_error if the file could not be opened or mapped
+    explicit MappedFile(const std::string& fileName);
+
+    ~MappedFile() { Close(); }
+
+    /// Summary:
+    ///   Opens and maps a file, closing any file that was open.
+    /// Returns:
+    ///   False if the file could not be opened or mapped
+    bool Open(const std::string& fileName);
+
+    void Close();
+
+    bool IsOpen() const { return file != INVALID_HANDLE_VALUE; }
+
+    const char* Data() const { return view; }
+    size_t Size() const { return length; }
+
+    boost::string_ref Text() const { return boost::string_ref(view, length); }
+
+    /// Returns the lines of the file. "\r\n" and "\n" line endings are removed.
+    LineRange Lines() const { return SplitLines(Text()); }
+
+    /// Summary:
+    ///   Calls a function with each line of a file of any size. The file is mapped WindowSize bytes at a time
+    ///   so a large file does not need address space for all of it at once. Only a line that crosses the end
+    ///   of a window is copied. "\r\n" and "\n" line endings are removed.
+    /// Arguments:
+    ///   fileName - The file to read
+    ///   callback - Called with each line in order. The line is only valid during the call. Return false to stop.
+    /// Returns:
+    ///   False if the file could not be opened
+    /// Throws:
+    ///   runtime_error if the file could not be read
+    static bool ForEachLine(const std::string& fileName, const std::function<bool(boost::string_ref)>& callback);
+};
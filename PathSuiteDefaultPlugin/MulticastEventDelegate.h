@@ -65,4 +65,15 @@ public:
         for (auto func : delegates)
             (*func)(args);
     }
+
+    // Calls the delegates like operator() and passes each one to beforeEach just before it is called
+    template<typename Observer>
+    void Invoke(ArgType& args, Observer beforeEach)
+    {
+        for (auto func : delegates)
+        {
+            beforeEach(*func);
+            (*func)(args);
+        }
+    }
 };
\ No newline at end of file
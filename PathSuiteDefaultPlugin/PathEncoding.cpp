@@ -0,0 +1,174 @@
+#include "stdafx.h"
+#include <string.h>
+#include <intrin.h>
+#include <emmintrin.h>
+#include "PathEncoding.h"
+
+using namespace std;
+
+namespace
+{
+    // Flags describing how a character is treated in a file name
+    enum CharClass
+    {
+        Safe    = 0,
+        Invalid = 1,    // one of InvalidFilePathChars
+        Control = 2,    // a tab, newline or other non-displayable character
+        Escape  = 4     // the escape char itself, written twice when encoding
+    };
+
+    const char HexDigits[] = "0123456789ABCDEF";
+
+    struct CharTables
+    {
+        unsigned char charClass[256];
+        signed char hexValue[256];   // -1 for characters that are not uppercase hex digits
+
+        CharTables()
+        {
+            for (int ch = 0; ch < 256; ++ch)
+            {   // characters above 0x7F are displayable in the ANSI code page
+                charClass[ch] = (ch < 0x20 || ch == 0x7F) ? Control : Safe;
+                hexValue[ch] = -1;
+            }
+            for (auto ch : InvalidFilePathChars)
+                charClass[static_cast<unsigned char>(ch)] |= Invalid;
+            charClass[static_cast<unsigned char>(PathEncoding::EscapeChar)] |= Escape;
+            for (int digit = 0; digit < 16; ++digit)
+                hexValue[static_cast<unsigned char>(HexDigits[digit])] = static_cast<signed char>(digit);
+        }
+    };
+
+    const CharTables Tables;
+
+    inline unsigned ClassOf(char ch)
+    {
+        return Tables.charClass[static_cast<unsigned char>(ch)];
+    }
+
+    // Returns the number of characters at the start of the text that are Safe.
+    // Blocks of 16 characters are tested at once. Only the tail is looked up in the table.
+    size_t SafeRunLength(const char* text, size_t length)
+    {
+        const __m128i minusOne = _mm_set1_epi8(-1);
+        const __m128i space = _mm_set1_epi8(0x20);
+        const __m128i del = _mm_set1_epi8(0x7F);
+        const __m128i escape = _mm_set1_epi8(PathEncoding::EscapeChar);
+        __m128i invalid[sizeof(InvalidFilePathChars)];
+        for (size_t index = 0; index < sizeof(InvalidFilePathChars); ++index)
+            invalid[index] = _mm_set1_epi8(InvalidFilePathChars[index]);
+
+        size_t offset = 0;
+        for (; offset + 16 <= length; offset += 16)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + offset));
+            // the compares are signed so characters above 0x7F are excluded from the control range by the first test
+            __m128i special = _mm_and_si128(_mm_cmpgt_epi8(block, minusOne), _mm_cmplt_epi8(block, space));
+            special = _mm_or_si128(special, _mm_cmpeq_epi8(block, del));
+            special = _mm_or_si128(special, _mm_cmpeq_epi8(block, escape));
+            for (size_t index = 0; index < sizeof(InvalidFilePathChars); ++index)
+                special = _mm_or_si128(special, _mm_cmpeq_epi8(block, invalid[index]));
+            unsigned long mask = static_cast<unsigned long>(_mm_movemask_epi8(special));
+            unsigned long first;
+            if (_BitScanForward(&first, mask))
+                return offset + first;
+        }
+        while (offset < length && ClassOf(text[offset]) == Safe)
+            ++offset;
+        return offset;
+    }
+}
+
+string PathEncoding::Encode(boost::string_ref original)
+{
+    string encoded;
+    encoded.reserve(original.size());
+    const char* text = original.data();
+    size_t length = original.size();
+    size_t offset = 0;
+    while (offset < length)
+    {
+        size_t run = SafeRunLength(text + offset, length - offset);
+        encoded.append(text + offset, run);
+        offset += run;
+        if (offset == length)
+            break;
+        char ch = text[offset++];
+        if (ClassOf(ch) == Escape)
+        {
+            encoded.push_back(EscapeChar);
+            encoded.push_back(EscapeChar);
+        }
+        else
+        {
+            encoded.push_back(EscapeChar);
+            encoded.push_back(HexDigits[(ch >> 4) & 0xF]);
+            encoded.push_back(HexDigits[ch & 0xF]);
+        }
+    }
+    return encoded;
+}
+
+bool PathEncoding::Decode(boost::string_ref encoded, string& original)
+{
+    original.clear();
+    original.reserve(encoded.size());
+    const char* cur = encoded.data();
+    const char* end = cur + encoded.size();
+    while (cur != end)
+    {
+        const char* escape = static_cast<const char*>(memchr(cur, EscapeChar, end - cur));
+        if (!escape)
+        {
+            original.append(cur, end);
+            break;
+        }
+        original.append(cur, escape);
+        cur = escape + 1;
+        if (cur != end && *cur == EscapeChar)
+        {   // a pair of escape chars "%%" equals a literal escape char '%'
+            original.push_back(EscapeChar);
+            ++cur;
+        }
+        else if (end - cur >= 2)
+        {
+            int upper = Tables.hexValue[static_cast<unsigned char>(cur[0])];
+            int lower = Tables.hexValue[static_cast<unsigned char>(cur[1])];
+            if (upper < 0 || lower < 0)
+                return false;   // an escape char was followed by an invalid encoding value
+            original.push_back(static_cast<char>((upper << 4) | lower));
+            cur += 2;
+        }
+        else
+        {   // the string was not long enough to contain the encoded value following the escape char
+            return false;
+        }
+    }
+    return true;
+}
+
+string PathEncoding::VerifyFileName(boost::string_ref fileName)
+{
+    if (fileName.empty())
+        return "must not be an empty string.";
+
+    unsigned found = Safe;
+    const char* text = fileName.data();
+    size_t length = fileName.size();
+    for (size_t offset = 0; offset < length && !(found & Invalid); ++offset)
+    {
+        offset += SafeRunLength(text + offset, length - offset);
+        if (offset < length)
+            found |= ClassOf(text[offset]);
+    }
+
+    if (found & Invalid)
+    {
+        string message("must not contain any of the following characters:\n");
+        interlace_with(begin(InvalidFilePathChars), end(InvalidFilePathChars), back_inserter(message), ' ');
+        return message;
+    }
+    if (found & Control)
+        return "must not contain a tab, newline, or any other non-displayable character.";
+    return string();
+}
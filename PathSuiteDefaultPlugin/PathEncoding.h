@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <boost/utility/string_ref.hpp>
+
+/// Summary:
+///   Encoding of arbitrary text into names that are valid for files and directories.
+///   Characters that Windows does not allow in a file name (see InvalidFilePathChars) and
+///   non-displayable characters are written as %XX using uppercase hex digits. A literal '%' is written as "%%".
+///   Characters are classified with 256-entry tables and runs of characters that need no
+///   encoding are skipped 16 bytes at a time with SSE2.
+namespace PathEncoding
+{
+    const char EscapeChar = '%';
+
+    /// Summary:
+    ///   Encodes text so it can be used as a file or directory name. The text is not trimmed.
+    std::string Encode(boost::string_ref original);
+
+    /// Summary:
+    ///   Decodes a name created by Encode.
+    /// Arguments:
+    ///   encoded - The encoded name
+    ///   original - Receives the decoded text. On failure it holds the text decoded before the error.
+    /// Returns:
+    ///   False if an escape char was followed by an invalid or truncated value
+    bool Decode(boost::string_ref encoded, std::string& original);
+
+    /// Summary:
+    ///   Checks that a name can be used as a file or directory name. The name is not trimmed.
+    /// Returns:
+    ///   An empty string if the name is valid, otherwise a message that completes the sentence "The name ...".
+    std::string VerifyFileName(boost::string_ref fileName);
+}
@@ -4,7 +4,32 @@
 #include "stdafx.h"
 #include <chrono>
 #include <ctime>
+#include <iomanip>
 #include "PathSuiteHostVars.h"
+#include "CatalogFiles.h"
+#include "CatalogCounters.h"
+#include "CaseLockManager.h"
+#include "AccessionPrefixTable.h"
+#include "CaseIdIndex.h"
+#include "CatalogSearchIndex.h"
+#include "ListingCursors.h"
+#include "ResultChannel.h"
+#include "ThumbnailCache.h"
+#include "CaseManifest.h"
+#include "CatalogReplicator.h"
+#include "CaseArchive.h"
+#include "PathEncoding.h"
+#include "DirectoryScanner.h"
+#include "FileOperationBatch.h"
+#include "ConfigWriteBehind.h"
+#include "BackgroundWorker.h"
+#include "VariableWatcher.h"
+#include "VectorVariable.h"
+#include "VariableManager.h"
+#include "CatalogReport.h"
+#include "AcquisitionScheduler.h"
+#include "LiveVideoMonitor.h"
+#include "StallWatchdog.h"
 
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/string_generator.hpp>
@@ -15,10 +40,7 @@
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/property_tree/ini_parser.hpp>
 
-const std::string CONFIG_DIR_NAME                     = ".config";
-const std::string CATALOG_MAIN_CONFIG_FILENAME        = "HEAD";
-const std::string CATALOG_VARIABLES_FILENAME          = "catalog.var";
-const std::string ACCESSION_PREFIX_FILENAME           = "AccessionPrefixes.txt";
+const time_t CATALOG_RECOUNT_INTERVAL_SECONDS       = 60 * 60;
 
 enum class ImageCompression
 {
@@ -49,9 +71,31 @@ enum Functions
     FILE_DecodeFromPath_T1_T5B5             = 9,
     FILE_IsDirectroyEmptyOrMissing_T1_B5    = 10,
     FILE_GetParentDirectory_T1_T5           = 11,
+    FILE_VerifyFileNameBatch_T1_B5T5N5      = 12,
+    FILE_EncodeForPathBatch_T1_T5           = 13,
+    FILE_DecodeFromPathBatch_T1_B5T5N5      = 14,
 
     TrimText_T1_T1                          = 20,
     SYS_GetDisplayResolution__N1N2          = 30,
+    VAR_WatchVariable_T1T2_B5               = 40,
+    VAR_UnwatchVariable_T1                  = 41,
+    VAR_SetWatchInterval_N1                 = 42,
+    VAR_GetChangedVariables__T5N5           = 43,
+    VAR_SummarizeNumberList_T1_B5N2N3N4N5   = 44,
+    VAR_SaveSnapshot_T1_B5T5                = 45,
+    VAR_RestoreSnapshot_T1_B5T5N5           = 46,
+    ACQ_StartFixedRate_N1N2_B5              = 50,
+    ACQ_StartFixedDelay_N1N2_B5             = 51,
+    ACQ_StartBurst_T1_B5                    = 52,
+    ACQ_Stop                                = 53,
+    ACQ_GetStatus__B5N2N3N4N5               = 54,
+    ACQ_GetJitterHistogram__T5N5            = 55,
+    ACQ_GetShotTimes__T5N5                  = 56,
+    LIVE_EnableFrameMonitor_B1              = 60,
+    LIVE_GetFrameStats__B5T5N2N3N4N5        = 61,
+    DIAG_StartStallWatchdog_T1N1_B5         = 70,
+    DIAG_StopStallWatchdog                  = 71,
+    DIAG_GetStallCount__B5N5                = 72,
     
     RenameCase_T1T2_B5T5                    = 100,
     GetAccessionPrefixDesciption_T1_T5      = 101,
@@ -60,6 +104,29 @@ enum Functions
     RemoveAccessionPrefix_T1                = 104,
     GetSpecimenImageList_T1T2_T5N5          = 105,
     GetSpecimenList_T1_T5N5                 = 106,
+    AutocompleteCaseId_T1N1_B5T4T5N4N5      = 107,
+    SearchCatalog_T1N1N2_B5T5N5             = 108,
+    IndexImageText_T1                       = 109,
+    GetSpecimenListPage_T1N1N2_T5N5         = 110,
+    GetSpecimenImageListPage_T1T2N1N2_T5N5  = 111,
+    OpenSpecimenListCursor_T1_T5            = 112,
+    OpenSpecimenImageListCursor_T1T2_T5     = 113,
+    OpenCatalogSearchCursor_T1_T5N5         = 114,
+    ReadListCursor_T1N1_B5T5N5              = 115,
+    CloseListCursor_T1                      = 116,
+    GetSpecimenListToChannel_T1_T5N5        = 117,
+    GetSpecimenImageListToChannel_T1T2_T5N5 = 118,
+    SearchCatalogToChannel_T1_T5N5          = 119,
+    ReadResultChannel_T1N1N2_B5T5N5         = 120,
+    GetThumbnailLocation_T1_B5T5N4N5        = 121,
+    SaveThumbnail_T1T2_B5                   = 122,
+    CreateCaseThumbnails_T1_N5              = 123,
+    StartCaseVerification_T1_B5             = 124,
+    ReplicateCatalog_T1T2_B5T5              = 125,
+    StopReplication                         = 126,
+    ArchiveCase_T1_B5                       = 127,
+    UnarchiveCase_T1_B5                     = 128,
+    IsCaseArchived_T1_B5                    = 129,
     CreateImageCatalog_T1_T5B5              = 200,
     OpenImageCatalog_T1_T5B5                = 201,
     IsValidCatalog_T1_B5                    = 202,
@@ -68,11 +135,17 @@ enum Functions
     ImageCatalogDetails_T1_T5B5             = 205,
     CatalogHasProperty_T1T2_B5              = 206,
     SetCatalogProperty_T1T2T3               = 207,
-    GetCatalogProperty_T1T2_T5              = 208
+    GetCatalogProperty_T1T2_T5              = 208,
+    GetCaseLockHolders_T1_T5N5              = 209,
+    BuildSearchIndex_T1_B5                  = 210,
+    StartDuplicateImageScan_T1_B5           = 211,
+    GetDuplicateImageScanResult__B5T4T5N5   = 212,
+    ExportCatalogReport_T1T2_B5             = 213,
+    GetCatalogReportProgress__B5T5N4N5      = 214,
+    GetCaseVerificationProgress__B4B5T5N4N5 = 215,
+    GetCaseArchiveProgress__B4B5T5N4N5      = 216
 };
 
-static std::vector<std::string> lockedCases;
-
 sys::path CatalogConfigDirectory(const sys::path& catalogPath)
 {
     return catalogPath / sys::path(CONFIG_DIR_NAME);
@@ -80,7 +153,7 @@ sys::path CatalogConfigDirectory(const sys::path& catalogPath)
 
 sys::path CatalogConfigDirectory()
 {
-    return CatalogConfigDirectory(sys::path(MGR::MasterCatalogFolder()));
+    return CatalogConfigDirectory(sys::path(MGR::MasterCatalogFolder::Value()));
 }
 
 sys::path CatalogMainConfigFile(const sys::path& catalogPath)
@@ -100,25 +173,106 @@ sys::path CatalogPrefsFile(const sys::path& catalogPath)
 
 sys::path GetCaseLockFilePath(const std::string& caseId)
 {
-    sys::path lockFile = MGR::MasterCatalogFolder();
+    sys::path lockFile = MGR::MasterCatalogFolder::Value();
     lockFile /= caseId;
     lockFile /= "case.lock";
     return lockFile;
 }
 
+sys::path GetCaseDirectory(const std::string& caseId)
+{
+    sys::path directory = MGR::MasterCatalogFolder::Value();
+    directory /= caseId;
+    return directory;
+}
+
+sys::path GetSpecimenDirectory(const std::string& caseId, const std::string& specimen)
+{
+    sys::path directory = GetCaseDirectory(caseId);
+    directory /= specimen;
+    if (directory.filename() == ".")
+        directory.remove_filename();
+    return directory;
+}
+
+bool IsSpecimenImageFile(const DirectoryEntry& entry)
+{
+    return !entry.isDirectory && IsCatalogImageFileName(entry.name);
+}
+
+/// Summary:
+///   Gets the sorted names of the specimens of a case. Archived cases are listed from the archive index.
+///   A missing case results in an empty list.
+vector<string> ListSpecimens(const std::string& caseId)
+{
+    try
+    {
+        return CaseArchive::ListSpecimens(GetCaseDirectory(caseId));
+    }
+    catch(const std::exception& ex)
+    {
+        OutputDebugString(ex.what());
+    }
+    return vector<string>();
+}
+
+/// Summary:
+///   Gets the sorted names of the images of a specimen. Archived cases are listed from the archive index.
+///   A missing specimen results in an empty list.
+vector<string> ListSpecimenImages(const std::string& caseId, const std::string& specimen)
+{
+    try
+    {
+        return CaseArchive::ListImages(GetCaseDirectory(caseId), specimen);
+    }
+    catch(const std::exception& ex)
+    {
+        OutputDebugString(ex.what());
+    }
+    return vector<string>();
+}
+
+/// Summary:
+///   Returns one page of a list in T5 and the size of the whole list in N5.
+void ReturnListPage(const vector<string>& items, double offset, double limit)
+{
+    size_t first = min(items.size(), static_cast<size_t>(max(0.0, offset)));
+    size_t count = limit > 0 ? min(items.size() - first, static_cast<size_t>(limit)) : items.size() - first;
+    Returns::Text(5, JoinWith(items.begin() + first, items.begin() + first + count, "\n"));
+    Returns::Num(5, static_cast<double>(items.size()));
+}
+
+/// Summary:
+///   Publishes a list to the result channel and returns its handle in T5 and its size in N5.
+void ReturnResultChannel(const vector<string>& items)
+{
+    string handle;
+    try
+    {
+        handle = ResultChannel::Instance().Publish(items);
+    }
+    catch(const std::exception& ex)
+    {
+        OutputDebugString(ex.what());
+    }
+    Returns::Text(5, handle);
+    Returns::Num(5, static_cast<double>(items.size()));
+}
+
 boost::property_tree::ptree GetPropertyTree(const sys::path& fileName)
 {
     using boost::property_tree::ptree;
 
     ptree pt;
-    read_json(fileName, pt);
+    if (!ConfigWriteBehind::Instance().TryGetPending(fileName, pt))
+        read_json(fileName, pt);
     return pt;
 }
 
+// The file is written shortly afterwards by ConfigWriteBehind. Reads with GetPropertyTree see the new contents immediately.
 void SavePropertyTree(const sys::path& fileName, const boost::property_tree::ptree& pt)
 {
-    using boost::property_tree::write_json;
-    write_json(fileName.string(), pt);
+    ConfigWriteBehind::Instance().Save(fileName, pt);
 
     //using boost::property_tree::write_ini;
     //sys::path iniFileName = fileName;
@@ -135,23 +289,22 @@ void UpdateCatalog(const sys::path& catalogPath)
     string regexPostfix = "[\\w-]+\\.([jJ][pP][gG2])$";
     const char sectionDelimiters[] = {'-', '.'};
     bool losslessFound = false;
-    for(auto dirIter = sys::recursive_directory_iterator(catalogPath); dirIter != sys::recursive_directory_iterator(); ++dirIter)
-    {
-        if(dirIter.level() > 2)
-            dirIter.pop(); // no need to go deeper than two levels
-        if (dirIter.level() == 2)
-        {
-            auto path = dirIter->path();
-            if (!sys::is_regular_file(path))
-                continue;
-            auto pathIter = path.end();
-            advance(pathIter, -3); // Backup two directory levels
-            string filePrefix = *pathIter;
-            filePrefix.append(".").append(*(++pathIter)).append(".");
-            string fileName = *(++pathIter);
+    FileOperationBatch renames;
+    for (auto& caseId : DirectoryScanner::ListDirectories(catalogPath))
+    {
+        sys::path caseDir = catalogPath / sys::path(caseId);
+        for (auto& specimen : DirectoryScanner::ListDirectories(caseDir))
+        {
+            sys::path specimenDir = caseDir / sys::path(specimen);
+            string filePrefix = caseId + "." + specimen + ".";
             regex imageFileNameRegEx("^" + MakeRegExLiteral( filePrefix ) + regexPostfix);
-            if (regex_match(fileName, imageFileNameRegEx))
+            DirectoryScanner scanner(specimenDir);
+            DirectoryEntry entry;
+            while (scanner.Next(entry))
             {
+                string fileName = entry.name;
+                if (entry.isDirectory || !regex_match(fileName, imageFileNameRegEx))
+                    continue;
                 fileName.erase(0, filePrefix.size());
                 if (isalpha(fileName.front()))
                 {   // Alpha encoded number will be replaced with decimal number
@@ -164,12 +317,21 @@ void UpdateCatalog(const sys::path& catalogPath)
                 { // Remove zero {0} padding from the front of the integer
                     fileName.erase(fileName.begin(), find_if(fileName.begin(), fileName.end(), [] (char c) { return c != '0';}));
                 }
-                sys::path newName = path.parent_path();
-                newName /= fileName;
+                sys::path newName = specimenDir / sys::path(fileName);
                 if (losslessFound && newName.extension() == ".jp2")
                     losslessFound = true;
-                sys::rename(path, newName);
+                renames.AddRename(specimenDir / sys::path(entry.name), newName);
             }
+            scanner.ThrowIfFailed();
+        }
+    }
+    // The renames are independent of each other so many are issued at once
+    if (renames.Execute() > 0)
+    {
+        for (auto& rename : renames.Operations())
+        {
+            if (rename.error != ERROR_SUCCESS)
+                throw runtime_error("Unable to rename " + rename.source.string() + " to " + rename.target.filename() + " (error " + to_string(rename.error) + ")");
         }
     }
     if ( !sys::exists(CatalogConfigDirectory(catalogPath)) )
@@ -191,10 +353,9 @@ bool IsValidCatalog(const sys::path& catalogDir)
             return true;
         return false;
     }
-    for (auto dirIter = sys::directory_iterator(catalogDir); dirIter != sys::directory_iterator(); ++dirIter)
+    for (auto& caseId : DirectoryScanner::ListDirectories(catalogDir))
     {
-        auto path = catalogDir / dirIter->path();
-        if (sys::is_directory(path) && sys::exists( path/sys::path("case.var") ))
+        if (sys::exists( catalogDir/sys::path(caseId)/sys::path("case.var") ))
             return true;
     }
     return false;
@@ -216,7 +377,7 @@ void MakeDefaultCatalogConfigDir(const sys::path& catalogDir, ImageCompression d
     if (createdDir)
     {
         MakeFileOrDirHidden(catalogConfig.string());
-        sys::path appPrefsFolder = MGR::PrefsFilePath();
+        sys::path appPrefsFolder = MGR::PrefsFilePath::Value();
         sys::path originalFile = appPrefsFolder / sys::path(ACCESSION_PREFIX_FILENAME);
         if (sys::exists(originalFile))
         {
@@ -234,35 +395,61 @@ void MakeDefaultCatalogConfigDir(const sys::path& catalogDir, ImageCompression d
         ptree prefs;
         prefs.put("image.compression", ImageCompression::Lossy);
         SavePropertyTree(CatalogPrefsFile(catalogDir), prefs);
+        ConfigWriteBehind::Instance().Flush(); // IsValidCatalog looks for the files
     }
 }
 
-size_t GetNumberOfCasesInCatalog(const sys::path& catalogDir)
-{
-    size_t count = 0;
-    auto dirIterator = sys::recursive_directory_iterator(catalogDir);
-    dirIterator.no_push();
-    for_each(dirIterator, sys::recursive_directory_iterator(), [&count](const sys::path& p)
-    {
-        if(sys::is_directory(p) && p.filename() != CONFIG_DIR_NAME)
-            ++count;
-    });
-    return count;
-}
-
 
 void SetEventHandlers()
 {
     std::function<void(HostEvents::application_closing_t::arg_type)> onExit = [] (HostEvents::application_closing_t::arg_type)
     {
         // Do shutdown stuff here.
-        for(auto& caseName : lockedCases)
-        { // Remove any left over case lock files just in case someone didn't clean up after themselves.
-            sys::remove(GetCaseLockFilePath(caseName));
+        // Remove any left over case lock files just in case someone didn't clean up after themselves.
+        CaseLockManager::Instance().ReleaseAll();
+        StallWatchdog::Instance().Stop();
+        CatalogReplicator::Instance().Stop();
+        CatalogReportExport::Instance().Stop();
+        BackgroundWorker::LowPriority().Stop();
+        ConfigWriteBehind::Instance().Stop();
+        AcquisitionScheduler::Instance().Stop();
+        ThumbnailCache::Instance().Reset();
+        try
+        {
+            CatalogSearchIndex::Instance().SaveIfModified();
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugString(ex.what());
         }
-        lockedCases.clear();
     };
     HostEvents::ApplicationClosing().AddDelegate(make_event_delegate(onExit));
+
+    std::function<void(HostEvents::idle_event_t::arg_type)> onIdle = [] (HostEvents::idle_event_t::arg_type)
+    {
+        // Each task is run on its own so that one that keeps failing does not starve the ones after it
+        static const std::function<void()> idleTasks[] =
+        {
+            [] () { CatalogReplicator::Instance().PublishProgress(); },
+            [] () { ConfigWriteBehind::Instance().FlushDue(); },
+            [] () { CatalogSearchIndex::Instance().SaveIfDue(); },
+            [] () { VariableWatcher::Instance().SampleIfDue(); },
+            [] () { AcquisitionScheduler::Instance().Poll(); },
+            [] () { LiveVideoMonitor::Instance().Sample(); }
+        };
+        for (auto& task : idleTasks)
+        {
+            try
+            {
+                task();
+            }
+            catch(const std::exception& ex)
+            {
+                OutputDebugString(ex.what());
+            }
+        }
+    };
+    HostEvents::Idle().AddDelegate(make_event_delegate(onIdle));
 }
 
 /// Summary:
@@ -310,7 +497,27 @@ bool SPOTPLUGINAPI SPOTPLUGIN_INIT_FUNC(host_action_func_t hostActionFunc, uintp
         bool createdDir = false;
         try
         {
-            createdDir = sys::create_directories(sys::path(Args::Text(1)));
+            sys::path newDir = Args::Text(1);
+            if (newDir.filename() == ".")
+                newDir.remove_filename();
+            int missingLevels = 0;
+            for (sys::path dir = newDir; !dir.empty() && !sys::exists(dir); dir = dir.parent_path())
+                ++missingLevels;
+            createdDir = sys::create_directories(newDir);
+            if (createdDir)
+            {
+                sys::path catalogPath = MGR::MasterCatalogFolder::Value();
+                CatalogCounters::Instance().OnDirectoryCreated(catalogPath, newDir, missingLevels);
+                int depth = CatalogItemDepth(catalogPath, newDir);
+                if (depth > 0 && missingLevels >= depth)
+                {   // the case directory itself is new
+                    sys::path caseDir = newDir;
+                    for (; depth > 1; --depth)
+                        caseDir = caseDir.parent_path();
+                    CaseIdIndex::Instance().OnCaseAdded(catalogPath, caseDir.filename());
+                    CatalogSearchIndex::Instance().OnCaseAdded(catalogPath, caseDir.filename());
+                }
+            }
         }
         catch (const sys::filesystem_error&)
         {
@@ -320,7 +527,21 @@ bool SPOTPLUGINAPI SPOTPLUGIN_INIT_FUNC(host_action_func_t hostActionFunc, uintp
 
     dispatcher.SetAction(FILE_DeleteFile_T1_B5, []()
     {
-        Returns::Bool(sys::remove(sys::path(Args::Text(1))));
+        sys::path item = Args::Text(1);
+        bool isDirectory = sys::is_directory(item);
+        bool removed = sys::remove(item);
+        if (removed)
+        {
+            sys::path catalogPath = MGR::MasterCatalogFolder::Value();
+            CatalogCounters::Instance().OnItemRemoved(catalogPath, item, isDirectory);
+            if (isDirectory && CatalogItemDepth(catalogPath, item) == 1)
+            {
+                CaseIdIndex::Instance().OnCaseRemoved(catalogPath, item.filename());
+                CatalogSearchIndex::Instance().OnCaseRemoved(catalogPath, item.filename());
+                ThumbnailCache::Instance().OnCaseRemoved(catalogPath, item.filename());
+            }
+        }
+        Returns::Bool(removed);
     });
           
     // Checks if a file at path _argT1 exists
@@ -342,27 +563,36 @@ bool SPOTPLUGINAPI SPOTPLUGIN_INIT_FUNC(host_action_func_t hostActionFunc, uintp
 
     dispatcher.SetAction(FILE_VerifyFileName_T1_B5T5, []()
     {
-        bool isValidFilename = false;
-        string fileName = TrimCopy(Args::Text(1)); // trim off all the whitespace on the ends
-        if (fileName.empty())
-        {
-            Returns::Text("must not be an empty string.");
-        }
-        else if (find_first_of(fileName.begin(), fileName.end(), begin(InvalidFilePathChars), end(InvalidFilePathChars)) != fileName.end())
-        {
-            string message("must not contain any of the following characters:\n");
-            interlace_with(begin(InvalidFilePathChars), end(InvalidFilePathChars), back_inserter(message), ' ');
+        string message = PathEncoding::VerifyFileName(TrimCopy(Args::Text(1))); // trim off all the whitespace on the ends
+        if (!message.empty())
             Returns::Text(message);
-        }
-        else if(find_if(fileName.begin(), fileName.end(), std::iscntrl) != fileName.end())
-        {
-            Returns::Text("must not contain a tab, newline, or any other non-displayable character.");
-        }
-        else
+        Returns::Bool(message.empty());
+    });
+
+    // Verifies a newline separated list of names. Each line of _argT5 holds the message for the name on the
+    // same line of _argT1 and is empty if the name is valid. _argN5 is the number of invalid names.
+    dispatcher.SetAction(FILE_VerifyFileNameBatch_T1_B5T5N5, []()
+    {
+        string fileNames = Args::Text<32767>(1);
+        string messages;
+        int invalidCount = 0;
+        bool firstLine = true;
+        for (auto fileName : Split(fileNames, '\n'))
         {
-            isValidFilename = true;
+            string message = PathEncoding::VerifyFileName(TrimView(fileName));
+            if (!message.empty())
+            {
+                ++invalidCount;
+                replace(message.begin(), message.end(), '\n', ' ');
+            }
+            if (!firstLine)
+                messages.push_back('\n');
+            messages.append(message);
+            firstLine = false;
         }
-        Returns::Bool(isValidFilename);
+        Returns::Text(5, messages);
+        Returns::Num(5, invalidCount);
+        Returns::Bool(5, invalidCount == 0);
     });
     
     dispatcher.SetAction(FILE_MakeFileOrDirHidden_T1_B5, []()
@@ -384,71 +614,61 @@ bool SPOTPLUGINAPI SPOTPLUGIN_INIT_FUNC(host_action_func_t hostActionFunc, uintp
     
     dispatcher.SetAction(FILE_EncodeForPath_T1_T5, []()
     {
-        const char escapeChar = '%';
-        std::string original = TrimCopy(Args::Text(1));
-        std::string encoded;
-        encoded.reserve(original.size());
-        for(auto ch : original)
+        string original = Args::Text(1);
+        Returns::Text(5, PathEncoding::Encode(TrimView(original)));
+    });
+
+    dispatcher.SetAction(FILE_DecodeFromPath_T1_T5B5, []()
+    {
+        std::string original;
+        bool success = PathEncoding::Decode(Args::Text(1), original);
+        Returns::Bool(5, success);
+        Returns::Text(5, original);
+    });
+
+    // Encodes each line of a newline separated list. Each line is trimmed before it is encoded.
+    dispatcher.SetAction(FILE_EncodeForPathBatch_T1_T5, []()
+    {
+        string lines = Args::Text<32767>(1);
+        string encoded;
+        encoded.reserve(lines.size());
+        bool firstLine = true;
+        for (auto line : Split(lines, '\n'))
         {
-            if(find(begin(InvalidFilePathChars), end(InvalidFilePathChars), ch) != end(InvalidFilePathChars) || std::iscntrl(ch))
-            {
-                static const char digits[] = "0123456789ABCDEF";
-                encoded.push_back(escapeChar);
-                encoded.push_back(digits[(ch >> 4) & 0xF]);
-                encoded.push_back(digits[ch & 0xF]);
-            }
-            else
-            {
-                if (escapeChar == ch)
-                    encoded.push_back(escapeChar);
-                encoded.push_back(ch);
-            }
+            if (!firstLine)
+                encoded.push_back('\n');
+            encoded.append(PathEncoding::Encode(TrimView(line)));
+            firstLine = false;
         }
         Returns::Text(5, encoded);
     });
 
-    dispatcher.SetAction(FILE_DecodeFromPath_T1_T5B5, []()
+    // Decodes each line of a newline separated list. A line that can not be decoded is returned empty.
+    // _argN5 is the number of lines that could not be decoded.
+    dispatcher.SetAction(FILE_DecodeFromPathBatch_T1_B5T5N5, []()
     {
-        bool success = true;
-        const char escapeChar = '%';
-        std::string encoded = Args::Text(1);
-        std::string original;
-        original.reserve(encoded.size());
-        std::string::iterator cur = encoded.begin();
-        while(cur != encoded.end())
-        {
-            std::string::iterator front = cur;
-            cur = find(front, encoded.end(), escapeChar);
-            copy(front, cur, back_inserter(original));
-            if (cur != encoded.end())
+        string lines = Args::Text<32767>(1);
+        string decoded, original;
+        decoded.reserve(lines.size());
+        int failedCount = 0;
+        bool firstLine = true;
+        for (auto encoded : Split(lines, '\n'))
+        {
+            if (!encoded.empty() && encoded.back() == '\r')
+                encoded.remove_suffix(1);
+            if (!PathEncoding::Decode(encoded, original))
             {
-                static const char digits[] = "0123456789ABCDEF";
-                size_t remaining = distance(++cur, encoded.end()); // move to the next char and get remaining length
-                if (remaining >= 1 && *cur == escapeChar) 
-                {   // a pair of escape chars "%%" equals a literal escape char '%'
-                    original.push_back(escapeChar);
-                }
-                else if(remaining >= 2)
-                {
-                    auto upper = find(digits, digits+sizeof(digits), *cur);
-                    auto lower = find(digits, digits+sizeof(digits), *++cur);
-                    if (end(digits) == upper || end(digits) == lower)
-                    {   // an escape char was followed by an invalid encoding value
-                        success = false;
-                        break;
-                    }
-                    original.push_back( static_cast<char>((distance(digits, upper)<<4) | distance(digits, lower)) );
-                }
-                else
-                {   // the string was not long enough to contain the encoded value following the escape char
-                    success = false;
-                    break;
-                }
-                ++cur;
+                ++failedCount;
+                original.clear();
             }
+            if (!firstLine)
+                decoded.push_back('\n');
+            decoded.append(original);
+            firstLine = false;
         }
-        Returns::Bool(5, success);
-        Returns::Text(5, original);
+        Returns::Text(5, decoded);
+        Returns::Num(5, failedCount);
+        Returns::Bool(5, failedCount == 0);
     });
 
     dispatcher.SetAction(FILE_IsDirectroyEmptyOrMissing_T1_B5, [] ()
@@ -474,49 +694,191 @@ bool SPOTPLUGINAPI SPOTPLUGIN_INIT_FUNC(host_action_func_t hostActionFunc, uintp
     // _argT5 contains the name of each specimen separated by a newline char '\n'
     dispatcher.SetAction(GetSpecimenList_T1_T5N5, []()
     {
-        vector<string> fileNames;
+        auto fileNames = ListSpecimens(Args::Text(1));
+        Returns::Text(5, JoinWith(fileNames.begin(), fileNames.end(), "\n"));
+        Returns::Num(5, fileNames.size()); 
+    });
+
+
+    // Get image file names in folder
+    dispatcher.SetAction(GetSpecimenImageList_T1T2_T5N5, []()
+    {
+        auto fileNames = ListSpecimenImages(Args::Text(1), Args::Text(2));
+        Returns::Text(5, JoinWith(fileNames.begin(), fileNames.end(), "\n"));
+        Returns::Num(5, fileNames.size()); 
+    });
+
+    // Get one page of the list of specimens within a case.
+    // Args:
+    // _argT1 - The case ID
+    // _argN1 - The index of the first item to return
+    // _argN2 - The maximum number of items to return. A value of zero or less returns the rest of the list.
+    // Returns:
+    // _argT5 contains the name of each specimen in the page separated by a newline char '\n'
+    // _argN5 contains the count of items in the whole list
+    dispatcher.SetAction(GetSpecimenListPage_T1N1N2_T5N5, []()
+    {
+        auto fileNames = ListSpecimens(Args::Text(1));
+        ReturnListPage(fileNames, Args::Num(1), Args::Num(2));
+    });
+
+    // Get one page of the image file names in a specimen folder.
+    // Args:
+    // _argT1 - The case ID
+    // _argT2 - The specimen
+    // _argN1, _argN2 - The index of the first item and the maximum number of items to return (see GetSpecimenListPage)
+    dispatcher.SetAction(GetSpecimenImageListPage_T1T2N1N2_T5N5, []()
+    {
+        auto fileNames = ListSpecimenImages(Args::Text(1), Args::Text(2));
+        ReturnListPage(fileNames, Args::Num(1), Args::Num(2));
+    });
+
+    // The cursor actions open a listing that is read one page at a time with ReadListCursor.
+    // The directory listings are read from the file system as the pages are read,
+    // so the first page is returned without listing the whole directory.
+    // Returns:
+    // _argT5 contains the token to pass to ReadListCursor and CloseListCursor
+    dispatcher.SetAction(OpenSpecimenListCursor_T1_T5, []()
+    {
+        string token;
         try
         {
-            sys::path directory = MGR::MasterCatalogFolder();
-            directory /= Args::Text(1); // Case ID
-            transform_if(sys::directory_iterator(directory), sys::directory_iterator(), back_inserter(fileNames),
-                         [] (const sys::path& item) { return item.filename();},
-                         [&] (const sys::path& item) { return sys::is_directory(directory/item); });
-            sort(fileNames.begin(), fileNames.end());
+            if (CaseArchive::IsArchived(GetCaseDirectory(Args::Text(1))))
+                token = ListingCursors::Instance().Open(ListingCursors::FromList(ListSpecimens(Args::Text(1))));
+            else
+                token = ListingCursors::Instance().Open(ListingCursors::FromDirectory(GetCaseDirectory(Args::Text(1)), [] (const DirectoryEntry& entry) { return entry.isDirectory; }));
         }
         catch(const std::system_error& ex)
         {
             OutputDebugString(ex.what());
+            token = ListingCursors::Instance().Open(ListingCursors::FromList(vector<string>()));
         }
-        Returns::Text(5, JoinWith(fileNames.begin(), fileNames.end(), "\n"));
-        Returns::Num(5, fileNames.size()); 
+        Returns::Text(5, token);
     });
 
+    dispatcher.SetAction(OpenSpecimenImageListCursor_T1T2_T5, []()
+    {
+        string token;
+        try
+        {
+            if (CaseArchive::IsArchived(GetCaseDirectory(Args::Text(1))))
+                token = ListingCursors::Instance().Open(ListingCursors::FromList(ListSpecimenImages(Args::Text(1), Args::Text(2))));
+            else
+                token = ListingCursors::Instance().Open(ListingCursors::FromDirectory(GetSpecimenDirectory(Args::Text(1), Args::Text(2)), IsSpecimenImageFile));
+        }
+        catch(const std::system_error& ex)
+        {
+            OutputDebugString(ex.what());
+            token = ListingCursors::Instance().Open(ListingCursors::FromList(vector<string>()));
+        }
+        Returns::Text(5, token);
+    });
 
-    // Get image file names in folder
-    dispatcher.SetAction(GetSpecimenImageList_T1T2_T5N5, []()
+    // Args:
+    // _argT1 - The words to search for (see SearchCatalog)
+    // Returns:
+    // _argT5 contains the cursor token
+    // _argN5 contains the total number of matches
+    dispatcher.SetAction(OpenCatalogSearchCursor_T1_T5N5, []()
+    {
+        size_t totalMatches = 0;
+        vector<string> matches;
+        try
+        {
+            matches = CatalogSearchIndex::Instance().Search(MGR::MasterCatalogFolder::Value(), Args::Text(1), 0, (std::numeric_limits<size_t>::max)(), totalMatches);
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugString(ex.what());
+        }
+        Returns::Text(5, ListingCursors::Instance().Open(ListingCursors::FromList(matches)));
+        Returns::Num(5, static_cast<double>(totalMatches));
+    });
+
+    // Reads the next page of a listing.
+    // Args:
+    // _argT1 - The cursor token
+    // _argN1 - The maximum number of items to return. A value of zero or less returns up to 50 items.
+    // Returns:
+    // _argT5 contains the items separated by a newline char '\n'
+    // _argN5 contains the number of items in _argT5
+    // _argB5 is true if there are more items to read. The cursor is closed once the last page is read.
+    dispatcher.SetAction(ReadListCursor_T1N1_B5T5N5, []()
     {
-        vector<string> fileNames;
+        int limit = static_cast<int>(Args::Num(1));
+        vector<string> page;
+        bool more = false;
         try
         {
-            sys::path directory = MGR::MasterCatalogFolder();
-            directory /= Args::Text(1); // Case ID
-            directory /= Args::Text(2); // Specimen number
-            if (directory.filename() == ".")
-                directory.remove_filename();
-            string regString = "^\\d+\\.([jJ][pP][gG2])";
-            regex imageFileNameRegEx(regString);
-            transform_if(sys::directory_iterator(directory), sys::directory_iterator(), back_inserter(fileNames),
-                         [] (const sys::path& item) { return item.filename();},
-                         [&imageFileNameRegEx] (const sys::path& item) { return regex_match(item.filename(), imageFileNameRegEx); });
-            sort(fileNames.begin(), fileNames.end());
+            more = ListingCursors::Instance().Read(Args::Text(1), limit > 0 ? limit : 50, page);
         }
         catch(const std::system_error& ex)
         {
             OutputDebugString(ex.what());
+            ListingCursors::Instance().Close(Args::Text(1));
         }
-        Returns::Text(5, JoinWith(fileNames.begin(), fileNames.end(), "\n"));
-        Returns::Num(5, fileNames.size()); 
+        Returns::Text(5, JoinWith(page.begin(), page.end(), "\n"));
+        Returns::Num(5, static_cast<double>(page.size()));
+        Returns::Bool(5, more);
+    });
+
+    dispatcher.SetAction(CloseListCursor_T1, []()
+    {
+        ListingCursors::Instance().Close(Args::Text(1));
+    });
+
+    // The channel actions write the whole result to a shared memory region (see ResultChannel.h)
+    // that external tools can read in place, or that macros can read a range at a time with ReadResultChannel.
+    // Returns:
+    // _argT5 contains the result handle. It is empty if the region could not be created.
+    // _argN5 contains the number of records in the result
+    dispatcher.SetAction(GetSpecimenListToChannel_T1_T5N5, []()
+    {
+        auto fileNames = ListSpecimens(Args::Text(1));
+        ReturnResultChannel(fileNames);
+    });
+
+    dispatcher.SetAction(GetSpecimenImageListToChannel_T1T2_T5N5, []()
+    {
+        auto fileNames = ListSpecimenImages(Args::Text(1), Args::Text(2));
+        ReturnResultChannel(fileNames);
+    });
+
+    dispatcher.SetAction(SearchCatalogToChannel_T1_T5N5, []()
+    {
+        size_t totalMatches = 0;
+        vector<string> matches;
+        try
+        {
+            matches = CatalogSearchIndex::Instance().Search(MGR::MasterCatalogFolder::Value(), Args::Text(1), 0, (std::numeric_limits<size_t>::max)(), totalMatches);
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugString(ex.what());
+        }
+        ReturnResultChannel(matches);
+    });
+
+    // Reads a range of records from a result channel.
+    // Args:
+    // _argT1 - The result handle
+    // _argN1 - The index of the first record
+    // _argN2 - The maximum number of records to read. A value of zero or less reads up to 50 records.
+    // Returns:
+    // _argT5 contains the records separated by a newline char '\n'
+    // _argN5 contains the number of records in _argT5
+    // _argB5 is false if the handle is no longer valid because a newer result replaced it
+    dispatcher.SetAction(ReadResultChannel_T1N1N2_B5T5N5, []()
+    {
+        int limit = static_cast<int>(Args::Num(2));
+        vector<string> records;
+        ResultChannelReader reader(Args::Text(1));
+        bool current = reader.ReadRecords(static_cast<size_t>(max(0.0, Args::Num(1))), limit > 0 ? limit : 50, records);
+        if (!current)
+            records.clear();
+        Returns::Text(5, JoinWith(records.begin(), records.end(), "\n"));
+        Returns::Num(5, static_cast<double>(records.size()));
+        Returns::Bool(5, current);
     });
 
     ///
@@ -536,6 +898,8 @@ bool SPOTPLUGINAPI SPOTPLUGIN_INIT_FUNC(host_action_func_t hostActionFunc, uintp
             else
                 sys::create_directories(catalogDir);
             MakeDefaultCatalogConfigDir(catalogDir, ImageCompression::Lossy);
+            CatalogCounters::Instance().Reset(catalogDir);
+            CaseIdIndex::Instance().Reset(catalogDir);
             success = true; 
         }
         catch(const std::exception& ex)
@@ -561,7 +925,14 @@ bool SPOTPLUGINAPI SPOTPLUGIN_INIT_FUNC(host_action_func_t hostActionFunc, uintp
             if(!IsValidCatalog(catalogDir))
                 throw std::runtime_error("The image catalog is incompatible with this application version.");
             if (CatalogNeedsToBeUpdated(catalogDir))
+            {
                 UpdateCatalog(catalogDir);
+                CatalogCounters::Instance().ScheduleRecount(catalogDir);
+            }
+            else
+                CatalogCounters::Instance().ScheduleRecountIfStale(catalogDir, CATALOG_RECOUNT_INTERVAL_SECONDS);
+            CaseIdIndex::Instance().ScheduleBuild(catalogDir);
+            CatalogSearchIndex::Instance().ScheduleBuild(catalogDir);
             success = true; 
         }
         catch(const std::exception& ex)
@@ -573,89 +944,724 @@ bool SPOTPLUGINAPI SPOTPLUGIN_INIT_FUNC(host_action_func_t hostActionFunc, uintp
         Returns::Bool(success);
     });
 
+    /// Rebuilds the search index of a catalog on a background thread.
+    /// Args:
+    ///     T1 - The path of the catalog
+    /// Returns:
+    ///     B5 - True if the build was started. False if a build is already in progress.
+    dispatcher.SetAction(BuildSearchIndex_T1_B5, []()
+    {
+        bool started = false;
+        try
+        {
+            started = CatalogSearchIndex::Instance().ScheduleBuild(Args::Text(1));
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugString(ex.what());
+        }
+        Returns::Bool(started);
+    });
+
+    /// Starts a search for identical images across a catalog on a background thread.
+    /// Args:
+    ///     T1 - The path of the catalog
+    /// Returns:
+    ///     B5 - True if the scan was started. False if a scan is already running.
+    dispatcher.SetAction(StartDuplicateImageScan_T1_B5, []()
+    {
+        Returns::Bool(DuplicateImageScan::Instance().Start(Args::Text(1)));
+    });
+
+    /// Gets the result of the last duplicate image scan.
+    /// Returns:
+    ///     B5 - True if the last scan has completed and no scan is running
+    ///     T4 - If the scan completed, a line of the form "<case ID>\t<reason>" for each case that could not be
+    ///          scanned, separated by a newline char '\n'. If the scan failed or was canceled, why.
+    ///     T5 - A result channel handle (see ReadResultChannel). Each record is a set of identical images
+    ///          with the paths relative to the catalog separated by a tab.
+    ///     N5 - The number of sets of identical images
+    dispatcher.SetAction(GetDuplicateImageScanResult__B5T4T5N5, []()
+    {
+        vector<string> duplicates;
+        vector<string> failedCases;
+        string status;
+        bool completed = DuplicateImageScan::Instance().GetResult(duplicates, failedCases, status) && !DuplicateImageScan::Instance().IsRunning();
+        ReturnResultChannel(duplicates);
+        Returns::Text(4, completed ? JoinWith(failedCases.begin(), failedCases.end(), "\n") : status);
+        Returns::Bool(5, completed);
+    });
+
+    /// Starts writing a report of every case in the current catalog on a background thread.
+    /// Args:
+    ///     T1 - The report file to create
+    ///     T2 - The format: CSV, or JSON for a JSON object on each line
+    /// Returns:
+    ///     B5 - True if the export was started. False if an export is already running or the format is not known.
+    dispatcher.SetAction(ExportCatalogReport_T1T2_B5, []()
+    {
+        string format = TrimCopy(Args::Text(2));
+        bool started = false;
+        if (AreEqualIgnoreCase(boost::string_ref(format), boost::string_ref("CSV")))
+            started = CatalogReportExport::Instance().Start(MGR::MasterCatalogFolder::Value(), Args::Text(1), ReportFormat::Csv);
+        else if (AreEqualIgnoreCase(boost::string_ref(format), boost::string_ref("JSON")))
+            started = CatalogReportExport::Instance().Start(MGR::MasterCatalogFolder::Value(), Args::Text(1), ReportFormat::JsonLines);
+        Returns::Bool(started);
+    });
+
+    /// Gets the progress of the last catalog report export.
+    /// Returns:
+    ///     B5 - True while the export is running
+    ///     T5 - Why the export failed. Empty while running or if it succeeded.
+    ///     N4 - The number of cases written
+    ///     N5 - The number of cases in the catalog
+    dispatcher.SetAction(GetCatalogReportProgress__B5T5N4N5, []()
+    {
+        ReportExportProgress progress = CatalogReportExport::Instance().Progress();
+        Returns::Text(5, progress.status);
+        Returns::Num(4, static_cast<double>(progress.casesWritten));
+        Returns::Num(5, static_cast<double>(progress.totalCases));
+        Returns::Bool(progress.running);
+    });
+
     dispatcher.SetAction(IsValidCatalog_T1_B5, []()
     {
         Returns::Bool(IsValidCatalog(Args::Text(1)));
     });
 
+    /// Locks a case so that it cannot be opened for editing on another workstation.
+    /// The lock is a lease that is renewed in the background while this workstation holds it.
+    /// Args:
+    ///     T1 - The case ID
+    /// Returns:
+    ///     B5 - True if this workstation owns the lock
+    ///     T5 - If B5 is false this contains the lock details of the current holder.
     dispatcher.SetAction(LockCase_T1_T5B5, []()
     {
-        string caseName = Args::Text(1);
-        sys::path lockFileName = GetCaseLockFilePath(caseName);
-        const bool lockFileExits = sys::exists(lockFileName);
-        if(lockFileExits)
+        string currentHolder;
+        bool locked = CaseLockManager::Instance().Acquire(GetCaseLockFilePath(Args::Text(1)), HostInterop::GetTextVariable("CurUserName"), currentHolder);
+        if (!locked)
+            Returns::Text(currentHolder);
+        Returns::Bool(locked);
+    });    
+
+    dispatcher.SetAction(UnlockCase_T1, []()
+    {
+        CaseLockManager::Instance().Release(GetCaseLockFilePath(Args::Text(1)));
+        ThumbnailCache::Instance().OnCaseClosed(MGR::MasterCatalogFolder::Value(), Args::Text(1));
+    });    
+
+    /// Gets the lock holder of many cases at once.
+    /// Args:
+    ///     T1 - The case IDs separated by a newline char '\n'
+    /// Returns:
+    ///     T5 - The lock holder of each case in the same order separated by a newline char '\n'.
+    ///          The entry is empty if the case is not locked.
+    ///     N5 - The number of cases that are locked
+    dispatcher.SetAction(GetCaseLockHolders_T1_T5N5, []()
+    {
+        sys::path catalogPath = MGR::MasterCatalogFolder::Value();
+        string caseIds = Args::Text<32767>(1);
+        vector<sys::path> lockFiles;
+        for (auto caseId : Split(caseIds, '\n'))
         {
-            Returns::Text(ReadFileToString(lockFileName));
+            caseId = TrimView(caseId);
+            lockFiles.push_back(catalogPath / sys::path(string(caseId.begin(), caseId.end())) / sys::path("case.lock"));
         }
-        else
+        vector<string> holders;
+        int lockedCount = 0;
+        for (auto& lockInfo : CaseLockManager::QueryLocks(lockFiles))
         {
-            using std::chrono::system_clock;
-            using boost::uuids::uuid;
+            if (!lockInfo.userName.empty() || !lockInfo.id.empty())
+                ++lockedCount;
+            holders.push_back(lockInfo.hostName.empty() ? lockInfo.userName : lockInfo.userName + " (" + lockInfo.hostName + ")");
+        }
+        Returns::Text(5, JoinWith(holders.begin(), holders.end(), "\n"));
+        Returns::Num(5, lockedCount);
+    });
+
+
+    dispatcher.SetAction(GetAccessionPrefixes__T5N5, []()
+    {
+        AccessionPrefixTable& prefixTable = AccessionPrefixTable::Instance();
+        prefixTable.Refresh(CatalogConfigDirectory() /= ACCESSION_PREFIX_FILENAME);
+        Returns::Num(static_cast<double>(prefixTable.Prefixes().size()));
+        Returns::Text(prefixTable.PrefixList());
+    });
 
-            ofstream lockFileStream(lockFileName);
-            lockFileStream << "User: " << HostInterop::GetTextVariable("CurUserName") << std::endl;
-            time_t tt = system_clock::to_time_t(system_clock::now());
-            lockFileStream << "Locked On: " << ctime(&tt)
-                           << "Id: " << to_string(uuids::random_generator()());
-            lockedCases.push_back(caseName);
+    dispatcher.SetAction(GetAccessionPrefixDesciption_T1_T5, []()
+    {
+        AccessionPrefixTable& prefixTable = AccessionPrefixTable::Instance();
+        prefixTable.Refresh(CatalogConfigDirectory() /= ACCESSION_PREFIX_FILENAME);
+        string description;
+        prefixTable.TryGetDescription(TrimRightCopy(Args::Text(1)), description);
+        Returns::Text(description);
+    });
+    
+
+    /// Finds the case IDs and accession prefixes that start with the text typed so far.
+    /// Args:
+    ///     T1 - The text to match to the start of the case IDs. The match is not case sensitive.
+    ///     N1 - The maximum number of items to return in each list. A value of zero or less returns up to 20 items.
+    /// Returns:
+    ///     T5 - The matching case IDs in sorted order separated by a newline char '\n'
+    ///     N5 - The number of case IDs in T5
+    ///     T4 - The matching accession prefixes in file order separated by a newline char '\n'
+    ///     N4 - The number of prefixes in T4
+    ///     B5 - False if the case IDs of the catalog are still being read in the background and T5 is empty. Call again later.
+    dispatcher.SetAction(AutocompleteCaseId_T1N1_B5T4T5N4N5, []()
+    {
+        string typed = TrimLeftCopy(Args::Text(1));
+        int maxResults = static_cast<int>(Args::Num(1));
+        if (maxResults <= 0)
+            maxResults = 20;
+
+        bool ready = false;
+        auto caseIds = CaseIdIndex::Instance().FindByPrefix(MGR::MasterCatalogFolder::Value(), typed, maxResults, ready);
+        Returns::Text(5, JoinWith(caseIds.begin(), caseIds.end(), "\n"));
+        Returns::Num(5, static_cast<double>(caseIds.size()));
+        Returns::Bool(ready);
+
+        AccessionPrefixTable& prefixTable = AccessionPrefixTable::Instance();
+        prefixTable.Refresh(CatalogConfigDirectory() /= ACCESSION_PREFIX_FILENAME);
+        vector<string> prefixes;
+        for (auto& prefix : prefixTable.Prefixes())
+        {
+            if (prefixes.size() >= static_cast<size_t>(maxResults))
+                break;
+            if (!prefix.empty() && prefix.size() >= typed.size() && AreEqualIgnoreCase(boost::string_ref(prefix).substr(0, typed.size()), typed))
+                prefixes.push_back(prefix);
         }
-        Returns::Bool(!lockFileExits);
-    });    
+        Returns::Text(4, JoinWith(prefixes.begin(), prefixes.end(), "\n"));
+        Returns::Num(4, static_cast<double>(prefixes.size()));
+    });
 
-    dispatcher.SetAction(UnlockCase_T1, []()
+    /// Finds the cases, specimens and images whose names, image titles or image memos contain all of the words in a query.
+    /// Args:
+    ///     T1 - The words to search for. Each word matches any word that starts with it.
+    ///     N1 - The number of matches to skip (for paging)
+    ///     N2 - The maximum number of matches to return. A value of zero or less returns up to 50 matches.
+    /// Returns:
+    ///     T5 - The paths of the matches relative to the catalog folder, best match first, separated by a newline char '\n'
+    ///     N5 - The total number of matches
+    ///     B5 - False if the search index is still being loaded or built for the first time. The results may be incomplete.
+    dispatcher.SetAction(SearchCatalog_T1N1N2_B5T5N5, []()
     {
-        string caseName = Args::Text(1);
-        auto item = remove(lockedCases.begin(), lockedCases.end(), caseName);
-        lockedCases.erase(item, lockedCases.end());
-        sys::remove(GetCaseLockFilePath(caseName));
-    });    
+        int offset = max(0, static_cast<int>(Args::Num(1)));
+        int limit = static_cast<int>(Args::Num(2));
+        if (limit <= 0)
+            limit = 50;
+        size_t totalMatches = 0;
+        vector<string> matches;
+        try
+        {
+            matches = CatalogSearchIndex::Instance().Search(MGR::MasterCatalogFolder::Value(), Args::Text(1), offset, limit, totalMatches);
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugString(ex.what());
+        }
+        Returns::Text(JoinWith(matches.begin(), matches.end(), "\n"));
+        Returns::Num(static_cast<double>(totalMatches));
+        Returns::Bool(!CatalogSearchIndex::Instance().IsBuilding() || totalMatches > 0);
+    });
 
+    /// Adds the title and memo of the open image to the search index.
+    /// Call this after the image title or memo has been saved.
+    /// Args:
+    ///     T1 - The full path of the image file within the master catalog
+    dispatcher.SetAction(IndexImageText_T1, []()
+    {
+        string text = HostInterop::GetTextVariable("ImgTitle") + "\n" + HostInterop::GetTextVariable("ImgMemo");
+        try
+        {
+            CatalogSearchIndex::Instance().SetItemText(MGR::MasterCatalogFolder::Value(), Args::Text(1), text);
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugString(ex.what());
+        }
+    });
 
-    dispatcher.SetAction(GetAccessionPrefixes__T5N5, []()
+    /// Gets the location of the thumbnail of a catalog image within its case thumbnail pack.
+    /// If the thumbnail is missing or out of date it is created in the background. Call again later to get it.
+    /// Args:
+    ///     T1 - The full path of the image file
+    /// Returns:
+    ///     B5 - True if the thumbnail is up to date
+    ///     T5 - The path of the pack file
+    ///     N4 - The offset of the JPEG data within the pack file
+    ///     N5 - The length of the JPEG data
+    dispatcher.SetAction(GetThumbnailLocation_T1_B5T5N4N5, []()
+    {
+        ThumbnailLocation location;
+        bool ready = false;
+        try
+        {
+            ready = ThumbnailCache::Instance().Lookup(MGR::MasterCatalogFolder::Value(), Args::Text(1), location);
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugString(ex.what());
+        }
+        Returns::Text(5, location.packFile);
+        Returns::Num(4, static_cast<double>(location.offset));
+        Returns::Num(5, location.length);
+        Returns::Bool(5, ready);
+    });
+
+    /// Writes the thumbnail of a catalog image to a JPEG file so that it can be loaded by the host.
+    /// Args:
+    ///     T1 - The full path of the image file
+    ///     T2 - The path of the JPEG file to write
+    /// Returns:
+    ///     B5 - True if the file was written. False if the thumbnail is not ready yet.
+    dispatcher.SetAction(SaveThumbnail_T1T2_B5, []()
     {
-        sys::path accessionPrefixFile = CatalogConfigDirectory() /= ACCESSION_PREFIX_FILENAME;
-        string result;
-        int count = 0;
-        if (sys::exists(accessionPrefixFile))
+        bool saved = false;
+        try
         {
-            for (auto &line : ReadFileToStrings(accessionPrefixFile.string()))
+            vector<uint8_t> jpeg;
+            if (ThumbnailCache::Instance().Read(MGR::MasterCatalogFolder::Value(), Args::Text(1), jpeg))
             {
-                line.erase(find(line.begin(), line.end(), '-'), line.end());
-                Trim(line);
-                result.append(line).append("\n");
-                ++count;
+                ofstream file(Args::Text(2), ios::out | ios::trunc | ios::binary);
+                file.write(reinterpret_cast<const char*>(jpeg.data()), jpeg.size());
+                saved = file.good();
             }
         }
-        Returns::Num(count);
-        Returns::Text(result);
+        catch(const std::exception& ex)
+        {
+            OutputDebugString(ex.what());
+        }
+        Returns::Bool(5, saved);
     });
 
-    dispatcher.SetAction(GetAccessionPrefixDesciption_T1_T5, []()
+    /// Creates the missing or out of date thumbnails of every image in a case in the background.
+    /// Args:
+    ///     T1 - The case ID
+    /// Returns:
+    ///     N5 - The number of thumbnails queued
+    dispatcher.SetAction(CreateCaseThumbnails_T1_N5, []()
     {
-        bool foundItem = false;
-        string casePrefix = TrimRightCopy(Args::Text(1));
-        sys::path accessionPrefixFile = CatalogConfigDirectory() /= ACCESSION_PREFIX_FILENAME;
-        if (sys::exists(accessionPrefixFile))
+        size_t queued = 0;
+        try
         {
-            for (auto &line : ReadFileToStrings(accessionPrefixFile.string()))
+            queued = ThumbnailCache::Instance().ScheduleCase(MGR::MasterCatalogFolder::Value(), Args::Text(1));
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugString(ex.what());
+        }
+        Returns::Num(5, static_cast<double>(queued));
+    });
+
+    /// Starts checking the images of a case against the content hashes recorded the last time it was checked.
+    /// The images are hashed on a background thread. Use GetCaseVerificationProgress for the result.
+    /// Args:
+    ///     T1 - The case ID
+    /// Returns:
+    ///     B5 - True if the check was started. False if a check is already running.
+    dispatcher.SetAction(StartCaseVerification_T1_B5, []()
+    {
+        Returns::Bool(CaseVerification::Instance().Start(MGR::MasterCatalogFolder::Value(), Args::Text(1)));
+    });
+
+    /// Gets the progress of the last case check started with StartCaseVerification.
+    /// Returns:
+    ///     B4 - True while the check is running
+    ///     B5 - True if the check completed and no image is corrupt, missing or unreadable
+    ///     T5 - Once the check completed, a line for each difference of the form "<kind>\t<specimen>\\<image>"
+    ///          separated by a newline char '\n'. Kind is corrupt, missing, unreadable, changed or new.
+    ///          If the check failed, why it failed.
+    ///     N4 - The number of images hashed so far
+    ///     N5 - The number of images to check
+    dispatcher.SetAction(GetCaseVerificationProgress__B4B5T5N4N5, []()
+    {
+        CaseVerificationProgress progress = CaseVerification::Instance().Progress();
+        if (progress.completed)
+            Returns::Text(5, JoinWith(progress.problems.begin(), progress.problems.end(), "\n"));
+        else
+            Returns::Text(5, progress.status);
+        Returns::Num(4, static_cast<double>(progress.imagesHashed));
+        Returns::Num(5, static_cast<double>(progress.imagesToHash));
+        Returns::Bool(4, progress.running);
+        Returns::Bool(5, progress.intact);
+    });
+
+    /// Mirrors the master catalog, or some of its cases, to a replica folder in the background.
+    /// Only new and changed files are copied. Progress is reported in the MGR_bReplicationRunning,
+    /// MGR_iReplicationFilesCopied, MGR_dReplicationMegabytesCopied, MGR_dReplicationMegabytesPerSecond
+    /// and MGR_strReplicationStatus variables.
+    /// Args:
+    ///     T1 - The replica folder. It must be empty or a previous replica of the catalog.
+    ///     T2 - The case IDs to replicate separated by a newline char '\n'. Empty to replicate the whole catalog.
+    /// Returns:
+    ///     B5 - True if the replication was started
+    ///     T5 - If B5 is false this contains the reason
+    dispatcher.SetAction(ReplicateCatalog_T1T2_B5T5, []()
+    {
+        bool started = false;
+        try
+        {
+            string caseIdList = Args::Text<32767>(2);
+            vector<string> caseIds;
+            for (auto caseId : Split(caseIdList, '\n'))
             {
-                auto entry = Explode(line, '-');
-                if (entry.size() > 1) 
-                {
-                    Trim(entry[0]);
-                    if(entry[0] == casePrefix)
-                    {
-                        Returns::Text(TrimCopy(entry[1]));
-                        foundItem = true;
-                        break;
-                    }
-                }
+                caseId = TrimView(caseId);
+                if (!caseId.empty())
+                    caseIds.push_back(string(caseId.begin(), caseId.end()));
             }
+            started = CatalogReplicator::Instance().Start(MGR::MasterCatalogFolder::Value(), Args::Text(1), caseIds);
+            if (!started)
+                Returns::Text("A replication is already running.");
         }
-        if (!foundItem)
-            Returns::Text("");
+        catch(const std::exception& ex)
+        {
+            OutputDebugString(ex.what());
+            Returns::Text(ex.what());
+        }
+        Returns::Bool(started);
+    });
+
+    dispatcher.SetAction(StopReplication, []()
+    {
+        CatalogReplicator::Instance().Stop();
+    });
+
+    /// Starts packing the contents of a closed case into a single archive file in the case folder.
+    /// The files are copied on a background thread. Use GetCaseArchiveProgress for the result.
+    /// The specimen and image lists of an archived case are read from the archive.
+    /// Args:
+    ///     T1 - The case ID
+    /// Returns:
+    ///     B5 - True if archiving was started. False if an archive or restore is already running.
+    dispatcher.SetAction(ArchiveCase_T1_B5, []()
+    {
+        Returns::Bool(CaseArchiveJob::Instance().StartCreate(GetCaseDirectory(Args::Text(1)), HostInterop::GetTextVariable("CurUserName")));
+    });
+
+    /// Starts restoring the contents of an archived case on a background thread.
+    /// Use GetCaseArchiveProgress for the result.
+    /// Args:
+    ///     T1 - The case ID
+    /// Returns:
+    ///     B5 - True if the restore was started. False if an archive or restore is already running.
+    dispatcher.SetAction(UnarchiveCase_T1_B5, []()
+    {
+        Returns::Bool(CaseArchiveJob::Instance().StartExtract(GetCaseDirectory(Args::Text(1)), HostInterop::GetTextVariable("CurUserName")));
+    });
+
+    /// Gets the progress of the last case archive or restore.
+    /// Returns:
+    ///     B4 - True while the case is being archived or restored
+    ///     B5 - True if the last archive or restore completed
+    ///     T5 - Why the last archive or restore failed. Empty while running or if it completed.
+    ///     N4 - The number of files copied so far
+    ///     N5 - The number of files to copy
+    dispatcher.SetAction(GetCaseArchiveProgress__B4B5T5N4N5, []()
+    {
+        CaseArchiveProgress progress = CaseArchiveJob::Instance().Progress();
+        Returns::Text(5, progress.status);
+        Returns::Num(4, static_cast<double>(progress.filesCopied));
+        Returns::Num(5, static_cast<double>(progress.totalFiles));
+        Returns::Bool(4, progress.running);
+        Returns::Bool(5, progress.completed);
+    });
+
+    dispatcher.SetAction(IsCaseArchived_T1_B5, []()
+    {
+        Returns::Bool(CaseArchive::IsArchived(GetCaseDirectory(Args::Text(1))));
+    });
+
+    /// Starts watching a host variable for changes. Its value is read when the host is idle instead of
+    /// by a macro loop, and VAR_GetChangedVariables reports it once it changes.
+    /// Args:
+    ///     T1 - The name of the variable
+    ///     T2 - The type of the variable: Bool, Integer, Numeric or Text
+    /// Returns:
+    ///     B5 - False if the type is not known
+    dispatcher.SetAction(VAR_WatchVariable_T1T2_B5, []()
+    {
+        static const pair<const char*, HostInterop::VariableType> types[] =
+        {
+            make_pair("Bool", HostInterop::VariableType::Bool),
+            make_pair("Integer", HostInterop::VariableType::Integer),
+            make_pair("Numeric", HostInterop::VariableType::Numeric),
+            make_pair("Text", HostInterop::VariableType::Text)
+        };
+        string typeName = TrimCopy(Args::Text(2));
+        for (auto& type : types)
+        {
+            if (AreEqualIgnoreCase(boost::string_ref(typeName), boost::string_ref(type.first)))
+            {
+                VariableWatcher::Instance().Watch(Args::Text(1), type.second);
+                Returns::Bool(true);
+                return;
+            }
+        }
+        Returns::Bool(false);
+    });
+
+    dispatcher.SetAction(VAR_UnwatchVariable_T1, []()
+    {
+        VariableWatcher::Instance().Unwatch(Args::Text(1));
+    });
+
+    /// Sets how often the watched variables are read, in milliseconds.
+    dispatcher.SetAction(VAR_SetWatchInterval_N1, []()
+    {
+        VariableWatcher::Instance().Interval(static_cast<ULONGLONG>(max(0.0, Args::Num(1))));
+    });
+
+    /// Gets the watched variables that changed since the last call.
+    /// Returns:
+    ///     T5 - The names of the changed variables separated by a newline char '\n'
+    ///     N5 - The number of changed variables
+    dispatcher.SetAction(VAR_GetChangedVariables__T5N5, []()
+    {
+        auto changed = VariableWatcher::Instance().TakeChanges();
+        Returns::Text(5, JoinWith(changed.begin(), changed.end(), "\n"));
+        Returns::Num(5, static_cast<double>(changed.size()));
+    });
+
+    /// Summarizes a series of numbers, such as a set of measurements, without parsing it in the macro.
+    /// Args:
+    ///     T1 - The numbers separated by ';'
+    /// Returns:
+    ///     B5 - False if an item of the list is not a number
+    ///     N2 - The number of values that are not NaN
+    ///     N3 - The smallest value
+    ///     N4 - The largest value
+    ///     N5 - The mean of the values
+    ///     N3 to N5 are 0 if there are no values.
+    dispatcher.SetAction(VAR_SummarizeNumberList_T1_B5N2N3N4N5, []()
+    {
+        vector<double> values;
+        bool isList = NumberList::Decode(Args::Text<32767>(1), values);
+        NumberList::Summary summary = NumberList::Summarize(values);
+        if (summary.count == 0)
+            summary.minimum = summary.maximum = summary.mean = 0;
+        Returns::Num(2, static_cast<double>(summary.count));
+        Returns::Num(3, summary.minimum);
+        Returns::Num(4, summary.maximum);
+        Returns::Num(5, summary.mean);
+        Returns::Bool(isList);
+    });
+
+    /// Saves the values of all the standard host variables to a snapshot file in one pass.
+    /// A later save to the same file only appends the values that changed.
+    /// Args:
+    ///     T1 - The snapshot file
+    /// Returns:
+    ///     B5 - True if the snapshot was saved
+    ///     T5 - If B5 is false this contains the reason
+    dispatcher.SetAction(VAR_SaveSnapshot_T1_B5T5, []()
+    {
+        bool success = false;
+        try
+        {
+            VariableManager::StandardVars().SaveSnapshot(Args::Text(1));
+            success = true;
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugString(ex.what());
+            Returns::Text(ex.what());
+        }
+        Returns::Bool(success);
+    });
+
+    /// Restores the standard host variables saved by VAR_SaveSnapshot.
+    /// Args:
+    ///     T1 - The snapshot file
+    /// Returns:
+    ///     B5 - True if every variable in the snapshot was restored
+    ///     T5 - A line of the form "<name>: <reason>" for each variable that could not be restored separated by
+    ///          a newline char '\n', or the reason the file could not be read
+    ///     N5 - The number of variables restored
+    dispatcher.SetAction(VAR_RestoreSnapshot_T1_B5T5N5, []()
+    {
+        vector<string> failures;
+        size_t restored = 0;
+        try
+        {
+            restored = VariableManager::StandardVars().RestoreSnapshot(Args::Text(1), failures);
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugString(ex.what());
+            failures.push_back(ex.what());
+        }
+        Returns::Text(5, JoinWith(failures.begin(), failures.end(), "\n"));
+        Returns::Num(5, static_cast<double>(restored));
+        Returns::Bool(5, failures.empty());
+    });
+
+    /// Starts acquiring an image at a fixed rate for a time-lapse. Shots are planned from the start time so a
+    /// late shot does not delay the ones after it. If a shot is so late that the next one is already due it is skipped.
+    /// Args:
+    ///     N1 - The time between shots in milliseconds
+    ///     N2 - The number of shots. 0 acquires until ACQ_Stop.
+    /// Returns:
+    ///     B5 - False if an acquisition schedule is already running or the interval is not positive
+    dispatcher.SetAction(ACQ_StartFixedRate_N1N2_B5, []()
+    {
+        Returns::Bool(AcquisitionScheduler::Instance().StartFixedRate(static_cast<int64_t>(Args::Num(1) * 1000),
+                                                                      static_cast<size_t>(max(0.0, Args::Num(2)))));
+    });
+
+    /// Starts acquiring an image a fixed time after each acquisition completes.
+    /// Args:
+    ///     N1 - The time between the end of one acquisition and the start of the next in milliseconds
+    ///     N2 - The number of shots. 0 acquires until ACQ_Stop.
+    /// Returns:
+    ///     B5 - False if an acquisition schedule is already running or the delay is negative
+    dispatcher.SetAction(ACQ_StartFixedDelay_N1N2_B5, []()
+    {
+        Returns::Bool(AcquisitionScheduler::Instance().StartFixedDelay(static_cast<int64_t>(Args::Num(1) * 1000),
+                                                                       static_cast<size_t>(max(0.0, Args::Num(2)))));
+    });
+
+    /// Starts acquiring an image at each of a list of times.
+    /// Args:
+    ///     T1 - The times in milliseconds from now separated by ';' (e.g. "0;100;250")
+    /// Returns:
+    ///     B5 - False if an acquisition schedule is already running or the list is empty or not valid
+    dispatcher.SetAction(ACQ_StartBurst_T1_B5, []()
+    {
+        vector<double> times;
+        vector<int64_t> offsets;
+        if (NumberList::Decode(Args::Text<32767>(1), times))
+        {
+            for (auto time : times)
+                offsets.push_back(static_cast<int64_t>(time * 1000));
+        }
+        Returns::Bool(!offsets.empty() && AcquisitionScheduler::Instance().StartBurst(offsets));
+    });
+
+    dispatcher.SetAction(ACQ_Stop, []()
+    {
+        AcquisitionScheduler::Instance().Stop();
+    });
+
+    /// Gets the state of the current or last acquisition schedule.
+    /// Returns:
+    ///     B5 - True while the schedule is running
+    ///     N2 - The number of acquisitions requested
+    ///     N3 - The number of shots skipped because a later one was already due
+    ///     N4 - The latest a shot was taken after its planned time in milliseconds
+    ///     N5 - The mean time shots were taken after their planned times in milliseconds
+    dispatcher.SetAction(ACQ_GetStatus__B5N2N3N4N5, []()
+    {
+        const AcquisitionStatus& status = AcquisitionScheduler::Instance().Status();
+        Returns::Num(2, static_cast<double>(status.issued));
+        Returns::Num(3, static_cast<double>(status.missed));
+        Returns::Num(4, status.maxLateness / 1000.0);
+        Returns::Num(5, status.issued > 0 ? status.totalLateness / 1000.0 / status.issued : 0.0);
+        Returns::Bool(status.running);
+    });
+
+    /// Gets how late the shots of the current or last schedule were taken as a histogram.
+    /// Returns:
+    ///     T5 - A line for each range separated by a newline char '\n'. Each line is the upper bound of the range
+    ///          in milliseconds (e.g. "<=5ms", or ">200ms" for the last range), a tab char and the number of shots.
+    ///     N5 - The number of ranges
+    dispatcher.SetAction(ACQ_GetJitterHistogram__T5N5, []()
+    {
+        const vector<int64_t>& buckets = AcquisitionScheduler::JitterBuckets();
+        const vector<size_t>& jitter = AcquisitionScheduler::Instance().Status().jitter;
+        vector<string> lines;
+        for (size_t index = 0; index < jitter.size(); ++index)
+        {
+            ostringstream line;
+            if (index < buckets.size())
+                line << "<=" << buckets[index] / 1000 << "ms";
+            else
+                line << ">" << buckets.back() / 1000 << "ms";
+            line << '\t' << jitter[index];
+            lines.push_back(line.str());
+        }
+        Returns::Text(5, JoinWith(lines.begin(), lines.end(), "\n"));
+        Returns::Num(5, static_cast<double>(lines.size()));
+    });
+
+    /// Publishes the planned and actual time of each shot of the current or last schedule to the result channel.
+    /// Each item is the planned time, a tab char, the actual time, a tab char and 1 if the acquisition succeeded
+    /// otherwise 0. The times are in milliseconds from the start of the schedule.
+    /// Returns:
+    ///     T5 - The handle to read the items with ReadResultChannel
+    ///     N5 - The number of shots
+    dispatcher.SetAction(ACQ_GetShotTimes__T5N5, []()
+    {
+        const vector<AcquisitionShot>& shots = AcquisitionScheduler::Instance().Shots();
+        vector<string> items;
+        items.reserve(shots.size());
+        for (auto& shot : shots)
+        {
+            ostringstream item;
+            item << fixed << setprecision(3) << shot.planned / 1000.0 << '\t' << shot.actual / 1000.0 << '\t' << (shot.succeeded ? 1 : 0);
+            items.push_back(item.str());
+        }
+        ReturnResultChannel(items);
+    });
+
+    /// Turns the live video frame rate monitor on or off. It is off by default so the host's live video
+    /// variables are not read on idle ticks unless a macro asks for the figures.
+    /// Args:
+    ///     B1 - True to measure the frame rate whenever the live video is running
+    dispatcher.SetAction(LIVE_EnableFrameMonitor_B1, []()
+    {
+        LiveVideoMonitor::Instance().Enable(Args::Bool(1));
+    });
+
+    /// Gets the frame rate of the running or last live video. The same figures are kept in the MGR_dLive...
+    /// host variables if the macros define them.
+    /// Returns:
+    ///     B5 - True while the live video is being measured
+    ///     T5 - A line that summarizes the figures
+    ///     N2 - The frame rate over the last 2 seconds
+    ///     N3 - The median time between frames in milliseconds
+    ///     N4 - The 99th percentile of the time between frames in milliseconds
+    ///     N5 - The estimated number of dropped frames
+    dispatcher.SetAction(LIVE_GetFrameStats__B5T5N2N3N4N5, []()
+    {
+        const LiveVideoStats& stats = LiveVideoMonitor::Instance().Stats();
+        Returns::Num(2, stats.windowFps);
+        Returns::Num(3, stats.intervalP50);
+        Returns::Num(4, stats.intervalP99);
+        Returns::Num(5, static_cast<double>(stats.droppedFrames));
+        Returns::Text(5, LiveVideoMonitor::Instance().Summary());
+        Returns::Bool(stats.running);
+    });
+
+    /// Starts reporting the plug-in actions, host events and host requests that keep the host busy
+    /// for longer than a threshold. Must be called from the host's UI thread, as actions are.
+    /// Args:
+    ///     T1 - The file the stall reports are appended to
+    ///     N1 - How long a call may run before it is reported in milliseconds. 0 uses 2000 ms.
+    /// Returns:
+    ///     B5 - False if the report file cannot be written
+    dispatcher.SetAction(DIAG_StartStallWatchdog_T1N1_B5, []()
+    {
+        unsigned threshold = static_cast<unsigned>(max(0.0, Args::Num(1)));
+        if (threshold == 0)
+            threshold = StallWatchdog::DefaultThresholdMilliseconds;
+        Returns::Bool(StallWatchdog::Instance().Start(Args::Text(1), threshold));
+    });
+
+    dispatcher.SetAction(DIAG_StopStallWatchdog, []()
+    {
+        StallWatchdog::Instance().Stop();
+    });
+
+    /// Returns:
+    ///     B5 - True while the stall watchdog is running
+    ///     N5 - The number of stalls reported since it was started
+    dispatcher.SetAction(DIAG_GetStallCount__B5N5, []()
+    {
+        Returns::Num(5, static_cast<double>(StallWatchdog::Instance().StallCount()));
+        Returns::Bool(StallWatchdog::Instance().IsRunning());
     });
-    
 
     /// Renames a case
     /// Args:
@@ -667,7 +1673,7 @@ bool SPOTPLUGINAPI SPOTPLUGIN_INIT_FUNC(host_action_func_t hostActionFunc, uintp
     dispatcher.SetAction(RenameCase_T1T2_B5T5, []()
     {
         bool success = false;
-        sys::path catalogPath = MGR::MasterCatalogFolder();
+        sys::path catalogPath = MGR::MasterCatalogFolder::Value();
         sys::path oldpath = catalogPath/sys::path(Args::Text(1));
         sys::path newPath = catalogPath/sys::path(Args::Text(2));
         if (sys::exists( oldpath ))
@@ -676,6 +1682,14 @@ bool SPOTPLUGINAPI SPOTPLUGIN_INIT_FUNC(host_action_func_t hostActionFunc, uintp
                 Returns::Text("Cannot rename. The case " + Args::Text(2) + " already exists in the catalog.");
             else if(!(success = sys::rename(oldpath, newPath)))
                 Returns::Text("Unable to update the image catalog. Check your system to ensure that you have privileges to write to the catalog location.");
+            else
+            {
+                CaseIdIndex::Instance().OnCaseRenamed(catalogPath, Args::Text(1), Args::Text(2));
+                CatalogSearchIndex::Instance().OnCaseRenamed(catalogPath, Args::Text(1), Args::Text(2));
+                CaseManifest::OnCaseRenamed(catalogPath, Args::Text(1), Args::Text(2));
+                ThumbnailCache::Instance().OnCaseRenamed(catalogPath, Args::Text(1), Args::Text(2));
+                CatalogReplicator::RecordCaseRename(catalogPath, Args::Text(1), Args::Text(2));
+            }
         }
         else
             Returns::Text("The case "+ Args::Text(1) + " could not be found in the catalog.");
@@ -706,8 +1720,17 @@ bool SPOTPLUGINAPI SPOTPLUGIN_INIT_FUNC(host_action_func_t hostActionFunc, uintp
                 time_t createdTime = pt.get<time_t>("details.createOn", last_write_time(catalogPath));
                 msg << "Version: " << pt.get("details.version", 0) << endl
                     << "Uid: " << pt.get("details.uid", "<undefined>") << endl
-                    << "Created On: " << ctime(&createdTime)
-                    << "Case Count: " << GetNumberOfCasesInCatalog(catalogPath);
+                    << "Created On: " << ctime(&createdTime);
+                CatalogCounts counts = CatalogCounters::Instance().Get(catalogPath);
+                if (counts.reconciledOn != 0)
+                {
+                    msg << "Case Count: " << counts.cases << endl
+                        << "Specimen Count: " << counts.specimens << endl
+                        << "Image Count: " << counts.images;
+                    CatalogCounters::Instance().ScheduleRecountIfStale(catalogPath, CATALOG_RECOUNT_INTERVAL_SECONDS);
+                }
+                else
+                    msg << "Case Count: (counting...)";
                 success = true;
             }
 
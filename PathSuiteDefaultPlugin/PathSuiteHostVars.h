@@ -8,60 +8,45 @@ public:
 };
 
 
-class MGR
+// The variables shared with the PathSuite macros.
+// Read with MGR::Name::Value() and write with MGR::Name::Value(value).
+namespace MGR
 {
-
-public:
-    // Readable variables
-    static bool CameraCanRotate()                       { return HostInterop::GetBoolVariable("MGR_bCameraCanRotate");}
-    static bool CameraCanZoom()                         { return HostInterop::GetBoolVariable("MGR_bCameraCanZoom");}
-    static bool CameraHasMultObjectives()               { return HostInterop::GetBoolVariable("MGR_bCameraHasMultObjectives");}
-    static bool CameraInited()                          { return HostInterop::GetBoolVariable("MGR_bCameraInited");}
-    static bool CaseLoggedIn()                          { return HostInterop::GetBoolVariable("MGR_bCaseLoggedIn");}
-    static bool ImageOpen()                             { return HostInterop::GetBoolVariable("MGR_bImageOpen");}
-    static bool PreselectPrefix()                       { return HostInterop::GetBoolVariable("MGR_bPreselectPrefix");}
-    static bool SetupMain_OKpushed()                    { return HostInterop::GetBoolVariable("MGR_bSetupMain_OKpushed");}
-    static bool CaseLogin_OKpushed()                    { return HostInterop::GetBoolVariable("MGR_bCaseLogin_OKpushed");}
-    static bool ShowingLiveVideoUpper()                 { return HostInterop::GetBoolVariable("MGR_bShowingLiveVideoUpper");}
-    static bool ShowingObjectivesPane()                 { return HostInterop::GetBoolVariable("MGR_bShowingObjectivesPane");}
-    static bool ShowingDocModeUpper()                   { return HostInterop::GetBoolVariable("MGR_bShowingDocModeUpper");}
-    static bool ShowingThumbstrip()                     { return HostInterop::GetBoolVariable("MGR_bShowingThumbstrip");}
-    static bool TryForImageOpen()                       { return HostInterop::GetBoolVariable("MGR_bTryForImageOpen");}
-    static bool UseDefaultSettings()                    { return HostInterop::GetBoolVariable("MGR_bUseDefaultSettings");}
-    static int  OpenImage()                             { return (int)HostInterop::GetNumericVariable("MGR_idOpenImage");}
-    static int  SpcmnDropListLock()                     { return (int)HostInterop::GetNumericVariable("MGR_iSpcmnDropListLock");}
-    static std::string BlockLabel()                     { return HostInterop::GetTextVariable("MGR_strBlockLabel");}
-    static std::string LastPrefixUsed()                 { return HostInterop::GetTextVariable("MGR_strLastPrefixUsed");}
-    static std::string LiveVideoDialog()                { return HostInterop::GetTextVariable("MGR_strLiveVideoDialog");}
-    static std::string SectionLabel()                   { return HostInterop::GetTextVariable("MGR_strSectionLabel");}
-    static std::string CalibUnits()                     { return HostInterop::GetTextVariable("MGR_strCalibUnits");}
-    static std::string SpcmnDropListBinding()           { return HostInterop::GetTextVariable("MGR_strSpcmnDropListBinding");}
-    static std::string MasterCatalogFolder()            { return HostInterop::GetTextVariable("MasterCatalogFolder");}
-    static std::string PrefsFilePath()                  { return HostInterop::GetTextVariable("PrefsFilePath");}
-
-    // Writable variables
-    static void CameraCanRotate (bool value)                    { return HostInterop::SetBoolVariable ("MGR_bCameraCanRotate", value);}
-    static void CameraCanZoom (bool value)                      { return HostInterop::SetBoolVariable ("MGR_bCameraCanZoom", value);}
-    static void CameraHasMultObjectives (bool value)            { return HostInterop::SetBoolVariable ("MGR_bCameraHasMultObjectives", value);}
-    static void CameraInited (bool value)                       { return HostInterop::SetBoolVariable ("MGR_bCameraInited", value);}
-    static void CaseLoggedIn (bool value)                       { return HostInterop::SetBoolVariable ("MGR_bCaseLoggedIn", value);}
-    static void ImageOpen (bool value)                          { return HostInterop::SetBoolVariable ("MGR_bImageOpen", value);}
-    static void PreselectPrefix (bool value)                    { return HostInterop::SetBoolVariable ("MGR_bPreselectPrefix", value);}
-    static void SetupMain_OKpushed (bool value)                 { return HostInterop::SetBoolVariable ("MGR_bSetupMain_OKpushed", value);}
-    static void CaseLogin_OKpushed (bool value)                 { return HostInterop::SetBoolVariable ("MGR_bCaseLogin_OKpushed", value);}
-    static void ShowingLiveVideoUpper (bool value)              { return HostInterop::SetBoolVariable ("MGR_bShowingLiveVideoUpper", value);}
-    static void ShowingObjectivesPane (bool value)              { return HostInterop::SetBoolVariable ("MGR_bShowingObjectivesPane", value);}
-    static void ShowingDocModeUpper (bool value)                { return HostInterop::SetBoolVariable ("MGR_bShowingDocModeUpper", value);}
-    static void ShowingThumbstrip (bool value)                  { return HostInterop::SetBoolVariable ("MGR_bShowingThumbstrip", value);}
-    static void TryForImageOpen (bool value)                    { return HostInterop::SetBoolVariable ("MGR_bTryForImageOpen", value);}
-    static void UseDefaultSettings (bool value)                 { return HostInterop::SetBoolVariable ("MGR_bUseDefaultSettings", value);}
-    static void OpenImage (int value)                           { return HostInterop::SetNumericVariable ("MGR_idOpenImage", value);}
-    static void SpcmnDropListLock (int value)                   { return HostInterop::SetNumericVariable ("MGR_iSpcmnDropListLock", value);}
-    static void BlockLabel (const std::string& value)           { return HostInterop::SetTextVariable ("MGR_strBlockLabel", value);}
-    static void LastPrefixUsed (const std::string& value)       { return HostInterop::SetTextVariable ("MGR_strLastPrefixUsed", value);}
-    static void LiveVideoDialog (const std::string& value)      { return HostInterop::SetTextVariable ("MGR_strLiveVideoDialog", value);}
-    static void SectionLabel (const std::string& value)         { return HostInterop::SetTextVariable ("MGR_strSectionLabel", value);}
-    static void CalibUnits (const std::string& value)           { return HostInterop::SetTextVariable ("MGR_strCalibUnits", value);}
-    static void SpcmnDropListBinding (const std::string& value) { return HostInterop::SetTextVariable ("MGR_strSpcmnDropListBinding", value);}
-    static void MasterCatalogFolder(const std::string& value)   { return HostInterop::SetTextVariable ("MasterCatalogFolder", value);}
-};
+    HOST_VARIABLE(CameraCanRotate,               "MGR_bCameraCanRotate",               bool,        ReadWrite)
+    HOST_VARIABLE(CameraCanZoom,                 "MGR_bCameraCanZoom",                 bool,        ReadWrite)
+    HOST_VARIABLE(CameraHasMultObjectives,       "MGR_bCameraHasMultObjectives",       bool,        ReadWrite)
+    HOST_VARIABLE(CameraInited,                  "MGR_bCameraInited",                  bool,        ReadWrite)
+    HOST_VARIABLE(CaseLoggedIn,                  "MGR_bCaseLoggedIn",                  bool,        ReadWrite)
+    HOST_VARIABLE(ImageOpen,                     "MGR_bImageOpen",                     bool,        ReadWrite)
+    HOST_VARIABLE(PreselectPrefix,               "MGR_bPreselectPrefix",               bool,        ReadWrite)
+    HOST_VARIABLE(SetupMain_OKpushed,            "MGR_bSetupMain_OKpushed",            bool,        ReadWrite)
+    HOST_VARIABLE(CaseLogin_OKpushed,            "MGR_bCaseLogin_OKpushed",            bool,        ReadWrite)
+    HOST_VARIABLE(ShowingLiveVideoUpper,         "MGR_bShowingLiveVideoUpper",         bool,        ReadWrite)
+    HOST_VARIABLE(ShowingObjectivesPane,         "MGR_bShowingObjectivesPane",         bool,        ReadWrite)
+    HOST_VARIABLE(ShowingDocModeUpper,           "MGR_bShowingDocModeUpper",           bool,        ReadWrite)
+    HOST_VARIABLE(ShowingThumbstrip,             "MGR_bShowingThumbstrip",             bool,        ReadWrite)
+    HOST_VARIABLE(TryForImageOpen,               "MGR_bTryForImageOpen",               bool,        ReadWrite)
+    HOST_VARIABLE(UseDefaultSettings,            "MGR_bUseDefaultSettings",            bool,        ReadWrite)
+    HOST_VARIABLE(OpenImage,                     "MGR_idOpenImage",                    int,         ReadWrite)
+    HOST_VARIABLE(SpcmnDropListLock,             "MGR_iSpcmnDropListLock",             int,         ReadWrite)
+    HOST_VARIABLE(BlockLabel,                    "MGR_strBlockLabel",                  std::string, ReadWrite)
+    HOST_VARIABLE(LastPrefixUsed,                "MGR_strLastPrefixUsed",              std::string, ReadWrite)
+    HOST_VARIABLE(LiveVideoDialog,               "MGR_strLiveVideoDialog",             std::string, ReadWrite)
+    HOST_VARIABLE(SectionLabel,                  "MGR_strSectionLabel",                std::string, ReadWrite)
+    HOST_VARIABLE(CalibUnits,                    "MGR_strCalibUnits",                  std::string, ReadWrite)
+    HOST_VARIABLE(SpcmnDropListBinding,          "MGR_strSpcmnDropListBinding",        std::string, ReadWrite)
+    HOST_VARIABLE(MasterCatalogFolder,           "MasterCatalogFolder",                std::string, ReadWrite)
+    HOST_VARIABLE(PrefsFilePath,                 "PrefsFilePath",                      std::string, ReadOnly)
+    HOST_VARIABLE(ReplicationRunning,            "MGR_bReplicationRunning",            bool,        ReadWrite)
+    HOST_VARIABLE(ReplicationFilesCopied,        "MGR_iReplicationFilesCopied",        int,         ReadWrite)
+    HOST_VARIABLE(ReplicationMegabytesCopied,    "MGR_dReplicationMegabytesCopied",    double,      ReadWrite)
+    HOST_VARIABLE(ReplicationMegabytesPerSecond, "MGR_dReplicationMegabytesPerSecond", double,      ReadWrite)
+    HOST_VARIABLE(ReplicationStatus,             "MGR_strReplicationStatus",           std::string, ReadWrite)
+    HOST_VARIABLE(LiveVideoMonitored,            "MGR_bLiveVideoMonitored",            bool,        ReadWrite)
+    HOST_VARIABLE(LiveFps,                       "MGR_dLiveFps",                       double,      ReadWrite)
+    HOST_VARIABLE(LiveWindowFps,                 "MGR_dLiveWindowFps",                 double,      ReadWrite)
+    HOST_VARIABLE(LiveFrameIntervalP50,          "MGR_dLiveFrameIntervalP50",          double,      ReadWrite)
+    HOST_VARIABLE(LiveFrameIntervalP95,          "MGR_dLiveFrameIntervalP95",          double,      ReadWrite)
+    HOST_VARIABLE(LiveFrameIntervalP99,          "MGR_dLiveFrameIntervalP99",          double,      ReadWrite)
+    HOST_VARIABLE(LiveDroppedFrames,             "MGR_iLiveDroppedFrames",             int,         ReadWrite)
+}
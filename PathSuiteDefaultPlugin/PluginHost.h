@@ -1,6 +1,7 @@
 #pragma once
 
 #include "SpotPlugin.h"
+#include "StallWatchdog.h"
 
 namespace PluginHost
 {
@@ -9,6 +10,7 @@ namespace PluginHost
 
     inline bool DoAction(SpotPluginApi::host_action_t action, uintptr_t info, void *data)
     {
+        StallWatchdog::CallScope scope(StallWatchdog::CallKind::HostRequest, action);
         return ActionFunc(pluginHandle, action, info, data);
     }
 };
@@ -0,0 +1,76 @@
+#include "stdafx.h"
+#include "ResultChannel.h"
+
+using namespace std;
+
+namespace
+{
+    const uint64_t MINIMUM_CAPACITY = 1024 * 1024;
+}
+
+ResultChannel& ResultChannel::Instance()
+{
+    static ResultChannel channel;
+    return channel;
+}
+
+void ResultChannel::Close()
+{
+    if (header)
+        UnmapViewOfFile(header);
+    if (mapping)
+        CloseHandle(mapping);
+    header = nullptr;
+    mapping = NULL;
+}
+
+// Replaces the region with a larger one if the data does not fit.
+// Readers that have the old region open keep it until they close it.
+void ResultChannel::Reserve(uint64_t length)
+{
+    if (header && header->capacity >= length)
+        return;
+    uint64_t capacity = MINIMUM_CAPACITY;
+    while (capacity < length)
+        capacity *= 2;
+    LONG64 generation = header ? header->generation : 0;
+    Close();
+
+    uint64_t size = sizeof(ResultChannelHeader) + capacity;
+    mappingName = "Local\\PathSuite.Results." + to_string(GetCurrentProcessId()) + "." + to_string(++mappingCount);
+    mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), mappingName.c_str());
+    if (mapping == NULL)
+        throw runtime_error("Unable to create the result region (error " + to_string(GetLastError()) + ")");
+    header = static_cast<ResultChannelHeader*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+    if (header == nullptr)
+    {
+        Close();
+        throw runtime_error("Unable to map the result region (error " + to_string(GetLastError()) + ")");
+    }
+    header->signature = ResultChannelHeader::Signature;
+    header->version = ResultChannelHeader::CurrentVersion;
+    header->generation = generation; // generations keep increasing across regions
+    header->capacity = capacity;
+    header->length = 0;
+    header->recordCount = 0;
+}
+
+string ResultChannel::Publish(const vector<string>& records)
+{
+    uint64_t length = 0;
+    for (auto& record : records)
+        length += record.size() + 1;
+    Reserve(length);
+
+    InterlockedIncrement64(&header->generation);
+    char* data = reinterpret_cast<char*>(header + 1);
+    for (auto& record : records)
+    {
+        data = copy(record.begin(), record.end(), data);
+        *data++ = '\n';
+    }
+    header->length = length;
+    header->recordCount = records.size();
+    LONG64 generation = InterlockedIncrement64(&header->generation);
+    return mappingName + "#" + to_string(generation);
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdint.h>
+#include <stdlib.h>
+
+/// Summary:
+///   Bulk action results are written to a shared memory region instead of a text variable.
+///   The region is a named file mapping in the page file that starts with a ResultChannelHeader
+///   followed by the records separated by a newline char '\n'. The action returns a handle of the
+///   form "<mapping name>#<generation>" that any process on the workstation can open with ResultChannelReader.
+///   The region is reused by later results so a handle only remains valid until the next result is published.
+///   This header only depends on windows.h so that it can be shared with external tools.
+
+#pragma pack(push, 8)
+struct ResultChannelHeader
+{
+    static const uint32_t Signature = 0x43525350; // "PSRC"
+    static const uint32_t CurrentVersion = 1;
+
+    uint32_t signature;
+    uint32_t version;
+    volatile LONG64 generation; // Incremented before and after each write. Odd while a write is in progress.
+    uint64_t capacity;          // The number of bytes available for data after the header
+    uint64_t length;            // The number of bytes of data
+    uint64_t recordCount;       // The number of records in the data
+};
+#pragma pack(pop)
+
+/// Summary:
+///   Publishes results to a shared memory region that is reused across calls.
+///   The region is only replaced by a larger one when a result does not fit.
+///   This object is not thread safe. It is only used from the host UI thread.
+class ResultChannel
+{
+    HANDLE mapping;
+    ResultChannelHeader* header;
+    std::string mappingName;
+    unsigned mappingCount;
+
+    ResultChannel() : mapping(NULL), header(nullptr), mappingCount(0) {}
+    ResultChannel(const ResultChannel&);
+    ResultChannel& operator = (const ResultChannel&);
+
+    void Reserve(uint64_t length);
+    void Close();
+
+public:
+    ~ResultChannel() { Close(); }
+
+    static ResultChannel& Instance();
+
+    /// Summary:
+    ///   Writes records to the shared region.
+    /// Returns:
+    ///   The handle to pass to ResultChannelReader
+    /// Throws:
+    ///   runtime_error if the region could not be created
+    std::string Publish(const std::vector<std::string>& records);
+};
+
+/// Summary:
+///   Reads a result published by ResultChannel, possibly from another process.
+class ResultChannelReader
+{
+    HANDLE mapping;
+    const ResultChannelHeader* header;
+    LONG64 generation;
+
+    ResultChannelReader(const ResultChannelReader&);
+    ResultChannelReader& operator = (const ResultChannelReader&);
+
+public:
+    /// Summary:
+    ///   Opens the region of a result handle. Use IsCurrent to determine if it was opened.
+    explicit ResultChannelReader(const std::string& handle) : mapping(NULL), header(nullptr), generation(0)
+    {
+        auto separator = handle.rfind('#');
+        if (separator == std::string::npos)
+            return;
+        generation = _strtoi64(handle.c_str() + separator + 1, nullptr, 10);
+        mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, handle.substr(0, separator).c_str());
+        if (mapping == NULL)
+            return;
+        header = static_cast<const ResultChannelHeader*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (header && (header->signature != ResultChannelHeader::Signature || header->version != ResultChannelHeader::CurrentVersion))
+        {
+            UnmapViewOfFile(header);
+            header = nullptr;
+        }
+    }
+
+    ~ResultChannelReader()
+    {
+        if (header)
+            UnmapViewOfFile(header);
+        if (mapping)
+            CloseHandle(mapping);
+    }
+
+    /// Returns true if the region is open and still holds the result of the handle.
+    bool IsCurrent() const
+    {
+        return header && header->generation == generation;
+    }
+
+    /// Summary:
+    ///   Gets the data in place without copying it. The data is only valid while IsCurrent returns true,
+    ///   so check IsCurrent again after the data has been used.
+    const char* Data() const { return header ? reinterpret_cast<const char*>(header + 1) : nullptr; }
+    size_t Length() const { return header ? static_cast<size_t>(header->length) : 0; }
+    size_t RecordCount() const { return header ? static_cast<size_t>(header->recordCount) : 0; }
+
+    /// Summary:
+    ///   Copies a range of records.
+    /// Returns:
+    ///   False if the result was replaced by a newer result while it was being read.
+    bool ReadRecords(size_t first, size_t count, std::vector<std::string>& records) const
+    {
+        if (!IsCurrent())
+            return false;
+        const char* data = Data();
+        const char* end = data + Length();
+        size_t index = 0;
+        for (const char* record = data; record < end && records.size() < count; ++index)
+        {
+            const char* recordEnd = std::find(record, end, '\n');
+            if (index >= first)
+                records.push_back(std::string(record, recordEnd));
+            record = recordEnd + 1;
+        }
+        MemoryBarrier();
+        return IsCurrent();
+    }
+};
@@ -173,13 +173,23 @@ bool SPOTPLUGINAPI SPOTPLUGIN_INIT_FUNC(host_action_func_t hostActionFunc, uintp
 
     dispatcher.SetAction(10, []()
     {
-        auto stdVars = VariableManager::StandardVars();
+        auto& stdVars = VariableManager::StandardVars();
         auto argT1 = stdVars.GetByName<TextVariable>("_argT1");
         auto argT2 = stdVars.GetByName<TextVariable>("_argT2");
         auto argN1 = stdVars.GetByName<IntegerVariable>("LiveImgCount");
         stdVars.SetValue("_argT3", argT1.Value() + argT2.Value() + argN1.ToString());
     });
 
+    // Restores the variables saved by the backup on exit below. The next backup only appends the values changed since.
+    dispatcher.SetAction(11, []()
+    {
+        string path = StdVars::PrefsFilePath::Value();
+        vector<string> failures;
+        VariableManager::StandardVars().RestoreSnapshot(path + "\\BackupVars.snapshot", failures);
+        for (auto& failure : failures)
+            OutputDebugString(failure.c_str());
+    });
+
     //===============================
     // Setup optional event bindings
     //
@@ -203,8 +213,8 @@ bool SPOTPLUGINAPI SPOTPLUGIN_INIT_FUNC(host_action_func_t hostActionFunc, uintp
 
     std::function<void(HostEvents::application_closing_t::arg_type)> backupOnExit = [] (HostEvents::application_closing_t::arg_type)
     {
-        string path = VariableManager::StandardVars().GetByName<TextVariable>("PrefsFilePath").Value();
-        VariableManager::StandardVars().SaveAll(path + "\\BackupVars");
+        string path = StdVars::PrefsFilePath::Value();
+        VariableManager::StandardVars().SaveSnapshot(path + "\\BackupVars.snapshot");
     };
     HostEvents::ApplicationClosing().AddDelegate(make_event_delegate(backupOnExit));
 
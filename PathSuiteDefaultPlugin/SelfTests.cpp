@@ -0,0 +1,184 @@
+#include "stdafx.h"
+
+// Checks of components that can run without the host, against fakes of the host.
+// They are only compiled into the plug-in when PATHSUITE_SELF_TESTS is defined, and run with:
+//   rundll32 PathSuiteDefaultPlugin.dll,RunSelfTests <output directory>
+// The results are written to selftests.txt in the output directory, one line for each failed check.
+#ifdef PATHSUITE_SELF_TESTS
+
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include "Utilities.h"
+#include "AcquisitionScheduler.h"
+
+#pragma comment(linker, "/EXPORT:RunSelfTests=_RunSelfTests@16")
+
+using namespace std;
+namespace sys = std::tr2::sys;
+
+namespace
+{
+    struct Checks
+    {
+        ostringstream failures;
+        int count;
+        int failed;
+
+        Checks() : count(0), failed(0) {}
+
+        void Expect(bool condition, const string& test, const string& description)
+        {
+            ++count;
+            if (condition)
+                return;
+            ++failed;
+            failures << test << ": " << description << endl;
+        }
+    };
+
+    // A host whose clock only moves when it is told to, and where each acquisition takes acquireTime
+    struct FakeHost
+    {
+        int64_t now;
+        int64_t acquireTime;
+        bool acquireSucceeds;
+        vector<int64_t> acquiredAt;
+        vector<int64_t> wakeRequests;
+        AcquisitionScheduler scheduler;
+
+        FakeHost(int64_t acquireTime) :
+            now(0), acquireTime(acquireTime), acquireSucceeds(true),
+            scheduler([this] () { return now; },
+                      [this] () -> bool
+                      {
+                          acquiredAt.push_back(now);
+                          now += this->acquireTime;
+                          // The host dispatches the wake up timer while it acquires
+                          scheduler.Poll();
+                          return acquireSucceeds;
+                      },
+                      [this] (int64_t delay) { wakeRequests.push_back(delay); })
+        {
+        }
+
+        // Advances the clock to the requested wake up time and polls, as the host's timer would
+        void WakeUp(int64_t lateBy = 0)
+        {
+            now += wakeRequests.back() + lateBy;
+            scheduler.Poll();
+        }
+    };
+
+    string Describe(const vector<int64_t>& times)
+    {
+        ostringstream text;
+        for (size_t i = 0; i < times.size(); ++i)
+            text << (i > 0 ? "," : "") << times[i];
+        return text.str();
+    }
+
+    // Fixed rate shots stay on start + n * interval although each acquisition takes 300 us
+    void FixedRateDoesNotDrift(Checks& checks)
+    {
+        const string test = "FixedRateDoesNotDrift";
+        FakeHost host(300);
+        host.scheduler.StartFixedRate(1000, 5);
+        while (host.scheduler.IsRunning() && host.wakeRequests.size() < 10)
+            host.WakeUp();
+        int64_t expected[] = { 0, 1000, 2000, 3000, 4000 };
+        checks.Expect(host.acquiredAt == vector<int64_t>(begin(expected), end(expected)), test, "acquired at " + Describe(host.acquiredAt));
+        checks.Expect(!host.scheduler.IsRunning(), test, "still running after the last shot");
+        checks.Expect(!host.wakeRequests.empty() && host.wakeRequests.back() < 0, test, "the wake up timer was not cancelled");
+        checks.Expect(host.wakeRequests.size() >= 2 && host.wakeRequests[0] == 700, test, "first wake up after " + Describe(host.wakeRequests));
+        const AcquisitionStatus& status = host.scheduler.Status();
+        checks.Expect(status.issued == 5 && status.missed == 0 && status.maxLateness == 0, test, "unexpected status");
+        checks.Expect(status.jitter.size() == AcquisitionScheduler::JitterBuckets().size() + 1 && status.jitter[0] == 5, test, "unexpected jitter histogram");
+    }
+
+    // A poll that comes 2.5 intervals late takes only the latest due slot and counts the others as missed
+    void FixedRateSkipsMissedSlots(Checks& checks)
+    {
+        const string test = "FixedRateSkipsMissedSlots";
+        FakeHost host(0);
+        host.scheduler.StartFixedRate(1000, 10);
+        host.WakeUp(2500);
+        const auto& shots = host.scheduler.Shots();
+        checks.Expect(shots.size() == 2, test, to_string(shots.size()) + " shots taken");
+        if (shots.size() == 2)
+            checks.Expect(shots[1].planned == 3000 && shots[1].actual == 3500, test, "second shot planned at " + to_string(shots[1].planned) + " taken at " + to_string(shots[1].actual));
+        checks.Expect(host.scheduler.Status().missed == 2, test, to_string(host.scheduler.Status().missed) + " slots missed");
+        checks.Expect(host.wakeRequests.back() == 500, test, "next wake up after " + to_string(host.wakeRequests.back()));
+        checks.Expect(host.scheduler.Status().maxLateness == 500, test, "max lateness " + to_string(host.scheduler.Status().maxLateness));
+        host.scheduler.Stop();
+        checks.Expect(!host.scheduler.IsRunning() && host.wakeRequests.back() < 0, test, "Stop did not stop the schedule");
+    }
+
+    // Fixed delay shots are planned a delay after the previous acquisition finished
+    void FixedDelayFollowsAcquisitions(Checks& checks)
+    {
+        const string test = "FixedDelayFollowsAcquisitions";
+        FakeHost host(300);
+        host.scheduler.StartFixedDelay(1000, 3);
+        while (host.scheduler.IsRunning() && host.wakeRequests.size() < 10)
+            host.WakeUp();
+        int64_t expected[] = { 0, 1300, 2600 };
+        checks.Expect(host.acquiredAt == vector<int64_t>(begin(expected), end(expected)), test, "acquired at " + Describe(host.acquiredAt));
+        checks.Expect(host.scheduler.Status().missed == 0, test, "slots missed");
+    }
+
+    // Burst offsets are sorted, and a slot passed by a later one is missed
+    void BurstTakesSortedOffsets(Checks& checks)
+    {
+        const string test = "BurstTakesSortedOffsets";
+        FakeHost host(0);
+        int64_t offsets[] = { 2000, 0, 500 };
+        checks.Expect(host.scheduler.StartBurst(vector<int64_t>(begin(offsets), end(offsets))), test, "StartBurst failed");
+        checks.Expect(!host.scheduler.StartFixedRate(1000, 1), test, "a second schedule started while one was running");
+        host.WakeUp(1600);
+        int64_t expected[] = { 0, 2100 };
+        checks.Expect(host.acquiredAt == vector<int64_t>(begin(expected), end(expected)), test, "acquired at " + Describe(host.acquiredAt));
+        checks.Expect(host.scheduler.Status().missed == 1, test, to_string(host.scheduler.Status().missed) + " slots missed");
+        checks.Expect(!host.scheduler.IsRunning(), test, "still running after the last offset");
+    }
+
+    void FailedAcquisitionsAreCounted(Checks& checks)
+    {
+        const string test = "FailedAcquisitionsAreCounted";
+        FakeHost host(0);
+        host.acquireSucceeds = false;
+        host.scheduler.StartFixedRate(1000, 2);
+        host.WakeUp();
+        const AcquisitionStatus& status = host.scheduler.Status();
+        checks.Expect(status.issued == 2 && status.failed == 2, test, to_string(status.failed) + " of " + to_string(status.issued) + " failed");
+        checks.Expect(!host.scheduler.Shots().empty() && !host.scheduler.Shots().front().succeeded, test, "shot recorded as succeeded");
+    }
+
+    void AcquisitionSchedulerTests(Checks& checks)
+    {
+        FixedRateDoesNotDrift(checks);
+        FixedRateSkipsMissedSlots(checks);
+        FixedDelayFollowsAcquisitions(checks);
+        BurstTakesSortedOffsets(checks);
+        FailedAcquisitionsAreCounted(checks);
+    }
+}
+
+extern "C" void CALLBACK RunSelfTests(HWND, HINSTANCE, LPSTR commandLine, int)
+{
+    sys::path outputDirectory(TrimCopy(string(commandLine)));
+    Checks checks;
+    try
+    {
+        AcquisitionSchedulerTests(checks);
+    }
+    catch(const std::exception& ex)
+    {
+        checks.failures << "Failed: " << ex.what() << endl;
+        ++checks.failed;
+    }
+    ofstream output(sys::path(outputDirectory / "selftests.txt").string());
+    output << checks.failures.str() << checks.failed << " of " << checks.count << " checks failed" << endl;
+}
+
+#endif
@@ -0,0 +1,244 @@
+#include "stdafx.h"
+#include <fstream>
+#include <iomanip>
+#include "StallWatchdog.h"
+
+using namespace std;
+
+namespace
+{
+    const char* HostEventName(uintptr_t hostEvent)
+    {
+        switch (hostEvent)
+        {
+        case SpotPluginApi::HostEvent::Idle:                return "Idle";
+        case SpotPluginApi::HostEvent::ApplicationClosing:  return "ApplicationClosing";
+        case SpotPluginApi::HostEvent::ImageDocChanged:     return "ImageDocChanged";
+        case SpotPluginApi::HostEvent::CameraInitialized:   return "CameraInitialized";
+        default:                                            return nullptr;
+        }
+    }
+
+    const char* HostRequestName(uintptr_t request)
+    {
+        switch (request)
+        {
+        case SpotPluginApi::HostActionRequest::BindEventHandler:    return "BindEventHandler";
+        case SpotPluginApi::HostActionRequest::UnbindEventHandler:  return "UnbindEventHandler";
+        case SpotPluginApi::HostActionRequest::GetVariable:         return "GetVariable";
+        case SpotPluginApi::HostActionRequest::SetVariable:         return "SetVariable";
+        case SpotPluginApi::HostActionRequest::SaveVariable:        return "SaveVariable";
+        case SpotPluginApi::HostActionRequest::RecallVariable:      return "RecallVariable";
+        case SpotPluginApi::HostActionRequest::AcqSingleImage:      return "AcqSingleImage";
+        case SpotPluginApi::HostActionRequest::StartLive:           return "StartLive";
+        case SpotPluginApi::HostActionRequest::PauseLive:           return "PauseLive";
+        case SpotPluginApi::HostActionRequest::EndLive:             return "EndLive";
+        default:                                                    return nullptr;
+        }
+    }
+
+    string LocalTimeText()
+    {
+        SYSTEMTIME time;
+        GetLocalTime(&time);
+        ostringstream text;
+        text << setfill('0') << time.wYear << '-' << setw(2) << time.wMonth << '-' << setw(2) << time.wDay << ' '
+             << setw(2) << time.wHour << ':' << setw(2) << time.wMinute << ':' << setw(2) << time.wSecond << '.' << setw(3) << time.wMilliseconds;
+        return text.str();
+    }
+
+    bool AppendToFile(const string& fileName, const string& text)
+    {
+        ofstream file(fileName, ios::out | ios::app);
+        file << text;
+        return file.good();
+    }
+}
+
+StallWatchdog::StallWatchdog() :
+    enabled(false), stopping(false), hostThreadId(0), threshold(DefaultThresholdMilliseconds), nextSequence(1),
+    historyNext(0), stalledSequence(0), stalledDuration(0), stalls(0)
+{
+}
+
+StallWatchdog::~StallWatchdog()
+{
+    Stop();
+}
+
+StallWatchdog& StallWatchdog::Instance()
+{
+    static StallWatchdog watchdog;
+    return watchdog;
+}
+
+bool StallWatchdog::Start(const string& reportFileName, unsigned thresholdMilliseconds)
+{
+    ostringstream heading;
+    heading << LocalTimeText() << " Stall watchdog started. Calls longer than " << thresholdMilliseconds << " ms are reported.\n";
+    if (!AppendToFile(reportFileName, heading.str()))
+        return false;
+
+    lock_guard<mutex> guard(lock);
+    reportFile = reportFileName;
+    threshold = thresholdMilliseconds;
+    if (!watcher.joinable())
+    {
+        hostThreadId = GetCurrentThreadId();
+        running.clear();
+        history.clear();
+        historyNext = 0;
+        stalledSequence = 0;
+        stalls = 0;
+        stopping = false;
+        watcher = thread(&StallWatchdog::Run, this);
+    }
+    wake.notify_all();
+    enabled = true;
+    return true;
+}
+
+void StallWatchdog::Stop()
+{
+    {
+        lock_guard<mutex> guard(lock);
+        enabled = false;
+        stopping = true;
+        wake.notify_all();
+    }
+    if (watcher.joinable())
+        watcher.join();
+}
+
+size_t StallWatchdog::StallCount()
+{
+    lock_guard<mutex> guard(lock);
+    return stalls;
+}
+
+uint64_t StallWatchdog::Enter(CallKind kind, uintptr_t code)
+{
+    if (!enabled || GetCurrentThreadId() != hostThreadId)
+        return 0;
+    Call call = { 0, kind, code, nullptr, nullptr, GetTickCount64(), 0 };
+    lock_guard<mutex> guard(lock);
+    call.sequence = nextSequence++;
+    running.push_back(call);
+    return call.sequence;
+}
+
+void StallWatchdog::Exit(uint64_t sequence)
+{
+    ULONGLONG now = GetTickCount64();
+    lock_guard<mutex> guard(lock);
+    // The call is the innermost one unless the watchdog was restarted while it ran
+    auto call = find_if(running.rbegin(), running.rend(), [=](const Call& item) { return item.sequence == sequence; });
+    if (call == running.rend())
+        return;
+    call->end = now;
+    if (sequence == stalledSequence)
+        stalledDuration = now - call->start;
+    if (history.size() < HistorySize)
+        history.push_back(*call);
+    else
+        history[historyNext] = *call;
+    historyNext = (historyNext + 1) % HistorySize;
+    running.erase(next(call).base());
+}
+
+void StallWatchdog::SetDelegate(const void* delegate, const type_info& type)
+{
+    if (GetCurrentThreadId() != hostThreadId)
+        return;
+    lock_guard<mutex> guard(lock);
+    if (!running.empty() && running.back().kind == CallKind::Event)
+    {
+        running.back().delegate = delegate;
+        running.back().delegateType = &type;
+    }
+}
+
+string StallWatchdog::Describe(const Call& call)
+{
+    ostringstream text;
+    const char* name = nullptr;
+    switch (call.kind)
+    {
+    case CallKind::Action:
+        text << "action " << call.code;
+        break;
+    case CallKind::Event:
+        name = HostEventName(call.code);
+        text << "event ";
+        if (name != nullptr)
+            text << name;
+        else
+            text << call.code;
+        if (call.delegate != nullptr)
+            text << " delegate " << call.delegateType->name() << " at " << call.delegate;
+        break;
+    default:
+        name = HostRequestName(call.code);
+        text << "host request ";
+        if (name != nullptr)
+            text << name;
+        else
+            text << call.code;
+        break;
+    }
+    return text.str();
+}
+
+// The lock must be held by the caller
+string StallWatchdog::StallReport(ULONGLONG now) const
+{
+    ostringstream report;
+    report << LocalTimeText() << " Stall: " << Describe(running.front()) << " has been running for "
+           << now - running.front().start << " ms\n"
+           << "  Running calls, outermost first:\n";
+    for (auto& call : running)
+        report << "    " << Describe(call) << " for " << now - call.start << " ms\n";
+    report << "  Recent calls, oldest first:\n";
+    for (size_t index = 0; index < history.size(); ++index)
+    {
+        const Call& call = history[(historyNext + index) % history.size()];
+        report << "    " << Describe(call) << " took " << call.end - call.start << " ms, ended "
+               << now - call.end << " ms ago\n";
+    }
+    return report.str();
+}
+
+void StallWatchdog::Run()
+{
+    unique_lock<mutex> guard(lock);
+    while (!stopping)
+    {
+        // Check often enough that a stall is reported within a quarter of the threshold of it starting
+        unsigned period = threshold / 4 > 50 ? threshold / 4 : 50;
+        wake.wait_for(guard, chrono::milliseconds(period));
+        if (stopping)
+            break;
+        ULONGLONG now = GetTickCount64();
+        string text;
+        if (stalledSequence != 0 && (running.empty() || running.front().sequence != stalledSequence))
+        {
+            ostringstream ended;
+            ended << LocalTimeText() << " Stall ended after " << stalledDuration << " ms\n";
+            text = ended.str();
+            stalledSequence = 0;
+        }
+        if (stalledSequence == 0 && !running.empty() && now - running.front().start >= threshold)
+        {
+            text += StallReport(now);
+            stalledSequence = running.front().sequence;
+            stalledDuration = 0;
+            ++stalls;
+        }
+        if (text.empty())
+            continue;
+        string fileName = reportFile;
+        guard.unlock();
+        AppendToFile(fileName, text);
+        guard.lock();
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <typeinfo>
+#include <condition_variable>
+#include <stdint.h>
+#include "SpotPlugin.h"
+
+/// Summary:
+///   Finds the calls between the host and the plug-in that keep the host's UI thread busy.
+///   The plug-in's action callbacks, the host event dispatches and the plug-in's requests to the host mark
+///   when they start and end. A watchdog thread checks the outermost running call and, once it has run longer
+///   than the threshold, appends a report to the report file. The report lists the running calls from the outermost
+///   to the innermost, with the event delegate that is running, and the most recent calls that have ended.
+///   A second line is written when the stalled call returns.
+///   Only calls made on the thread that started the watchdog are marked. Marking costs an atomic read while
+///   the watchdog is stopped.
+class StallWatchdog
+{
+public:
+    enum class CallKind
+    {
+        Action,         // A plug-in action called by the host
+        Event,          // A host event dispatched to the plug-in's delegates
+        HostRequest     // A request made by the plug-in to the host
+    };
+
+    static const size_t HistorySize = 64;
+    static const unsigned DefaultThresholdMilliseconds = 2000;
+
+    /// Summary:
+    ///   Marks a call as running while the scope exists.
+    class CallScope
+    {
+        uint64_t sequence;
+
+        CallScope(const CallScope&);
+        CallScope& operator = (const CallScope&);
+
+    public:
+        CallScope(CallKind kind, uintptr_t code) : sequence(StallWatchdog::Instance().Enter(kind, code)) {}
+        ~CallScope() { if (sequence != 0) StallWatchdog::Instance().Exit(sequence); }
+    };
+
+private:
+    struct Call
+    {
+        uint64_t sequence;
+        CallKind kind;
+        uintptr_t code;                     // The action code, host event or host request
+        const void* delegate;               // The running delegate of an event
+        const std::type_info* delegateType;
+        ULONGLONG start;                    // GetTickCount64 milliseconds
+        ULONGLONG end;
+    };
+
+    std::atomic<bool> enabled;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::thread watcher;
+    bool stopping;
+    DWORD hostThreadId;
+    unsigned threshold;                 // milliseconds
+    std::string reportFile;
+    uint64_t nextSequence;
+    std::vector<Call> running;          // The outermost call first
+    std::vector<Call> history;          // The last HistorySize calls that ended, oldest at historyNext once full
+    size_t historyNext;
+    uint64_t stalledSequence;           // The outermost call that was reported. Zero if none.
+    ULONGLONG stalledDuration;          // Set when the reported call ends
+    size_t stalls;
+
+    StallWatchdog();
+    StallWatchdog(const StallWatchdog&);
+    StallWatchdog& operator = (const StallWatchdog&);
+
+    void Run();
+    std::string StallReport(ULONGLONG now) const;
+    static std::string Describe(const Call& call);
+    void SetDelegate(const void* delegate, const std::type_info& type);
+
+public:
+    ~StallWatchdog();
+
+    static StallWatchdog& Instance();
+
+    /// Summary:
+    ///   Starts watching the calls made on the current thread, or changes the settings if it is already watching.
+    ///   Must be called on the host's thread.
+    /// Arguments:
+    ///   reportFileName - The file the reports are appended to
+    ///   thresholdMilliseconds - How long a call may run before it is reported
+    /// Returns:
+    ///   False if the report file cannot be written. The watchdog is not started.
+    bool Start(const std::string& reportFileName, unsigned thresholdMilliseconds);
+
+    void Stop();
+
+    bool IsRunning() const { return enabled; }
+
+    /// The number of stalls reported since the watchdog was started
+    size_t StallCount();
+
+    /// Summary:
+    ///   Marks the start of a call. Use CallScope instead.
+    /// Returns:
+    ///   The sequence number to pass to Exit, or zero if the call is not marked
+    uint64_t Enter(CallKind kind, uintptr_t code);
+
+    void Exit(uint64_t sequence);
+
+    /// Summary:
+    ///   Records the delegate the innermost running event is about to call.
+    void EnterDelegate(const void* delegate, const std::type_info& type)
+    {
+        if (enabled)
+            SetDelegate(delegate, type);
+    }
+};
@@ -1,159 +1,170 @@
 #pragma once
 #include "HostVariables.h"
 
+// The standard variables of the host application as VARIABLE(Access, Name, Type, Scope).
+// The list declares a HostInterop::VarRef for each variable in the StdVars namespace and
+// builds the script VariableManager::StandardVars uses to create its variable objects.
+// Not listed because they have no matching C++ type: Timestamp1 to Timestamp5, ImgDate,
+// ImgTime, RptDate, RptTime and ImgTimestamp. TwainMode is also left out.
+#define STANDARD_HOST_VARIABLES(VARIABLE) \
+    VARIABLE(ReadWrite, TextVar1,                      std::string, ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, TextVar2,                      std::string, ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, TextVar3,                      std::string, ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, TextVar4,                      std::string, ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, TextVar5,                      std::string, ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argT1,                        std::string, ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argT2,                        std::string, ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argT3,                        std::string, ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argT4,                        std::string, ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argT5,                        std::string, ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, NumVar1,                       double,      ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, NumVar2,                       double,      ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, NumVar3,                       double,      ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, NumVar4,                       double,      ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, NumVar5,                       double,      ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argN1,                        double,      ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argN2,                        double,      ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argN3,                        double,      ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argN4,                        double,      ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argN5,                        double,      ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, BoolVar1,                      bool,        ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, BoolVar2,                      bool,        ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, BoolVar3,                      bool,        ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, BoolVar4,                      bool,        ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, BoolVar5,                      bool,        ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argB1,                        bool,        ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argB2,                        bool,        ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argB3,                        bool,        ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argB4,                        bool,        ScopeFlags::Unknown) \
+    VARIABLE(ReadWrite, _argB5,                        bool,        ScopeFlags::Unknown) \
+    VARIABLE(ReadOnly,  CameraSerialNum,               std::string, ScopeFlags::CameraSetting) \
+    VARIABLE(ReadOnly,  CameraName,                    std::string, ScopeFlags::CameraSetting) \
+    VARIABLE(ReadOnly,  CurUserName,                   std::string, ScopeFlags::UserSetting) \
+    VARIABLE(ReadOnly,  CurSensorTemp,                 double,      ScopeFlags::CameraSetting) \
+    VARIABLE(ReadOnly,  CurImgSetupName,               std::string, ScopeFlags::CameraSetting) \
+    VARIABLE(ReadOnly,  ImgUserName,                   std::string, ScopeFlags::ImageMetaData) \
+    VARIABLE(ReadOnly,  ImgTitle,                      std::string, ScopeFlags::ImageMetaData|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  ImgMemo,                       std::string, ScopeFlags::ImageMetaData) \
+    VARIABLE(ReadOnly,  DBRecID,                       int,         ScopeFlags::ImageMetaData) \
+    VARIABLE(ReadOnly,  ImgSeqLen,                     int,         ScopeFlags::ImageMetaData) \
+    VARIABLE(ReadOnly,  ImgSeqIdx,                     int,         ScopeFlags::ImageMetaData) \
+    VARIABLE(ReadOnly,  ImgElapsedTime,                std::string, ScopeFlags::ImageMetaData) \
+    VARIABLE(ReadOnly,  ImgSetupName,                  std::string, ScopeFlags::ImageMetaData) \
+    VARIABLE(ReadOnly,  ImgSensorTemp,                 double,      ScopeFlags::ImageMetaData) \
+    VARIABLE(ReadOnly,  MacroLoopNum,                  int,         ScopeFlags::Unknown) \
+    VARIABLE(ReadOnly,  MacroCmdCanceled,              bool,        ScopeFlags::Unknown) \
+    VARIABLE(ReadOnly,  MacroCmdFailed,                bool,        ScopeFlags::Unknown) \
+    VARIABLE(ReadOnly,  RptPageNum,                    int,         ScopeFlags::Reporting) \
+    VARIABLE(ReadOnly,  RptPageCount,                  int,         ScopeFlags::Reporting) \
+    VARIABLE(ReadOnly,  RptRecNum,                     int,         ScopeFlags::Reporting) \
+    VARIABLE(ReadOnly,  RptRecCount,                   int,         ScopeFlags::Reporting) \
+    VARIABLE(ReadOnly,  RunTimeText,                   std::string, ScopeFlags::Reporting) \
+    VARIABLE(ReadOnly,  MinExposure,                   double,      ScopeFlags::CameraSetting) \
+    VARIABLE(ReadOnly,  MaxExposure,                   double,      ScopeFlags::CameraSetting) \
+    VARIABLE(ReadOnly,  LiveImgOpen,                   bool,        ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  LiveImgRunning,                bool,        ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  LiveImgCount,                  int,         ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  LiveImgContrast,               double,      ScopeFlags::ImageMetaData) \
+    VARIABLE(ReadOnly,  OperationMode,                 std::string, ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  ImgMeasWidth,                  double,      ScopeFlags::Measurment|ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  ImgMeasLength,                 double,      ScopeFlags::Measurment|ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  ImgMeasArea,                   double,      ScopeFlags::ImageMetaData|ScopeFlags::Measurment) \
+    VARIABLE(ReadOnly,  ImgMeasPerimeter,              double,      ScopeFlags::ImageMetaData|ScopeFlags::Measurment) \
+    VARIABLE(ReadOnly,  ImgMeasAngle,                  double,      ScopeFlags::ImageMetaData|ScopeFlags::Measurment) \
+    VARIABLE(ReadOnly,  ImgMeasRadius,                 double,      ScopeFlags::ImageMetaData|ScopeFlags::Measurment) \
+    VARIABLE(ReadOnly,  ImgMeasDiameter,               double,      ScopeFlags::ImageMetaData|ScopeFlags::Measurment) \
+    VARIABLE(ReadOnly,  ImgMeasCircumference,          double,      ScopeFlags::ImageMetaData|ScopeFlags::Measurment) \
+    VARIABLE(ReadOnly,  ImgMeasMajorAxis,              double,      ScopeFlags::ImageMetaData|ScopeFlags::Measurment) \
+    VARIABLE(ReadOnly,  ImgMeasMinorAxis,              double,      ScopeFlags::ImageMetaData|ScopeFlags::Measurment) \
+    VARIABLE(ReadOnly,  PICSLinkDataTransferDir,       std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  NumDocWindows,                 int,         ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  NumImgDocWindows,              int,         ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  NumImgSeqDocWindows,           int,         ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  NumThumbnailDocWindows,        int,         ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  NumRptTemplateDocWindows,      int,         ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  NumDlgDesignDocWindows,        int,         ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  DocWindowType,                 int,         ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  DocWindowMode,                 int,         ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  DocNewOrModified,              bool,        ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  PrefsFilePath,                 std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  UserDesktopPath,               std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  CommonDesktopPath,             std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  OpenImgFilePath,               std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  SaveImgFilePath,               std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  OpenImgSeqFilePath,            std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  SaveImgSeqFilePath,            std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  OpenRptFilePath,               std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  SaveRptFilePath,               std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  MacroFilePath,                 std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  MovieExportFilePath,           std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  BaseMacroFilePath,             std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  BaseDialogFilePath,            std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  BaseRptFilePath,               std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  BaseObjImgFilePath,            std::string, ScopeFlags::ApplicationState|ScopeFlags::FilePath) \
+    VARIABLE(ReadOnly,  AppVisible,                    bool,        ScopeFlags::ApplicationState) \
+    VARIABLE(ReadOnly,  AppActive,                     bool,        ScopeFlags::ApplicationState) \
+    VARIABLE(ReadWrite, CalMarkOrientation,            double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, CalMarkColor,                  double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, CalMarkLineThickness,          double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, CalMarkLineEndLength,          double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, CalMarkShowText,               bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, CalMarkTextFontName,           std::string, ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, CalMarkTextFontSize,           double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, CalMarkTextRotation,           double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, CalMarkDecimals,               double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementColor,              double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementLineThickness,      double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementTextFontName,       std::string, ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementTextFontSize,       double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementTextRotation,       double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementDecimals,           int,         ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowCircleArea,     bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowCircleRadius,   bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowCircleDiameter, bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowCircleCircum,   bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowRectArea,       bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowRectLength,     bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowRectWidth,      bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowRectPerim,      bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowEllipseArea,    bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowEllipseMajAxis, bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowEllipseMinAxis, bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowEllipsePerim,   bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowRegionArea,     bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MeasurementShowRegionPerim,    bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, AnnotLineBorderThickness,      double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, AnnotTextLineColor,            double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, AnnotBkgdFillColor,            double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, AnnotTextFontName,             std::string, ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, AnnotTextFontSize,             double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, AnnotTextRotation,             double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, AnnotTextJustification,        double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, AnnotTextBackgroundMode,       double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, AnnotFillObject,               bool,        ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, AnnotArrowHeadSize,            double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MagnifierWindowWidth,          double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MagnifierWindowHeight,         double,      ScopeFlags::UserSetting) \
+    VARIABLE(ReadWrite, MagnifierMagnificationFactor,  double,      ScopeFlags::UserSetting)
+
+namespace StdVars
+{
+    using HostInterop::ScopeFlags;
+
+#define STANDARD_VARIABLE_REF(Access, Name, Type, Scope) HOST_VARIABLE(Name, #Name, Type, Access)
+    STANDARD_HOST_VARIABLES(STANDARD_VARIABLE_REF)
+#undef STANDARD_VARIABLE_REF
+}
+
 namespace internal
 {
-    // 
+    using HostInterop::ScopeFlags;
+
+#define STANDARD_VARIABLE_SCRIPT_ITEM(Access, Name, Type, Scope) \
+    { HostInterop::Access::readOnly, #Name, HostInterop::VariableTraits<Type>::type, Scope },
+
     const var_script_item_t std_vars_build_script[] = {
-        {false, "TextVar1",                     VariableType::Text,     ScopeFlags::Unknown},   
-        {false, "TextVar2",                     VariableType::Text,     ScopeFlags::Unknown},   
-        {false, "TextVar3",                     VariableType::Text,     ScopeFlags::Unknown},   
-        {false, "TextVar4",                     VariableType::Text,     ScopeFlags::Unknown},   
-        {false, "TextVar5",                     VariableType::Text,     ScopeFlags::Unknown},   
-        {false, "_argT1",                       VariableType::Text,     ScopeFlags::Unknown},   
-        {false, "_argT2",                       VariableType::Text,     ScopeFlags::Unknown},   
-        {false, "_argT3",                       VariableType::Text,     ScopeFlags::Unknown},   
-        {false, "_argT4",                       VariableType::Text,     ScopeFlags::Unknown},   
-        {false, "_argT5",                       VariableType::Text,     ScopeFlags::Unknown},   
-        {false, "NumVar1",                      VariableType::Numeric,  ScopeFlags::Unknown},   
-        {false, "NumVar2",                      VariableType::Numeric,  ScopeFlags::Unknown},   
-        {false, "NumVar3",                      VariableType::Numeric,  ScopeFlags::Unknown},   
-        {false, "NumVar4",                      VariableType::Numeric,  ScopeFlags::Unknown},   
-        {false, "NumVar5",                      VariableType::Numeric,  ScopeFlags::Unknown},   
-        {false, "_argN1",                       VariableType::Numeric,  ScopeFlags::Unknown},   
-        {false, "_argN2",                       VariableType::Numeric,  ScopeFlags::Unknown},   
-        {false, "_argN3",                       VariableType::Numeric,  ScopeFlags::Unknown},   
-        {false, "_argN4",                       VariableType::Numeric,  ScopeFlags::Unknown},   
-        {false, "_argN5",                       VariableType::Numeric,  ScopeFlags::Unknown},   
-        {false, "BoolVar1",                     VariableType::Bool,     ScopeFlags::Unknown},   
-        {false, "BoolVar2",                     VariableType::Bool,     ScopeFlags::Unknown},   
-        {false, "BoolVar3",                     VariableType::Bool,     ScopeFlags::Unknown},   
-        {false, "BoolVar4",                     VariableType::Bool,     ScopeFlags::Unknown},   
-        {false, "BoolVar5",                     VariableType::Bool,     ScopeFlags::Unknown},   
-        {false, "_argB1",                       VariableType::Bool,     ScopeFlags::Unknown},   
-        {false, "_argB2",                       VariableType::Bool,     ScopeFlags::Unknown},   
-        {false, "_argB3",                       VariableType::Bool,     ScopeFlags::Unknown},   
-        {false, "_argB4",                       VariableType::Bool,     ScopeFlags::Unknown},   
-        {false, "_argB5",                       VariableType::Bool,     ScopeFlags::Unknown},   
-      //{false, "Timestamp1",                   VariableType::_TS,      ScopeFlags::Unknown},
-      //{false, "Timestamp2",                   VariableType::_TS,      ScopeFlags::Unknown},
-      //{false, "Timestamp3",                   VariableType::_TS,      ScopeFlags::Unknown},
-      //{false, "Timestamp4",                   VariableType::_TS,      ScopeFlags::Unknown},
-      //{false, "Timestamp5",                   VariableType::_TS,      ScopeFlags::Unknown},
-        {true,  "CameraSerialNum",              VariableType::Text,     ScopeFlags::CameraSetting},
-        {true,  "CameraName",                   VariableType::Text,     ScopeFlags::CameraSetting},  
-        {true,  "CurUserName",                  VariableType::Text,     ScopeFlags::UserSetting},     
-        {true,  "CurSensorTemp",                VariableType::Numeric,  ScopeFlags::CameraSetting},   
-        {true,  "CurImgSetupName",              VariableType::Text,     ScopeFlags::CameraSetting},   
-        {true,  "ImgUserName",                  VariableType::Text,     ScopeFlags::ImageMetaData},   
-        {true,  "ImgTitle",                     VariableType::Text,     ScopeFlags::ImageMetaData|ScopeFlags::FilePath},
-        {true,  "ImgMemo",                      VariableType::Text,     ScopeFlags::ImageMetaData},
-        {true,  "DBRecID",                      VariableType::Integer,  ScopeFlags::ImageMetaData},
-        {true,  "ImgSeqLen",                    VariableType::Integer,  ScopeFlags::ImageMetaData},
-        {true,  "ImgSeqIdx",                    VariableType::Integer,  ScopeFlags::ImageMetaData},
-        {true,  "ImgElapsedTime",               VariableType::Text,     ScopeFlags::ImageMetaData},
-        {true,  "ImgSetupName",                 VariableType::Text,     ScopeFlags::ImageMetaData},
-        {true,  "ImgSensorTemp",                VariableType::Numeric,  ScopeFlags::ImageMetaData},
-        {true,  "MacroLoopNum",                 VariableType::Integer,  ScopeFlags::Unknown},
-        {true,  "MacroCmdCanceled",             VariableType::Bool,     ScopeFlags::Unknown},
-        {true,  "MacroCmdFailed",               VariableType::Bool,     ScopeFlags::Unknown},
-      //{true,  "ImgDate",                      VariableType::_DATE ,   ScopeFlags::Unknown},
-      //{true,  "ImgTime",                      VariableType::_TIME ,   ScopeFlags::Unknown},
-      //{true,  "RptDate",                      VariableType::_DATE ,   ScopeFlags::Unknown},
-      //{true,  "RptTime",                      VariableType::_TIME ,   ScopeFlags::Unknown},
-      //{true,  "ImgTimestamp",                 VariableType::_TS,      ScopeFlags::Unknown|ScopeFlags::ImageMetaData},
-        {true,  "RptPageNum",                   VariableType::Integer,  ScopeFlags::Reporting}, 
-        {true,  "RptPageCount",                 VariableType::Integer,  ScopeFlags::Reporting},
-        {true,  "RptRecNum",                    VariableType::Integer,  ScopeFlags::Reporting}, 
-        {true,  "RptRecCount",                  VariableType::Integer,  ScopeFlags::Reporting},
-        {true,  "RunTimeText",                  VariableType::Text,     ScopeFlags::Reporting},
-        {true,  "MinExposure",                  VariableType::Numeric,  ScopeFlags::CameraSetting},
-        {true,  "MaxExposure",                  VariableType::Numeric,  ScopeFlags::CameraSetting},
-        {true,  "LiveImgOpen",                  VariableType::Bool,     ScopeFlags::ApplicationState},
-        {true,  "LiveImgRunning",               VariableType::Bool,     ScopeFlags::ApplicationState},
-        {true,  "LiveImgCount",                 VariableType::Integer,  ScopeFlags::ApplicationState},
-        {true,  "LiveImgContrast",              VariableType::Numeric,  ScopeFlags::ImageMetaData},
-        {true,  "OperationMode",                VariableType::Text,     ScopeFlags::ApplicationState},
-        {true,  "ImgMeasWidth",                 VariableType::Numeric,  ScopeFlags::Measurment|ScopeFlags::ApplicationState},
-        {true,  "ImgMeasLength",                VariableType::Numeric,  ScopeFlags::Measurment|ScopeFlags::ApplicationState},
-        {true,  "ImgMeasArea",                  VariableType::Numeric,  ScopeFlags::ImageMetaData|ScopeFlags::Measurment},
-        {true,  "ImgMeasPerimeter",             VariableType::Numeric,  ScopeFlags::ImageMetaData|ScopeFlags::Measurment},
-        {true,  "ImgMeasAngle",                 VariableType::Numeric,  ScopeFlags::ImageMetaData|ScopeFlags::Measurment},
-        {true,  "ImgMeasRadius",                VariableType::Numeric,  ScopeFlags::ImageMetaData|ScopeFlags::Measurment},
-        {true,  "ImgMeasDiameter",              VariableType::Numeric,  ScopeFlags::ImageMetaData|ScopeFlags::Measurment},
-        {true,  "ImgMeasCircumference",         VariableType::Numeric,  ScopeFlags::ImageMetaData|ScopeFlags::Measurment},
-        {true,  "ImgMeasMajorAxis",             VariableType::Numeric,  ScopeFlags::ImageMetaData|ScopeFlags::Measurment},
-        {true,  "ImgMeasMinorAxis",             VariableType::Numeric,  ScopeFlags::ImageMetaData|ScopeFlags::Measurment},
-        {true,  "PICSLinkDataTransferDir",      VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-      //{true,  "TwainMode",                    VariableType::Bool,     ScopeFlags::ApplicationState},
-        {true,  "NumDocWindows",                VariableType::Integer,  ScopeFlags::ApplicationState},
-        {true,  "NumImgDocWindows",             VariableType::Integer,  ScopeFlags::ApplicationState},
-        {true,  "NumImgSeqDocWindows",          VariableType::Integer,  ScopeFlags::ApplicationState},
-        {true,  "NumThumbnailDocWindows",       VariableType::Integer,  ScopeFlags::ApplicationState},
-        {true,  "NumRptTemplateDocWindows",     VariableType::Integer,  ScopeFlags::ApplicationState},
-        {true,  "NumDlgDesignDocWindows",       VariableType::Integer,  ScopeFlags::ApplicationState},
-        {true,  "DocWindowType",                VariableType::Integer,  ScopeFlags::ApplicationState},
-        {true,  "DocWindowMode",                VariableType::Integer,  ScopeFlags::ApplicationState},
-        {true,  "DocNewOrModified",             VariableType::Bool,     ScopeFlags::ApplicationState},
-        {true,  "PrefsFilePath",                VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "UserDesktopPath",              VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "CommonDesktopPath",            VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "OpenImgFilePath",              VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "SaveImgFilePath",              VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "OpenImgSeqFilePath",           VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "SaveImgSeqFilePath",           VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "OpenRptFilePath",              VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "SaveRptFilePath",              VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "MacroFilePath",                VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "MovieExportFilePath",          VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "BaseMacroFilePath",            VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "BaseDialogFilePath",           VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "BaseRptFilePath",              VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "BaseObjImgFilePath",           VariableType::Text,     ScopeFlags::ApplicationState|ScopeFlags::FilePath},
-        {true,  "AppVisible",                   VariableType::Bool,     ScopeFlags::ApplicationState},
-        {true,  "AppActive",                    VariableType::Bool,     ScopeFlags::ApplicationState},
-        {false, "CalMarkOrientation",           VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "CalMarkColor",                 VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "CalMarkLineThickness",         VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "CalMarkLineEndLength",         VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "CalMarkShowText",              VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "CalMarkTextFontName",          VariableType::Text,     ScopeFlags::UserSetting},
-        {false, "CalMarkTextFontSize",          VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "CalMarkTextRotation",          VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "CalMarkDecimals",              VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "MeasurementColor",             VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "MeasurementLineThickness",     VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "MeasurementTextFontName",      VariableType::Text,     ScopeFlags::UserSetting},
-        {false, "MeasurementTextFontSize",      VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "MeasurementTextRotation",      VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "MeasurementDecimals",          VariableType::Integer,  ScopeFlags::UserSetting},
-        {false, "MeasurementShowCircleArea",    VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "MeasurementShowCircleRadius",  VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "MeasurementShowCircleDiameter",VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "MeasurementShowCircleCircum",  VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "MeasurementShowRectArea",      VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "MeasurementShowRectLength",    VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "MeasurementShowRectWidth",     VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "MeasurementShowRectPerim",     VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "MeasurementShowEllipseArea",   VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "MeasurementShowEllipseMajAxis",VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "MeasurementShowEllipseMinAxis",VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "MeasurementShowEllipsePerim",  VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "MeasurementShowRegionArea",    VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "MeasurementShowRegionPerim",   VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "AnnotLineBorderThickness",     VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "AnnotTextLineColor",           VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "AnnotBkgdFillColor",           VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "AnnotTextFontName",            VariableType::Text,     ScopeFlags::UserSetting},
-        {false, "AnnotTextFontSize",            VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "AnnotTextRotation",            VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "AnnotTextJustification",       VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "AnnotTextBackgroundMode",      VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "AnnotFillObject",              VariableType::Bool,     ScopeFlags::UserSetting},
-        {false, "AnnotArrowHeadSize",           VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "MagnifierWindowWidth",         VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "MagnifierWindowHeight",        VariableType::Numeric,  ScopeFlags::UserSetting},
-        {false, "MagnifierMagnificationFactor", VariableType::Numeric,  ScopeFlags::UserSetting}
+        STANDARD_HOST_VARIABLES(STANDARD_VARIABLE_SCRIPT_ITEM)
     };
 
-} // end namespace internal
\ No newline at end of file
+#undef STANDARD_VARIABLE_SCRIPT_ITEM
+}
@@ -0,0 +1,495 @@
+#include "stdafx.h"
+#include <wincodec.h>
+#include <wrl/client.h>
+#include "CatalogFiles.h"
+#include "CatalogCounters.h"
+#include "ThumbnailCache.h"
+#include "BackgroundWorker.h"
+#include "DirectoryScanner.h"
+#include "CaseArchive.h"
+
+using namespace std;
+using namespace std::tr2;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+    const string THUMBNAIL_DIR_NAME = "thumbs";
+
+    ULONGLONG ToTicks(const FILETIME& ft)
+    {
+        return (static_cast<ULONGLONG>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+    }
+
+    bool GetSourceStamp(const sys::path& image, ULONGLONG& writeTime, uint64_t& size)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA attributes;
+        if (!GetFileAttributesExA(image.string().c_str(), GetFileExInfoStandard, &attributes))
+            return false;
+        writeTime = ToTicks(attributes.ftLastWriteTime);
+        size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+        return true;
+    }
+
+    wstring WidePath(const sys::path& path)
+    {
+        string narrow = path.string();
+        int length = MultiByteToWideChar(CP_ACP, 0, narrow.c_str(), -1, nullptr, 0);
+        wstring wide(max(length, 1), L'\0');
+        MultiByteToWideChar(CP_ACP, 0, narrow.c_str(), -1, &wide[0], length);
+        wide.resize(max(length, 1) - 1);
+        return wide;
+    }
+
+    // Opens a file for appending. Only one writer at a time is allowed, so wait for a writer on another workstation to finish.
+    HANDLE OpenForAppend(const sys::path& file)
+    {
+        for (int attempt = 0; attempt < 50; ++attempt)
+        {
+            HANDLE handle = CreateFileA(file.string().c_str(), FILE_APPEND_DATA, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (handle != INVALID_HANDLE_VALUE || GetLastError() != ERROR_SHARING_VIOLATION)
+                return handle;
+            Sleep(20);
+        }
+        return INVALID_HANDLE_VALUE;
+    }
+
+    bool WriteAll(HANDLE file, const void* data, size_t length)
+    {
+        DWORD written = 0;
+        return WriteFile(file, data, static_cast<DWORD>(length), &written, NULL) && written == length;
+    }
+
+    // Makes sure COM is initialized for the duration of a background task
+    class ComScope
+    {
+        HRESULT hr;
+    public:
+        ComScope() : hr(CoInitializeEx(NULL, COINIT_MULTITHREADED)) {}
+        ~ComScope() { if (SUCCEEDED(hr)) CoUninitialize(); }
+    };
+}
+
+ThumbnailCache& ThumbnailCache::Instance()
+{
+    static ThumbnailCache cache;
+    return cache;
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+    Reset();
+}
+
+bool ThumbnailCache::CreateThumbnail(const sys::path& image, unsigned maxDimension, vector<uint8_t>& jpeg, unsigned& width, unsigned& height)
+{
+    ComPtr<IWICImagingFactory> factory;
+    ComPtr<IWICBitmapDecoder> decoder;
+    ComPtr<IWICBitmapFrameDecode> frame;
+    if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory))) ||
+        FAILED(factory->CreateDecoderFromFilename(WidePath(image).c_str(), NULL, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder)) ||
+        FAILED(decoder->GetFrame(0, &frame)))
+        return false;
+
+    UINT sourceWidth = 0, sourceHeight = 0;
+    if (FAILED(frame->GetSize(&sourceWidth, &sourceHeight)) || sourceWidth == 0 || sourceHeight == 0)
+        return false;
+    double scale = min(1.0, static_cast<double>(maxDimension) / max(sourceWidth, sourceHeight));
+    width = max(1u, static_cast<UINT>(sourceWidth * scale + 0.5));
+    height = max(1u, static_cast<UINT>(sourceHeight * scale + 0.5));
+
+    // The JPEG decoder can scale by 1/2, 1/4 or 1/8 while decoding by dropping DCT coefficients,
+    // which is much faster than decoding every pixel. The result is then scaled to the exact size below.
+    ComPtr<IWICBitmapSource> source = frame;
+    ComPtr<IWICBitmapSourceTransform> transform;
+    if (SUCCEEDED(frame.As(&transform)))
+    {
+        UINT decodeWidth = width, decodeHeight = height;
+        WICPixelFormatGUID format = GUID_WICPixelFormat24bppBGR;
+        if (SUCCEEDED(transform->GetClosestSize(&decodeWidth, &decodeHeight)) &&
+            SUCCEEDED(transform->GetClosestPixelFormat(&format)) && format == GUID_WICPixelFormat24bppBGR &&
+            decodeWidth >= width && decodeHeight >= height && decodeWidth < sourceWidth)
+        {
+            UINT stride = (decodeWidth * 3 + 3) & ~3u;
+            vector<BYTE> pixels(stride * decodeHeight);
+            ComPtr<IWICBitmap> decoded;
+            if (SUCCEEDED(transform->CopyPixels(NULL, decodeWidth, decodeHeight, &format, WICBitmapTransformRotate0, stride, static_cast<UINT>(pixels.size()), pixels.data())) &&
+                SUCCEEDED(factory->CreateBitmapFromMemory(decodeWidth, decodeHeight, GUID_WICPixelFormat24bppBGR, stride, static_cast<UINT>(pixels.size()), pixels.data(), &decoded)))
+                source = decoded;
+        }
+    }
+
+    ComPtr<IWICFormatConverter> converter;
+    ComPtr<IWICBitmapScaler> scaler;
+    if (FAILED(factory->CreateFormatConverter(&converter)) ||
+        FAILED(converter->Initialize(source.Get(), GUID_WICPixelFormat24bppBGR, WICBitmapDitherTypeNone, NULL, 0.0, WICBitmapPaletteTypeCustom)) ||
+        FAILED(factory->CreateBitmapScaler(&scaler)) ||
+        FAILED(scaler->Initialize(converter.Get(), width, height, WICBitmapInterpolationModeFant)))
+        return false;
+
+    ComPtr<IStream> stream;
+    ComPtr<IWICBitmapEncoder> encoder;
+    ComPtr<IWICBitmapFrameEncode> frameEncode;
+    ComPtr<IPropertyBag2> properties;
+    WICPixelFormatGUID encodeFormat = GUID_WICPixelFormat24bppBGR;
+    if (FAILED(CreateStreamOnHGlobal(NULL, TRUE, &stream)) ||
+        FAILED(factory->CreateEncoder(GUID_ContainerFormatJpeg, NULL, &encoder)) ||
+        FAILED(encoder->Initialize(stream.Get(), WICBitmapEncoderNoCache)) ||
+        FAILED(encoder->CreateNewFrame(&frameEncode, &properties)) ||
+        FAILED(frameEncode->Initialize(properties.Get())) ||
+        FAILED(frameEncode->SetSize(width, height)) ||
+        FAILED(frameEncode->SetPixelFormat(&encodeFormat)) ||
+        FAILED(frameEncode->WriteSource(scaler.Get(), NULL)) ||
+        FAILED(frameEncode->Commit()) ||
+        FAILED(encoder->Commit()))
+        return false;
+
+    STATSTG stat;
+    LARGE_INTEGER start = {0};
+    ULONG read = 0;
+    if (FAILED(stream->Stat(&stat, STATFLAG_NONAME)) || FAILED(stream->Seek(start, STREAM_SEEK_SET, NULL)))
+        return false;
+    jpeg.resize(static_cast<size_t>(stat.cbSize.QuadPart));
+    return SUCCEEDED(stream->Read(jpeg.data(), static_cast<ULONG>(jpeg.size()), &read)) && read == jpeg.size();
+}
+
+// Reads the index entries appended since the index was last read.
+// A line that cannot be parsed means the index is damaged. The entries read before it are forgotten, so their
+// thumbnails are created again and appended after the damage, and reading goes on with the next line.
+// The lock must be held by the caller.
+void ThumbnailCache::ReadIndex(CasePack& pack)
+{
+    ifstream index(pack.indexFile.string(), ios::in | ios::binary);
+    if (!index)
+        return;
+    index.seekg(pack.indexBytesRead);
+    string line;
+    while (getline(index, line))
+    {
+        if (index.eof())
+            break; // a partial line that is still being written
+        pack.indexBytesRead += line.size() + 1;
+        vector<string> fields = Explode(line, '\t');
+        try
+        {
+            if (fields.size() != 7)
+                throw invalid_argument("The thumbnail index " + pack.indexFile.string() + " is damaged");
+            Entry entry;
+            entry.location.packFile = pack.packFile;
+            entry.sourceWriteTime = stoull(fields[1]);
+            entry.sourceSize = stoull(fields[2]);
+            entry.location.offset = stoull(fields[3]);
+            entry.location.length = static_cast<uint32_t>(stoul(fields[4]));
+            entry.location.width = static_cast<uint32_t>(stoul(fields[5]));
+            entry.location.height = static_cast<uint32_t>(stoul(fields[6]));
+            pack.entries[fields[0]] = entry;
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugStringA(ex.what());
+            pack.entries.clear();
+        }
+    }
+}
+
+void ThumbnailCache::Unmap(CasePack& pack)
+{
+    if (pack.view)
+        UnmapViewOfFile(pack.view);
+    if (pack.mapping)
+        CloseHandle(pack.mapping);
+    if (pack.file != INVALID_HANDLE_VALUE)
+        CloseHandle(pack.file);
+    pack.view = nullptr;
+    pack.mapping = NULL;
+    pack.file = INVALID_HANDLE_VALUE;
+    pack.mappedSize = 0;
+}
+
+// Unmaps the least recently read packs until there is room to map one more.
+// The lock must be held by the caller.
+void ThumbnailCache::UnmapLeastRecentlyRead()
+{
+    for (;;)
+    {
+        size_t mapped = 0;
+        CasePack* oldest = nullptr;
+        for (auto& item : packs)
+        {
+            CasePack& pack = item.second;
+            if (!pack.view)
+                continue;
+            ++mapped;
+            if (!oldest || pack.lastRead < oldest->lastRead)
+                oldest = &pack;
+        }
+        if (mapped < MaxMappedPacks)
+            return;
+        Unmap(*oldest);
+    }
+}
+
+// Gets the pack of the case that contains an image, reading any new index entries.
+// The lock must be held by the caller.
+ThumbnailCache::CasePack* ThumbnailCache::FindPack(const sys::path& catalog, const sys::path& image, string& entryKey)
+{
+    if (CatalogItemDepth(catalog, image) != 3 || !IsCatalogImageFileName(image.filename()))
+        return nullptr;
+    string caseDirectory = NormalizedPathKey(image.parent_path().parent_path());
+    entryKey = NormalizedPathKey(image).substr(caseDirectory.size() + 1);
+    CasePack& pack = packs[caseDirectory];
+    if (pack.packFile.empty())
+    {
+        string caseId = image.parent_path().parent_path().filename();
+        sys::path thumbnailDir = CatalogConfigDirectory(catalog) / sys::path(THUMBNAIL_DIR_NAME);
+        pack.packFile = thumbnailDir / sys::path(caseId + ".pack");
+        pack.indexFile = thumbnailDir / sys::path(caseId + ".tix");
+    }
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (GetFileAttributesExA(pack.indexFile.string().c_str(), GetFileExInfoStandard, &attributes) &&
+        ((static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow) > pack.indexBytesRead)
+        ReadIndex(pack);
+    return &pack;
+}
+
+// Adds an image to the pending set unless its thumbnail is current, it is already queued,
+// or it failed to decode and has not changed since. Returns true if the caller must queue it.
+// The lock must be held by the caller.
+bool ThumbnailCache::QueueIfNeeded(const string& imageKey, const Entry* entry, ULONGLONG writeTime, uint64_t size)
+{
+    if (entry != nullptr && entry->sourceWriteTime == writeTime && entry->sourceSize == size)
+        return false;
+    auto failure = failed.find(imageKey);
+    if (failure != failed.end())
+    {
+        if (failure->second.writeTime == writeTime && failure->second.size == size)
+            return false;
+        failed.erase(failure);
+    }
+    return pending.insert(imageKey).second;
+}
+
+bool ThumbnailCache::Lookup(const sys::path& catalog, const sys::path& image, ThumbnailLocation& location)
+{
+    ULONGLONG writeTime = 0;
+    uint64_t size = 0;
+    if (!GetSourceStamp(image, writeTime, size))
+        return false;
+    {
+        lock_guard<mutex> guard(lock);
+        string entryKey;
+        CasePack* pack = FindPack(catalog, image, entryKey);
+        if (!pack)
+            return false;
+        auto entry = pack->entries.find(entryKey);
+        if (entry != pack->entries.end() && entry->second.sourceWriteTime == writeTime && entry->second.sourceSize == size)
+        {
+            location = entry->second.location;
+            return true;
+        }
+        if (!QueueIfNeeded(NormalizedPathKey(image), entry != pack->entries.end() ? &entry->second : nullptr, writeTime, size))
+            return false; // already queued, or it cannot be decoded
+    }
+    vector<sys::path> images(1, image);
+    sys::path catalogRoot = catalog;
+    BackgroundWorker::LowPriority().Post([this, catalogRoot, images] () { Generate(catalogRoot, images); });
+    return false;
+}
+
+bool ThumbnailCache::Read(const sys::path& catalog, const sys::path& image, vector<uint8_t>& jpeg)
+{
+    ThumbnailLocation location;
+    if (!Lookup(catalog, image, location))
+        return false;
+    lock_guard<mutex> guard(lock);
+    string entryKey;
+    CasePack* pack = FindPack(catalog, image, entryKey);
+    if (!pack)
+        return false;
+    if (location.offset + location.length > pack->mappedSize)
+    {   // The pack is not mapped or has grown since it was mapped
+        Unmap(*pack);
+        UnmapLeastRecentlyRead();
+        pack->file = CreateFileA(pack->packFile.string().c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (pack->file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(pack->file, &size) || static_cast<uint64_t>(size.QuadPart) < location.offset + location.length)
+        {
+            Unmap(*pack);
+            return false;
+        }
+        pack->mapping = CreateFileMappingA(pack->file, NULL, PAGE_READONLY, 0, 0, NULL);
+        pack->view = pack->mapping ? static_cast<const char*>(MapViewOfFile(pack->mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+        if (!pack->view)
+        {
+            Unmap(*pack);
+            return false;
+        }
+        pack->mappedSize = size.QuadPart;
+    }
+    pack->lastRead = ++readCount;
+    jpeg.assign(pack->view + location.offset, pack->view + location.offset + location.length);
+    return true;
+}
+
+size_t ThumbnailCache::ScheduleCase(const sys::path& catalog, const string& caseId)
+{
+    vector<sys::path> images;
+    sys::path caseDir = catalog / sys::path(caseId);
+    if (CaseArchive::IsArchived(caseDir))
+        return 0; // the originals are in the archive. Thumbnails made before the case was archived are kept.
+    for (auto& specimen : DirectoryScanner::ListDirectories(caseDir))
+    {
+        sys::path specimenDir = caseDir / sys::path(specimen);
+        DirectoryScanner scanner(specimenDir);
+        DirectoryEntry found;
+        while (scanner.Next(found))
+        {
+            if (found.isDirectory || !IsCatalogImageFileName(found.name))
+                continue;
+            sys::path image = specimenDir / sys::path(found.name);
+            ULONGLONG writeTime = ToTicks(found.writeTime);
+            uint64_t size = found.size;
+            lock_guard<mutex> guard(lock);
+            string entryKey;
+            CasePack* pack = FindPack(catalog, image, entryKey);
+            if (!pack)
+                continue;
+            auto entry = pack->entries.find(entryKey);
+            if (QueueIfNeeded(NormalizedPathKey(image), entry != pack->entries.end() ? &entry->second : nullptr, writeTime, size))
+                images.push_back(image);
+        }
+    }
+    if (!images.empty())
+    {
+        sys::path catalogRoot = catalog;
+        BackgroundWorker::LowPriority().Post([this, catalogRoot, images] () { Generate(catalogRoot, images); });
+    }
+    return images.size();
+}
+
+// Runs on the background worker
+void ThumbnailCache::Generate(const sys::path& catalog, const vector<sys::path>& images)
+{
+    ComScope com;
+    size_t processed = 0;
+    for (; processed < images.size() && !BackgroundWorker::LowPriority().StopRequested(); ++processed)
+    {
+        const sys::path& image = images[processed];
+        ULONGLONG writeTime = 0;
+        uint64_t size = 0;
+        vector<uint8_t> jpeg;
+        unsigned width = 0, height = 0;
+        bool found = GetSourceStamp(image, writeTime, size);
+        bool created = found && CreateThumbnail(image, MaxDimension, jpeg, width, height);
+
+        string entryKey;
+        sys::path packFile, indexFile;
+        {
+            lock_guard<mutex> guard(lock);
+            string imageKey = NormalizedPathKey(image);
+            pending.erase(imageKey);
+            if (found && !created)
+            {   // Remember the failure so that the image is not queued again until it changes
+                FailedSource failure = { writeTime, size };
+                failed[imageKey] = failure;
+            }
+            CasePack* pack = created ? FindPack(catalog, image, entryKey) : nullptr;
+            if (!pack)
+                continue;
+            packFile = pack->packFile;
+            indexFile = pack->indexFile;
+        }
+        try
+        {
+            sys::create_directories(packFile.parent_path());
+            HANDLE pack = OpenForAppend(packFile);
+            if (pack == INVALID_HANDLE_VALUE)
+                continue;
+            LARGE_INTEGER offset;
+            bool written = GetFileSizeEx(pack, &offset) && WriteAll(pack, jpeg.data(), jpeg.size());
+            CloseHandle(pack);
+            if (!written)
+                continue;
+
+            // The index entry is only added once the data is in place
+            ostringstream line;
+            line << entryKey << '\t' << writeTime << '\t' << size << '\t' << offset.QuadPart << '\t' << jpeg.size() << '\t' << width << '\t' << height << '\n';
+            HANDLE index = OpenForAppend(indexFile);
+            if (index == INVALID_HANDLE_VALUE)
+                continue;
+            WriteAll(index, line.str().data(), line.str().size());
+            CloseHandle(index);
+        }
+        catch(const std::exception& ex)
+        {
+            OutputDebugStringA(ex.what());
+        }
+    }
+    // Images left over after a stop are dropped so that they can be queued again
+    lock_guard<mutex> guard(lock);
+    for (; processed < images.size(); ++processed)
+        pending.erase(NormalizedPathKey(images[processed]));
+}
+
+void ThumbnailCache::OnCaseRenamed(const sys::path& catalog, const string& oldCaseId, const string& newCaseId)
+{
+    sys::path thumbnailDir = CatalogConfigDirectory(catalog) / sys::path(THUMBNAIL_DIR_NAME);
+    sys::path oldPack = thumbnailDir / sys::path(oldCaseId + ".pack");
+    sys::path oldIndex = thumbnailDir / sys::path(oldCaseId + ".tix");
+    sys::path newPack = thumbnailDir / sys::path(newCaseId + ".pack");
+    sys::path newIndex = thumbnailDir / sys::path(newCaseId + ".tix");
+
+    // The pack must not be mapped while it is moved, and the cached entries of both names no longer apply
+    const string caseIds[] = { oldCaseId, newCaseId };
+    lock_guard<mutex> guard(lock);
+    for (auto& caseId : caseIds)
+    {
+        auto pack = packs.find(NormalizedPathKey(catalog / sys::path(caseId)));
+        if (pack != packs.end())
+        {
+            Unmap(pack->second);
+            packs.erase(pack);
+        }
+    }
+    if (!sys::exists(oldIndex))
+        return;
+    // The index is moved last so that an index is never left without its pack
+    if (!MoveFileExA(oldPack.string().c_str(), newPack.string().c_str(), MOVEFILE_REPLACE_EXISTING))
+        return;
+    if (!MoveFileExA(oldIndex.string().c_str(), newIndex.string().c_str(), MOVEFILE_REPLACE_EXISTING))
+        MoveFileExA(newPack.string().c_str(), oldPack.string().c_str(), 0);
+}
+
+void ThumbnailCache::OnCaseClosed(const sys::path& catalog, const string& caseId)
+{
+    lock_guard<mutex> guard(lock);
+    auto pack = packs.find(NormalizedPathKey(catalog / sys::path(caseId)));
+    if (pack != packs.end())
+        Unmap(pack->second);
+}
+
+void ThumbnailCache::OnCaseRemoved(const sys::path& catalog, const string& caseId)
+{
+    sys::path thumbnailDir = CatalogConfigDirectory(catalog) / sys::path(THUMBNAIL_DIR_NAME);
+    lock_guard<mutex> guard(lock);
+    auto pack = packs.find(NormalizedPathKey(catalog / sys::path(caseId)));
+    if (pack != packs.end())
+    {
+        Unmap(pack->second);
+        packs.erase(pack);
+    }
+    // The index is deleted first so that an index is never left without its pack
+    if (DeleteFileA(sys::path(thumbnailDir / sys::path(caseId + ".tix")).string().c_str()) || GetLastError() == ERROR_FILE_NOT_FOUND)
+        DeleteFileA(sys::path(thumbnailDir / sys::path(caseId + ".pack")).string().c_str());
+}
+
+void ThumbnailCache::Reset()
+{
+    lock_guard<mutex> guard(lock);
+    for (auto& pack : packs)
+        Unmap(pack.second);
+    packs.clear();
+    failed.clear();
+}
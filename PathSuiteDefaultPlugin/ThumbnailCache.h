@@ -0,0 +1,138 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+#include <filesystem>
+
+/// Summary:
+///   The location of a thumbnail within a case thumbnail pack.
+struct ThumbnailLocation
+{
+    ThumbnailLocation() : offset(0), length(0), width(0), height(0) {}
+
+    std::tr2::sys::path packFile;
+    uint64_t offset;    // The offset of the JPEG data within the pack file
+    uint32_t length;    // The length of the JPEG data
+    uint32_t width;
+    uint32_t height;
+};
+
+/// Summary:
+///   Cache of downscaled JPEG thumbnails of the catalog images.
+///   The thumbnails of each case are appended to a pack file in the catalog .config\thumbs directory.
+///   An index file beside it lists the offset of each thumbnail along with the last write time and size
+///   of the source image. A thumbnail is out of date when either of those change. Both files are only ever
+///   appended to, so the last entry for an image is the current one and other workstations can pick up
+///   new entries by reading the end of the index.
+///   Thumbnails are created on the low priority background worker. JPEG images are decoded directly at a
+///   reduced scale by the decoder so only a fraction of the source pixels are produced.
+///   At most MaxMappedPacks pack files are kept mapped. The least recently read one is unmapped to make room.
+class ThumbnailCache
+{
+public:
+    static const unsigned MaxDimension = 160;
+    static const size_t MaxMappedPacks = 8;
+
+private:
+    struct Entry
+    {
+        ThumbnailLocation location;
+        ULONGLONG sourceWriteTime;
+        uint64_t sourceSize;
+    };
+
+    // The stamp of a source image that could not be decoded
+    struct FailedSource
+    {
+        ULONGLONG writeTime;
+        uint64_t size;
+    };
+
+    struct CasePack
+    {
+        CasePack() : indexBytesRead(0), file(INVALID_HANDLE_VALUE), mapping(NULL), view(nullptr), mappedSize(0), lastRead(0) {}
+
+        std::tr2::sys::path packFile;
+        std::tr2::sys::path indexFile;
+        std::unordered_map<std::string, Entry> entries; // keyed by the lower case "specimen\image" path
+        uint64_t indexBytesRead;
+
+        // read only view of the pack file
+        HANDLE file;
+        HANDLE mapping;
+        const char* view;
+        uint64_t mappedSize;
+        uint64_t lastRead;  // the value of readCount when a thumbnail was last read from the view
+    };
+
+    std::mutex lock;
+    std::map<std::string, CasePack> packs;  // keyed by the normalized case directory
+    std::set<std::string> pending;          // normalized paths of the images queued for a thumbnail
+    std::unordered_map<std::string, FailedSource> failed;  // keyed by the normalized path of the image
+    uint64_t readCount;
+
+    ThumbnailCache() : readCount(0) {}
+    ThumbnailCache(const ThumbnailCache&);
+    ThumbnailCache& operator = (const ThumbnailCache&);
+
+    CasePack* FindPack(const std::tr2::sys::path& catalog, const std::tr2::sys::path& image, std::string& entryKey);
+    bool QueueIfNeeded(const std::string& imageKey, const Entry* entry, ULONGLONG writeTime, uint64_t size);
+    static void ReadIndex(CasePack& pack);
+    static void Unmap(CasePack& pack);
+    void UnmapLeastRecentlyRead();
+    void Generate(const std::tr2::sys::path& catalog, const std::vector<std::tr2::sys::path>& images);
+
+public:
+    ~ThumbnailCache();
+
+    static ThumbnailCache& Instance();
+
+    /// Summary:
+    ///   Decodes an image at a reduced size and encodes it as a JPEG.
+    ///   The caller must have initialized COM on the calling thread.
+    /// Returns:
+    ///   False if the image could not be decoded, for example a JPEG 2000 image without a WIC codec installed.
+    static bool CreateThumbnail(const std::tr2::sys::path& image, unsigned maxDimension, std::vector<uint8_t>& jpeg, unsigned& width, unsigned& height);
+
+    /// Summary:
+    ///   Finds the current thumbnail of an image.
+    ///   If there is no thumbnail, or it is out of date, one is queued to be created in the background.
+    ///   An image that could not be decoded is not queued again until its size or last write time changes.
+    /// Returns:
+    ///   True if location was set to a thumbnail that is up to date
+    bool Lookup(const std::tr2::sys::path& catalog, const std::tr2::sys::path& image, ThumbnailLocation& location);
+
+    /// Summary:
+    ///   Copies the current thumbnail of an image out of the mapped pack file.
+    /// Returns:
+    ///   False if there is no up to date thumbnail. One is queued to be created in the background.
+    bool Read(const std::tr2::sys::path& catalog, const std::tr2::sys::path& image, std::vector<uint8_t>& jpeg);
+
+    /// Summary:
+    ///   Queues the creation of the thumbnails of every image in a case that are missing or out of date.
+    ///   Archived cases are skipped because their images are only in the archive.
+    /// Returns:
+    ///   The number of images queued
+    size_t ScheduleCase(const std::tr2::sys::path& catalog, const std::string& caseId);
+
+    /// Summary:
+    ///   Moves the thumbnail pack and index of a case that was renamed so its thumbnails are not created again.
+    void OnCaseRenamed(const std::tr2::sys::path& catalog, const std::string& oldCaseId, const std::string& newCaseId);
+
+    /// Summary:
+    ///   Unmaps the thumbnail pack of a case that was closed. Its index stays cached.
+    void OnCaseClosed(const std::tr2::sys::path& catalog, const std::string& caseId);
+
+    /// Summary:
+    ///   Unmaps and deletes the thumbnail pack and index of a case that was deleted.
+    void OnCaseRemoved(const std::tr2::sys::path& catalog, const std::string& caseId);
+
+    /// Summary:
+    ///   Closes the mapped pack files and forgets the cached indexes and the images that could not be decoded.
+    void Reset();
+};
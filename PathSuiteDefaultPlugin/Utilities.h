@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <locale>
 #include <functional>
+#include <iterator>
+#include <boost/utility/string_ref.hpp>
 
 /// Summary
 ///   Rounds floating point numbers to nearest integer, where ties round away from zero
@@ -93,8 +95,24 @@ inline OutputIterator interlace_with(InputIterator first, InputIterator last, Ou
 }
 
 
+/// Summary:
+///   Tests for the whitespace characters of the classic "C" locale without a locale lookup.
+template<typename CharType>
+inline bool IsAsciiSpace(CharType c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/// Summary:
+///   Converts A-Z to lower case. This is what tolower does in the classic "C" locale, without the locale lookup.
+template<typename CharType>
+inline CharType AsciiToLower(CharType c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<CharType>(c - 'A' + 'a') : c;
+}
+
 template<typename StringType>
-inline bool AreEqualIgnoreCase(const StringType& first, const StringType& second, const std::locale& loc = std::locale::classic())
+inline bool AreEqualIgnoreCase(const StringType& first, const StringType& second, const std::locale& loc)
 {
     typedef typename StringType::const_iterator iter_type;
     if(first.size() != second.size())
@@ -111,6 +129,32 @@ inline bool AreEqualIgnoreCase(const StringType& first, const StringType& second
     return true;
 }
 
+/// Summary:
+///   Compares two strings ignoring case using the rules of the classic "C" locale.
+template<typename StringType>
+inline bool AreEqualIgnoreCase(const StringType& first, const StringType& second)
+{
+    if(first.size() != second.size())
+        return false;
+    return std::equal(first.begin(), first.end(), second.begin(), [] (typename StringType::value_type a, typename StringType::value_type b)
+    {
+        return a == b || AsciiToLower(a) == AsciiToLower(b);
+    });
+}
+
+/// Summary:
+///   Compares two strings ignoring case using the rules of the classic "C" locale.
+///   Accepts any mix of std::string, string literals and string_ref without copying.
+inline bool AreEqualIgnoreCase(boost::string_ref first, boost::string_ref second)
+{
+    if(first.size() != second.size())
+        return false;
+    return std::equal(first.begin(), first.end(), second.begin(), [] (char a, char b)
+    {
+        return a == b || AsciiToLower(a) == AsciiToLower(b);
+    });
+}
+
 /// Summary:
 ///   Splits a string into one or more strings that are created from dividing the
 ///   source string into sections separated by a section divider character. 
@@ -124,35 +168,149 @@ inline std::vector<StringType> Explode(const StringType& src, typename StringTyp
     for(typename StringType::const_iterator sectionStart = src.begin(); sectionStart != src.end(); )
     {
         typename StringType::const_iterator sectionEnd = std::find(sectionStart, src.end(), sectionDivider);
-        sections.push_back(std::string(sectionStart, sectionEnd));
+        sections.push_back(StringType(sectionStart, sectionEnd));
         sectionStart = (sectionEnd != src.end()) ? ++sectionEnd : src.end();
     }
     return sections;
 }
 
+/// Summary:
+///   The sections of a string separated by a section divider character, produced one at a time
+///   while iterating. Nothing is copied. Each section is a string_ref into the source string,
+///   so the source must outlive the iteration. The sections are the same as those returned by Explode.
+class SplitRange
+{
+    const char* first;
+    const char* last;
+    char divider;
+
+public:
+    class iterator : public std::iterator<std::input_iterator_tag, boost::string_ref, ptrdiff_t, const boost::string_ref*, boost::string_ref>
+    {
+        const char* sectionStart;
+        const char* sectionEnd;
+        const char* last;
+        char divider;
+
+    public:
+        iterator() : sectionStart(nullptr), sectionEnd(nullptr), last(nullptr), divider(0) {}
+        iterator(const char* first, const char* last, char divider) : sectionStart(first), last(last), divider(divider)
+        {
+            sectionEnd = std::find(sectionStart, last, divider);
+        }
+
+        boost::string_ref operator*() const { return boost::string_ref(sectionStart, sectionEnd - sectionStart); }
+
+        iterator& operator++()
+        {
+            sectionStart = (sectionEnd != last) ? sectionEnd + 1 : last;
+            sectionEnd = std::find(sectionStart, last, divider);
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const iterator& other) const { return sectionStart == other.sectionStart; }
+        bool operator!=(const iterator& other) const { return sectionStart != other.sectionStart; }
+    };
+
+    SplitRange(boost::string_ref src, char sectionDivider) : first(src.data()), last(src.data() + src.size()), divider(sectionDivider) {}
+
+    iterator begin() const { return iterator(first, last, divider); }
+    iterator end() const { return iterator(last, last, divider); }
+};
+
+/// Summary:
+///   Splits a string into sections separated by a section divider character without copying.
+///   The string must outlive the returned range. Do not pass a temporary.
+/// Example:
+///   for (auto line : Split(text, '\n')) ...
+inline SplitRange Split(boost::string_ref src, char sectionDivider)
+{
+    return SplitRange(src, sectionDivider);
+}
+
+/// Summary:
+///   The lines of a text, produced one at a time while iterating. Nothing is copied.
+///   Lines may end with "\n" or "\r\n"; the line ending is not part of the line.
+///   As with getline, text after the last line ending is a line and a line ending at the very end does not start another.
+class LineRange
+{
+    SplitRange sections;
+
+public:
+    class iterator : public std::iterator<std::input_iterator_tag, boost::string_ref, ptrdiff_t, const boost::string_ref*, boost::string_ref>
+    {
+        SplitRange::iterator section;
+
+    public:
+        iterator() {}
+        explicit iterator(const SplitRange::iterator& section) : section(section) {}
+
+        boost::string_ref operator*() const
+        {
+            boost::string_ref line = *section;
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            return line;
+        }
+
+        iterator& operator++() { ++section; return *this; }
+        iterator operator++(int) { iterator previous = *this; ++section; return previous; }
+
+        bool operator==(const iterator& other) const { return section == other.section; }
+        bool operator!=(const iterator& other) const { return section != other.section; }
+    };
+
+    explicit LineRange(boost::string_ref text) : sections(text, '\n') {}
+
+    iterator begin() const { return iterator(sections.begin()); }
+    iterator end() const { return iterator(sections.end()); }
+};
+
+/// Summary:
+///   Splits a text into lines without copying. The text must outlive the returned range.
+inline LineRange SplitLines(boost::string_ref text)
+{
+    return LineRange(text);
+}
+
+/// Summary:
+///   Joins a sequence of strings placing joinWith between each pair.
+///   The output is allocated once. The iterators must be forward iterators.
 template <typename InputIterator, typename JoinType, typename StringType = InputIterator::value_type>
 inline StringType JoinWith(InputIterator first, InputIterator last, const JoinType& joinWith)
 {
+    const StringType separator(joinWith);
     StringType output;
-    while(first != last)
-    {
-        output.append(*(first++));
-        if (first != last)
-            output.append(joinWith).append(*(first++));
-    }
+    if (first == last)
+        return output;
+    size_t length = 0;
+    size_t count = 0;
+    for (InputIterator item = first; item != last; ++item, ++count)
+        length += item->size();
+    output.reserve(length + separator.size() * (count - 1));
+    output.append(*first);
+    while (++first != last)
+        output.append(separator).append(*first);
     return output;
 }
 
 template<typename StringType>
 inline void TrimLeft(StringType& toTrim)
 {
-    toTrim.erase(toTrim.begin(), std::find_if_not(toTrim.begin(), toTrim.end(), [](StringType::value_type c) { return std::isspace(c, std::locale::classic());}));
+    toTrim.erase(toTrim.begin(), std::find_if_not(toTrim.begin(), toTrim.end(), IsAsciiSpace<typename StringType::value_type>));
 }
 
 template<typename StringType>
 inline void TrimRight(StringType& toTrim)
 {
-    std::string::iterator last = std::find_if_not(toTrim.rbegin(), toTrim.rend(), [](StringType::value_type c) { return std::isspace(c, std::locale::classic());}).base();
+    typename StringType::iterator last = std::find_if_not(toTrim.rbegin(), toTrim.rend(), IsAsciiSpace<typename StringType::value_type>).base();
     toTrim.erase(last, toTrim.end());
 }
 
@@ -163,26 +321,48 @@ inline void Trim(StringType& toTrim)
     TrimLeft(toTrim);
 }
 
+/// Summary:
+///   Returns the part of the text without whitespace at the start. Nothing is copied.
+inline boost::string_ref TrimLeftView(boost::string_ref text)
+{
+    while (!text.empty() && IsAsciiSpace(text.front()))
+        text.remove_prefix(1);
+    return text;
+}
+
+/// Summary:
+///   Returns the part of the text without whitespace at the end. Nothing is copied.
+inline boost::string_ref TrimRightView(boost::string_ref text)
+{
+    while (!text.empty() && IsAsciiSpace(text.back()))
+        text.remove_suffix(1);
+    return text;
+}
+
+/// Summary:
+///   Returns the part of the text without whitespace at either end. Nothing is copied.
+inline boost::string_ref TrimView(boost::string_ref text)
+{
+    return TrimLeftView(TrimRightView(text));
+}
+
 template<typename StringType>
-inline StringType TrimLeftCopy(StringType toTrim)
+inline StringType TrimLeftCopy(const StringType& toTrim)
 {
-    TrimLeft(toTrim);
-    return toTrim;
+    return StringType(std::find_if_not(toTrim.begin(), toTrim.end(), IsAsciiSpace<typename StringType::value_type>), toTrim.end());
 }
 
 template<typename StringType>
-inline StringType TrimRightCopy(StringType toTrim)
+inline StringType TrimRightCopy(const StringType& toTrim)
 {
-    TrimRight(toTrim);
-    return toTrim;
+    return StringType(toTrim.begin(), std::find_if_not(toTrim.rbegin(), toTrim.rend(), IsAsciiSpace<typename StringType::value_type>).base());
 }
 
 template<typename StringType>
-inline StringType TrimCopy(StringType toTrim)
+inline StringType TrimCopy(const StringType& toTrim)
 {
-    TrimRight(toTrim);
-    TrimLeft(toTrim);
-    return toTrim;
+    auto last = std::find_if_not(toTrim.rbegin(), toTrim.rend(), IsAsciiSpace<typename StringType::value_type>).base();
+    return StringType(std::find_if_not(toTrim.begin(), last, IsAsciiSpace<typename StringType::value_type>), last);
 }
 
 
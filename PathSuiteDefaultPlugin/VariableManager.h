@@ -1,11 +1,14 @@
 #include <memory>
+#include <algorithm>
 #include "StandardHostVariables.h"
+#include "VariableSnapshot.h"
 #include "CppMacroTools.h"
 
 class VariableManager
 {
     typedef std::unordered_map<std::string, std::shared_ptr<IVariable>> ivar_collection_t;
     ivar_collection_t variableCollection;
+    VariableSnapshot snapshot;
 
 public:
     VariableManager()
@@ -35,6 +38,40 @@ public:
         }
     }
 
+    /// Summary:
+    ///     Saves the values of all the variables to a snapshot file owned by the plug-in. Unlike SaveAll
+    ///     the file is written in one pass, and when the file already holds a snapshot of the same variables,
+    ///     saved by this or an earlier run, only the values that changed since are appended.
+    /// Throws:
+    ///     runtime_error if the file could not be written
+    void SaveSnapshot(const std::string& fileName)
+    {
+        std::vector<const IVariable*> variables;
+        variables.reserve(variableCollection.size());
+        for(auto& item : variableCollection)
+        {
+            if (item.second)
+                variables.push_back(item.second.get());
+        }
+        // A stable order lets later saves append to the same name table
+        std::sort(variables.begin(), variables.end(), [](const IVariable* left, const IVariable* right) { return left->Name() < right->Name(); });
+        snapshot.Save(fileName, variables);
+    }
+
+    /// Summary:
+    ///     Restores all the mutable variables that are in a snapshot file written by SaveSnapshot.
+    ///     A variable that could not be set does not stop the others from being restored.
+    /// Arguments:
+    ///     failures - Receives a line of the form "<name>: <reason>" for each variable that could not be set
+    /// Returns:
+    ///     The number of variables that were restored
+    /// Throws:
+    ///     runtime_error if the file could not be read
+    size_t RestoreSnapshot(const std::string& fileName, std::vector<std::string>& failures)
+    {
+        return snapshot.Restore(fileName, AllMutable(), failures);
+    }
+
     std::vector<IVariable*> MatchingAll(HostInterop::ScopeFlags withScope) const
     {
         std::vector<IVariable*> matching;
@@ -0,0 +1,398 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <stdint.h>
+#include <string.h>
+#include "HostVariables.h"
+
+/// Summary:
+///   Saves and restores the values of a set of host variables in a single file owned by the plug-in.
+///   The file starts with a table of the variable names followed by records of (name index, kind, value).
+///   The first save writes a record for every variable. Later saves of the same variables to the same
+///   file append records only for the values that changed, and a restore applies the records in order
+///   so the last record of each variable wins. The file is rewritten in full when the appended records
+///   make it more than twice the size of a full save.
+class VariableSnapshot
+{
+public:
+    enum ValueKind : uint8_t
+    {
+        NoValue = 0,
+        BoolValue = 1,
+        NumericValue = 2,
+        IntegerValue = 3,
+        TextValue = 4
+    };
+
+    struct Value
+    {
+        ValueKind kind;
+        double number;
+        std::string text;
+
+        Value() : kind(NoValue), number(0) {}
+
+        // Numbers are compared by their bits so that a NaN equals itself and is not saved again as a change
+        bool operator == (const Value& other) const
+        {
+            return kind == other.kind && memcmp(&number, &other.number, sizeof(number)) == 0 && text == other.text;
+        }
+        bool operator != (const Value& other) const { return !(*this == other); }
+    };
+
+private:
+    static const uint32_t FormatVersion = 1;
+    static const size_t MaxTextLength = 32767;
+
+    // The state of the file written last, so the next save to it can append only the changes
+    std::string lastFileName;
+    std::vector<std::string> lastNames;
+    std::vector<Value> lastValues;
+    uint64_t baseLength;    // The length of the file after its last full write
+    uint64_t fileLength;    // The length of the file after the last write
+
+    VariableSnapshot(const VariableSnapshot&);
+    VariableSnapshot& operator = (const VariableSnapshot&);
+
+    static const char* Magic() { return "PSVS"; }
+
+    template<typename T>
+    static void Put(std::string& buffer, T value)
+    {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template<typename T>
+    static bool Take(const char*& position, const char* end, T& value)
+    {
+        if (static_cast<size_t>(end - position) < sizeof(value))
+            return false;
+        memcpy(&value, position, sizeof(value));
+        position += sizeof(value);
+        return true;
+    }
+
+    static void PutRecord(std::string& buffer, uint32_t index, const Value& value)
+    {
+        Put(buffer, index);
+        Put(buffer, static_cast<uint8_t>(value.kind));
+        if (value.kind == TextValue)
+        {
+            Put(buffer, static_cast<uint32_t>(value.text.size()));
+            buffer.append(value.text);
+        }
+        else if (value.kind == BoolValue)
+            Put(buffer, static_cast<uint8_t>(value.number != 0));
+        else
+            Put(buffer, value.number);
+    }
+
+    static bool TakeRecord(const char*& position, const char* end, uint32_t& index, Value& value)
+    {
+        uint8_t kind = 0;
+        if (!Take(position, end, index) || !Take(position, end, kind))
+            return false;
+        value.kind = static_cast<ValueKind>(kind);
+        value.text.clear();
+        value.number = 0;
+        switch (value.kind)
+        {
+        case BoolValue:
+            {
+                uint8_t flag = 0;
+                if (!Take(position, end, flag))
+                    return false;
+                value.number = flag ? 1 : 0;
+                return true;
+            }
+        case NumericValue:
+        case IntegerValue:
+            return Take(position, end, value.number);
+        case TextValue:
+            {
+                uint32_t length = 0;
+                if (!Take(position, end, length) || static_cast<size_t>(end - position) < length)
+                    return false;
+                value.text.assign(position, length);
+                position += length;
+                return true;
+            }
+        default:
+            return false;
+        }
+    }
+
+    static std::string FullContents(const std::vector<std::string>& names, const std::vector<Value>& values)
+    {
+        std::string buffer(Magic(), 4);
+        Put(buffer, FormatVersion);
+        Put(buffer, static_cast<uint32_t>(names.size()));
+        for (auto& name : names)
+        {
+            Put(buffer, static_cast<uint16_t>(name.size()));
+            buffer.append(name);
+        }
+        for (size_t index = 0; index < values.size(); ++index)
+        {
+            if (values[index].kind != NoValue)
+                PutRecord(buffer, static_cast<uint32_t>(index), values[index]);
+        }
+        return buffer;
+    }
+
+    static uint64_t CurrentLength(const std::string& fileName)
+    {
+        std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+        return file ? static_cast<uint64_t>(file.tellg()) : 0;
+    }
+
+    static bool ReadContents(const std::string& fileName, std::string& contents)
+    {
+        std::ifstream file(fileName, std::ios::binary);
+        if (!file)
+            return false;
+        contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+
+    // Reads the name table and applies the records in order so the last record of each variable wins.
+    // validLength is set to the length of the contents up to the end of the last complete record.
+    // Returns false if the contents are not a variable snapshot or the name table is damaged.
+    static bool Parse(const std::string& contents, std::vector<std::string>& names, std::vector<Value>& values, size_t& validLength)
+    {
+        const char* start = contents.data();
+        const char* position = start;
+        const char* end = position + contents.size();
+        uint32_t version = 0;
+        uint32_t nameCount = 0;
+        if (contents.compare(0, 4, Magic()) != 0)
+            return false;
+        position += 4;
+        if (!Take(position, end, version) || version != FormatVersion || !Take(position, end, nameCount))
+            return false;
+
+        names.clear();
+        for (uint32_t index = 0; index < nameCount; ++index)
+        {
+            uint16_t length = 0;
+            if (!Take(position, end, length) || static_cast<size_t>(end - position) < length)
+                return false;
+            names.push_back(std::string(position, length));
+            position += length;
+        }
+
+        values.assign(names.size(), Value());
+        uint32_t recordIndex = 0;
+        Value record;
+        validLength = position - start;
+        while (TakeRecord(position, end, recordIndex, record) && recordIndex < values.size())
+        {
+            values[recordIndex] = record;
+            validLength = position - start;
+        }
+        return true;
+    }
+
+    // Takes the state of a file saved by an earlier run so the next save to it appends only the changes
+    void Seed(const std::string& fileName, const std::vector<std::string>& names)
+    {
+        std::string contents;
+        std::vector<std::string> fileNames;
+        std::vector<Value> fileValues;
+        size_t validLength = 0;
+        if (ReadContents(fileName, contents) && Parse(contents, fileNames, fileValues, validLength) &&
+            validLength == contents.size() && fileNames == names)
+            Remember(fileName, fileNames, fileValues, FullContents(fileNames, fileValues).size(), contents.size());
+    }
+
+    void Remember(const std::string& fileName, const std::vector<std::string>& names, const std::vector<Value>& values, uint64_t fullLength, uint64_t length)
+    {
+        lastFileName = fileName;
+        lastNames = names;
+        lastValues = values;
+        baseLength = fullLength;
+        fileLength = length;
+    }
+
+public:
+    VariableSnapshot() : baseLength(0), fileLength(0) {}
+
+    /// Summary:
+    ///   Reads the current value of a host variable.
+    /// Returns:
+    ///   A value with the kind NoValue if the variable could not be read
+    static Value Read(const IVariable& variable)
+    {
+        Value value;
+        const char* name = variable.Name().c_str();
+        try
+        {
+            // BoolVariable reports the Text type so the kind is taken from the class
+            if (dynamic_cast<const BoolVariable*>(&variable))
+            {
+                value.number = HostInterop::GetBoolVariable(name) ? 1 : 0;
+                value.kind = BoolValue;
+            }
+            else if (dynamic_cast<const IntegerVariable*>(&variable))
+            {
+                value.number = HostInterop::GetNumericVariable(name);
+                value.kind = IntegerValue;
+            }
+            else if (dynamic_cast<const NumericVariable*>(&variable))
+            {
+                value.number = HostInterop::GetNumericVariable(name);
+                value.kind = NumericValue;
+            }
+            else if (dynamic_cast<const TextVariable*>(&variable))
+            {
+                value.text = HostInterop::GetTextVariable<MaxTextLength>(name);
+                value.kind = TextValue;
+            }
+        }
+        catch(const std::runtime_error&)
+        {
+            value = Value();
+        }
+        return value;
+    }
+
+    /// Summary:
+    ///   Sets a host variable to a value read from a snapshot.
+    /// Throws:
+    ///   runtime_error if the host could not set the variable
+    static void Write(const IVariable& variable, const Value& value)
+    {
+        const char* name = variable.Name().c_str();
+        switch (value.kind)
+        {
+        case BoolValue:
+            HostInterop::SetBoolVariable(name, value.number != 0);
+            break;
+        case NumericValue:
+        case IntegerValue:
+            HostInterop::SetNumericVariable(name, value.number);
+            break;
+        case TextValue:
+            HostInterop::SetTextVariable(name, value.text);
+            break;
+        default:
+            break;
+        }
+    }
+
+    /// Summary:
+    ///   Saves the values of variables to a file. If the file was the last one saved or restored with the
+    ///   same variables and has not changed since, only the values that changed are appended to it.
+    ///   A file saved with the same variables by an earlier run is read first so that it is appended to as well.
+    /// Arguments:
+    ///   fileName  - The snapshot file
+    ///   variables - The variables to save, in the same order on each save. Variables that can not be read are skipped.
+    /// Throws:
+    ///   runtime_error if the file could not be written
+    void Save(const std::string& fileName, const std::vector<const IVariable*>& variables)
+    {
+        std::vector<std::string> names;
+        std::vector<Value> values;
+        names.reserve(variables.size());
+        values.reserve(variables.size());
+        for (auto variable : variables)
+        {
+            names.push_back(variable->Name());
+            values.push_back(Read(*variable));
+        }
+
+        if (fileName != lastFileName)
+            Seed(fileName, names);
+        bool canAppend = fileName == lastFileName &&
+                         names == lastNames &&
+                         CurrentLength(fileName) == fileLength;
+        if (canAppend)
+        {
+            std::string changes;
+            for (size_t index = 0; index < values.size(); ++index)
+            {
+                if (values[index].kind != NoValue && values[index] != lastValues[index])
+                    PutRecord(changes, static_cast<uint32_t>(index), values[index]);
+                else
+                    values[index] = lastValues[index];
+            }
+            if (changes.empty())
+                return;
+            if (fileLength + changes.size() <= 2 * baseLength)
+            {
+                std::ofstream file(fileName, std::ios::binary | std::ios::app);
+                if (!file.write(changes.data(), changes.size()).flush())
+                    throw std::runtime_error("Unable to write the variable snapshot " + fileName);
+                Remember(fileName, names, values, baseLength, fileLength + changes.size());
+                return;
+            }
+        }
+
+        std::string contents = FullContents(names, values);
+        std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+        if (!file.write(contents.data(), contents.size()).flush())
+        {
+            lastFileName.clear();
+            throw std::runtime_error("Unable to write the variable snapshot " + fileName);
+        }
+        Remember(fileName, names, values, contents.size(), contents.size());
+    }
+
+    /// Summary:
+    ///   Restores the values of variables from a file written by Save. Only the variables in the list that
+    ///   are also in the file are set. A record cut short at the end of the file is ignored.
+    ///   A variable that the host refuses to set does not stop the others from being restored.
+    /// Arguments:
+    ///   fileName  - The snapshot file
+    ///   variables - The variables that may be restored
+    ///   failures  - Receives a line of the form "<name>: <reason>" for each variable that could not be set
+    /// Returns:
+    ///   The number of variables that were set
+    /// Throws:
+    ///   runtime_error if the file could not be read or is not a variable snapshot
+    size_t Restore(const std::string& fileName, const std::vector<IVariable*>& variables, std::vector<std::string>& failures)
+    {
+        std::string contents;
+        if (!ReadContents(fileName, contents))
+            throw std::runtime_error("Unable to read the variable snapshot " + fileName);
+        std::vector<std::string> names;
+        std::vector<Value> values;
+        size_t validLength = 0;
+        if (!Parse(contents, names, values, validLength))
+            throw std::runtime_error("The file " + fileName + " is not a variable snapshot or is damaged");
+        std::unordered_map<std::string, size_t> nameIndex;
+        for (size_t index = 0; index < names.size(); ++index)
+            nameIndex[names[index]] = index;
+
+        size_t restored = 0;
+        for (auto variable : variables)
+        {
+            if (variable->IsReadOnly())
+                continue;
+            auto found = nameIndex.find(variable->Name());
+            if (found != nameIndex.end() && values[found->second].kind != NoValue)
+            {
+                try
+                {
+                    Write(*variable, values[found->second]);
+                    ++restored;
+                }
+                catch(const std::runtime_error& ex)
+                {
+                    failures.push_back(variable->Name() + ": " + ex.what());
+                }
+            }
+        }
+
+        // A following save of the same variables appends to the valid part of the file
+        if (validLength == contents.size())
+            Remember(fileName, names, values, FullContents(names, values).size(), contents.size());
+        else
+            lastFileName.clear();
+        return restored;
+    }
+};
@@ -0,0 +1,141 @@
+#include "stdafx.h"
+#include <algorithm>
+#include "VariableWatcher.h"
+
+using namespace std;
+
+VariableWatcher& VariableWatcher::Instance()
+{
+    static VariableWatcher watcher;
+    return watcher;
+}
+
+void VariableWatcher::Watch(IVariable* variable)
+{
+    WatchedVariable added;
+    added.variable.reset(variable);
+    for (auto& item : watched)
+    {
+        if (item.variable->Name() == variable->Name())
+        {
+            item = added;
+            return;
+        }
+    }
+    watched.push_back(added);
+}
+
+void VariableWatcher::Watch(const string& name, HostInterop::VariableType type)
+{
+    switch (type)
+    {
+    case HostInterop::VariableType::Bool:
+        Watch<BoolVariable>(name);
+        break;
+    case HostInterop::VariableType::Integer:
+        Watch<IntegerVariable>(name);
+        break;
+    case HostInterop::VariableType::Numeric:
+        Watch<NumericVariable>(name);
+        break;
+    case HostInterop::VariableType::Text:
+        Watch<TextVariable>(name);
+        break;
+    default:
+        throw invalid_argument("Unknown type for the variable " + name);
+    }
+}
+
+void VariableWatcher::Unwatch(const string& name)
+{
+    watched.erase(remove_if(watched.begin(), watched.end(), [&] (const WatchedVariable& item)
+    {
+        return item.variable->Name() == name;
+    }), watched.end());
+}
+
+bool VariableWatcher::IsWatching(const string& name) const
+{
+    return any_of(watched.begin(), watched.end(), [&] (const WatchedVariable& item)
+    {
+        return item.variable->Name() == name;
+    });
+}
+
+void VariableWatcher::SampleIfDue()
+{
+    ULONGLONG now = GetTickCount64();
+    if (watched.empty() || now - lastSampleTicks < interval)
+        return;
+    lastSampleTicks = now;
+    Sample();
+}
+
+void VariableWatcher::Sample()
+{
+    struct Change
+    {
+        string name;
+        VariableSnapshot::Value previous;
+        VariableSnapshot::Value current;
+    };
+    vector<Change> found;
+    for (auto& item : watched)
+    {
+        VariableSnapshot::Value current = VariableSnapshot::Read(*item.variable);
+        if (current.kind == VariableSnapshot::NoValue)
+            continue;
+        if (item.value.kind != VariableSnapshot::NoValue && item.value != current)
+        {
+            Change change;
+            change.name = item.variable->Name();
+            change.previous = item.value;
+            change.current = current;
+            found.push_back(change);
+        }
+        item.value = current;
+    }
+
+    // Raised after sampling so a handler may watch or unwatch variables
+    for (auto& change : found)
+    {
+        if (find(changes.begin(), changes.end(), change.name) == changes.end())
+            changes.push_back(change.name);
+        RaiseChange(change.name, change.previous, change.current);
+    }
+}
+
+void VariableWatcher::RaiseChange(const string& name, const VariableSnapshot::Value& previous, const VariableSnapshot::Value& current)
+{
+    switch (current.kind)
+    {
+    case VariableSnapshot::BoolValue:
+        {
+            bool_change_t args = { name, previous.number != 0, current.number != 0 };
+            boolChanged(args);
+            break;
+        }
+    case VariableSnapshot::NumericValue:
+    case VariableSnapshot::IntegerValue:
+        {
+            numeric_change_t args = { name, previous.number, current.number };
+            numericChanged(args);
+            break;
+        }
+    case VariableSnapshot::TextValue:
+        {
+            text_change_t args = { name, previous.text, current.text };
+            textChanged(args);
+            break;
+        }
+    default:
+        break;
+    }
+}
+
+vector<string> VariableWatcher::TakeChanges()
+{
+    vector<string> taken;
+    taken.swap(changes);
+    return taken;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "HostVariables.h"
+#include "MulticastEventDelegate.h"
+#include "VariableSnapshot.h"
+
+/// Summary:
+///   The argument of a VariableWatcher event.
+template<typename T>
+struct VariableChange
+{
+    std::string name;
+    T previous;
+    T current;
+};
+
+/// Summary:
+///   Samples a set of host variables when the host is idle and raises an event only when one of them changes,
+///   so handlers react to transitions instead of reading the variables in a loop.
+///   The variables are read at most once every Interval() milliseconds. The first sample of a variable only
+///   records its value. Changes are raised through the event for the type of the variable; integer variables
+///   use NumericChanged. The names of the changed variables are also kept for macros until TakeChanges is called.
+///   Must only be used on the host's thread.
+class VariableWatcher
+{
+public:
+    typedef VariableChange<bool>        bool_change_t;
+    typedef VariableChange<double>      numeric_change_t;
+    typedef VariableChange<std::string> text_change_t;
+
+    static const ULONGLONG DefaultIntervalMilliseconds = 250;
+
+private:
+    struct WatchedVariable
+    {
+        std::shared_ptr<IVariable> variable;
+        VariableSnapshot::Value value;
+    };
+
+    std::vector<WatchedVariable> watched;
+    std::vector<std::string> changes;   // changed since the last TakeChanges, in the order they first changed
+    ULONGLONG interval;
+    ULONGLONG lastSampleTicks;
+    MulticastEventDelegate<bool_change_t> boolChanged;
+    MulticastEventDelegate<numeric_change_t> numericChanged;
+    MulticastEventDelegate<text_change_t> textChanged;
+
+    VariableWatcher() : interval(DefaultIntervalMilliseconds), lastSampleTicks(0) {}
+    VariableWatcher(const VariableWatcher&);
+    VariableWatcher& operator = (const VariableWatcher&);
+
+    void RaiseChange(const std::string& name, const VariableSnapshot::Value& previous, const VariableSnapshot::Value& current);
+
+public:
+    static VariableWatcher& Instance();
+
+    /// Summary:
+    ///   Starts watching a variable. The watcher owns the variable. It replaces a watched variable with the same name.
+    void Watch(IVariable* variable);
+
+    /// Summary:
+    ///   Starts watching a variable of a host variable type.
+    /// Throws:
+    ///   invalid_argument if the type is not known
+    void Watch(const std::string& name, HostInterop::VariableType type);
+
+    template<typename T>
+    void Watch(const std::string& name)
+    {
+        Watch(new T(name.c_str()));
+    }
+
+    void Unwatch(const std::string& name);
+
+    bool IsWatching(const std::string& name) const;
+
+    ULONGLONG Interval() const { return interval; }
+    void Interval(ULONGLONG milliseconds) { interval = milliseconds; }
+
+    /// Summary:
+    ///   Reads the watched variables if at least Interval() milliseconds have passed since they were last read.
+    ///   Called when the host is idle.
+    void SampleIfDue();
+
+    /// Summary:
+    ///   Reads the watched variables and raises the events for those that changed.
+    ///   A variable that can not be read keeps its last value.
+    void Sample();
+
+    /// Summary:
+    ///   Gets the names of the variables that changed since the last call and clears them.
+    std::vector<std::string> TakeChanges();
+
+    MulticastEventDelegate<bool_change_t>& BoolChanged() { return boolChanged; }
+    MulticastEventDelegate<numeric_change_t>& NumericChanged() { return numericChanged; }
+    MulticastEventDelegate<text_change_t>& TextChanged() { return textChanged; }
+};
@@ -0,0 +1,253 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <float.h>
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "HostVariables.h"
+
+/// Summary:
+///   Converts a list of numbers to and from text so a series of values can be passed through a single
+///   text variable. The numbers are separated by ';' and written with the fewest significant digits
+///   that read back as the same double, which is never more than 17. The text does not depend on the
+///   locale. Infinite and NaN values are written as "inf", "-inf" and "nan".
+namespace NumberList
+{
+    const char Separator = ';';
+
+    struct Summary
+    {
+        size_t count;
+        double minimum;
+        double maximum;
+        double mean;
+    };
+
+namespace internal
+{
+    // The "C" locale so a host that changed the locale does not change the decimal point
+    inline _locale_t NumericLocale()
+    {
+        static _locale_t locale = _create_locale(LC_NUMERIC, "C");
+        return locale;
+    }
+
+    inline bool StartsWithIgnoreCase(const char* text, const char* prefix)
+    {
+        for (; *prefix; ++text, ++prefix)
+        {
+            if (AsciiToLower(*text) != *prefix)
+                return false;
+        }
+        return true;
+    }
+
+    // Reads one number at position and moves position past it. Returns false if there is no number.
+    inline bool ParseNumber(const char*& position, double& value)
+    {
+        char* end = nullptr;
+        value = _strtod_l(position, &end, NumericLocale());
+        if (end != position)
+        {
+            position = end;
+            return true;
+        }
+        // The runtime does not read the names of the special values
+        const char* name = position;
+        bool negative = *name == '-';
+        if (negative || *name == '+')
+            ++name;
+        if (StartsWithIgnoreCase(name, "nan"))
+        {
+            value = std::numeric_limits<double>::quiet_NaN();
+            position = name + 3;
+            return true;
+        }
+        if (StartsWithIgnoreCase(name, "inf"))
+        {
+            value = negative ? -std::numeric_limits<double>::infinity() : std::numeric_limits<double>::infinity();
+            position = name + (StartsWithIgnoreCase(name, "infinity") ? 8 : 3);
+            return true;
+        }
+        return false;
+    }
+
+    inline void AppendNumber(std::string& text, double value)
+    {
+        if (value != value)
+        {
+            text.append("nan");
+            return;
+        }
+        if (value == std::numeric_limits<double>::infinity() || value == -std::numeric_limits<double>::infinity())
+        {
+            text.append(value < 0 ? "-inf" : "inf");
+            return;
+        }
+        // A normal double's nearest decimal of 15 or fewer significant digits prints again unchanged at 15 digits,
+        // and %g drops the trailing zeros. So the first of 15, 16 and 17 digits that round trips is the shortest text.
+        // Subnormal values have less precision, so every length is tried for them.
+        char buffer[32];
+        int length = 0;
+        bool subnormal = value != 0 && value > -DBL_MIN && value < DBL_MIN;
+        for (int digits = subnormal ? 1 : 15; digits <= 17; ++digits)
+        {
+            length = _snprintf_s_l(buffer, sizeof(buffer), _TRUNCATE, "%.*g", NumericLocale(), digits, value);
+            if (_strtod_l(buffer, nullptr, NumericLocale()) == value)
+                break;
+        }
+        text.append(buffer, length);
+    }
+} // end namespace internal
+
+    /// Summary:
+    ///   Converts numbers to a ';' separated list.
+    template<typename T>
+    std::string Encode(const std::vector<T>& values)
+    {
+        static_assert(std::is_arithmetic<T>::value, "Only numbers can be encoded");
+        std::string text;
+        text.reserve(values.size() * 8);
+        for (size_t index = 0; index < values.size(); ++index)
+        {
+            if (index > 0)
+                text.push_back(Separator);
+            internal::AppendNumber(text, static_cast<double>(values[index]));
+        }
+        return text;
+    }
+
+    /// Summary:
+    ///   Reads a ';' separated list of numbers. Spaces around the numbers are ignored.
+    /// Arguments:
+    ///   text   - The list. An empty or blank text is an empty list.
+    ///   values - Set to the numbers in the list
+    /// Returns:
+    ///   False if an item of the list is not a number. values then holds the numbers before it.
+    inline bool Decode(const std::string& text, std::vector<double>& values)
+    {
+        values.clear();
+        if (TrimView(text).empty())
+            return true;
+        values.reserve(std::count(text.begin(), text.end(), Separator) + 1);
+        const char* position = text.c_str();
+        for (;;)
+        {
+            double value;
+            while (IsAsciiSpace(*position))
+                ++position;
+            if (!internal::ParseNumber(position, value))
+                return false;
+            values.push_back(value);
+            while (IsAsciiSpace(*position))
+                ++position;
+            if (*position == '\0')
+                return true;
+            if (*position++ != Separator)
+                return false;
+        }
+    }
+
+    /// Summary:
+    ///   Gets the count, minimum, maximum and mean of a list of numbers. NaN values are left out.
+    ///   The minimum, maximum and mean are NaN if there are no values.
+    template<typename T>
+    Summary Summarize(const std::vector<T>& values)
+    {
+        Summary summary;
+        summary.count = 0;
+        summary.minimum = std::numeric_limits<double>::infinity();
+        summary.maximum = -std::numeric_limits<double>::infinity();
+        double total = 0;
+        for (auto item : values)
+        {
+            double value = static_cast<double>(item);
+            if (value != value)
+                continue;
+            summary.minimum = value < summary.minimum ? value : summary.minimum;
+            summary.maximum = value > summary.maximum ? value : summary.maximum;
+            total += value;
+            ++summary.count;
+        }
+        if (summary.count == 0)
+            summary.minimum = summary.maximum = std::numeric_limits<double>::quiet_NaN();
+        summary.mean = summary.count > 0 ? total / summary.count : std::numeric_limits<double>::quiet_NaN();
+        return summary;
+    }
+} // end namespace NumberList
+
+//~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+/// Summary:
+///   A series of numbers stored in a host text variable as a NumberList.
+///   Integer values are rounded to the nearest whole number when they are read. A list read as int values
+///   must not hold NaN or a value that rounds outside the range of int.
+/// Template Arguments:
+///   T             - double or int
+///   MaxReadLength - The longest text that can be read from the variable
+template<typename T, size_t MaxReadLength = 32767>
+class VectorVariable : public Variable<std::vector<T>>
+{
+    static_assert(std::is_same<T, double>::value || std::is_same<T, int>::value, "VectorVariable holds double or int values");
+
+    std::string Text() const { return HostInterop::GetTextVariable<MaxReadLength>(this->name.c_str()); }
+
+public:
+    VectorVariable(const char* name, HostInterop::ScopeFlags scope = HostInterop::ScopeFlags::Unknown, bool isReadOnly = false) :
+        Variable<std::vector<T>>(name, nullptr, HostInterop::VariableType::Text, scope, isReadOnly)
+    { }
+
+    /// Throws:
+    ///   runtime_error if unable to get the variable value or it is not a list of numbers
+    ///   range_error if T is int and a value is NaN or out of the range of int
+    virtual std::vector<T> Value() const
+    {
+        std::vector<double> numbers;
+        if (!NumberList::Decode(Text(), numbers))
+            throw std::runtime_error(std::string("The variable (").append(this->name).append(") is not a list of numbers"));
+        return Converted(numbers, std::is_same<T, double>());
+    }
+
+    /// Throws:
+    ///   runtime_error if the variable is read only or unable to set the variable value
+    ///   length_error if the list is too long to be read back
+    virtual Variable<std::vector<T>>& Value(const std::vector<T>& values)
+    {
+        if (this->IsReadOnly())
+            throw std::runtime_error(std::string("Illegal operation. The variable (").append(this->name).append(") is a read only variable"));
+        std::string text = NumberList::Encode(values);
+        if (text.size() > MaxReadLength)
+            throw std::length_error(std::string("Too many values for the variable (").append(this->name).append(")"));
+        HostInterop::SetTextVariable(this->name.c_str(), text);
+        return *this;
+    }
+
+    NumberList::Summary Summarize() const { return NumberList::Summarize(Value()); }
+
+    virtual std::string ToString() { return Text(); }
+
+private:
+    static std::vector<double> Converted(std::vector<double>& numbers, std::true_type)
+    {
+        return std::move(numbers);
+    }
+
+    std::vector<int> Converted(const std::vector<double>& numbers, std::false_type) const
+    {
+        std::vector<int> values;
+        values.reserve(numbers.size());
+        for (auto number : numbers)
+        {
+            double rounded = round_to_nearest_awayzero(number);
+            // Also false for NaN. Converting NaN or a value out of range to int is undefined.
+            if (!(rounded >= (std::numeric_limits<int>::min)() && rounded <= (std::numeric_limits<int>::max)()))
+                throw std::range_error(std::string("The variable (").append(this->name).append(") holds a value that is not a valid int"));
+            values.push_back(static_cast<int>(rounded));
+        }
+        return values;
+    }
+};
@@ -0,0 +1,150 @@
+#include "stdafx.h"
+#include <string.h>
+#include "Xxh64.h"
+
+namespace
+{
+    const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+    const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+    const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+    inline uint64_t RotateLeft(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    // x86 is little endian and allows unaligned reads
+    inline uint64_t Read64(const unsigned char* p)
+    {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint32_t Read32(const unsigned char* p)
+    {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t Round(uint64_t accumulator, uint64_t input)
+    {
+        accumulator += input * PRIME64_2;
+        accumulator = RotateLeft(accumulator, 31);
+        return accumulator * PRIME64_1;
+    }
+
+    inline uint64_t MergeRound(uint64_t accumulator, uint64_t value)
+    {
+        accumulator ^= Round(0, value);
+        return accumulator * PRIME64_1 + PRIME64_4;
+    }
+}
+
+Xxh64::Xxh64(uint64_t seed)
+{
+    Reset(seed);
+}
+
+void Xxh64::Reset(uint64_t seed)
+{
+    this->seed = seed;
+    totalLength = 0;
+    buffered = 0;
+    v1 = seed + PRIME64_1 + PRIME64_2;
+    v2 = seed + PRIME64_2;
+    v3 = seed;
+    v4 = seed - PRIME64_1;
+}
+
+void Xxh64::Update(const void* data, size_t length)
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* end = p + length;
+    totalLength += length;
+
+    if (buffered + length < sizeof(buffer))
+    {
+        memcpy(buffer + buffered, p, length);
+        buffered += length;
+        return;
+    }
+    if (buffered > 0)
+    {   // complete the buffered stripe
+        size_t fill = sizeof(buffer) - buffered;
+        memcpy(buffer + buffered, p, fill);
+        v1 = Round(v1, Read64(buffer));
+        v2 = Round(v2, Read64(buffer + 8));
+        v3 = Round(v3, Read64(buffer + 16));
+        v4 = Round(v4, Read64(buffer + 24));
+        p += fill;
+        buffered = 0;
+    }
+    // The four lanes are independent which lets the processor work on them in parallel
+    uint64_t a = v1, b = v2, c = v3, d = v4;
+    for (; p + 32 <= end; p += 32)
+    {
+        a = Round(a, Read64(p));
+        b = Round(b, Read64(p + 8));
+        c = Round(c, Read64(p + 16));
+        d = Round(d, Read64(p + 24));
+    }
+    v1 = a; v2 = b; v3 = c; v4 = d;
+    if (p < end)
+    {
+        buffered = end - p;
+        memcpy(buffer, p, buffered);
+    }
+}
+
+uint64_t Xxh64::Digest() const
+{
+    uint64_t h64;
+    if (totalLength >= 32)
+    {
+        h64 = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        h64 = MergeRound(h64, v1);
+        h64 = MergeRound(h64, v2);
+        h64 = MergeRound(h64, v3);
+        h64 = MergeRound(h64, v4);
+    }
+    else
+        h64 = seed + PRIME64_5;
+    h64 += totalLength;
+
+    const unsigned char* p = buffer;
+    const unsigned char* end = buffer + buffered;
+    for (; p + 8 <= end; p += 8)
+    {
+        h64 ^= Round(0, Read64(p));
+        h64 = RotateLeft(h64, 27) * PRIME64_1 + PRIME64_4;
+    }
+    if (p + 4 <= end)
+    {
+        h64 ^= static_cast<uint64_t>(Read32(p)) * PRIME64_1;
+        h64 = RotateLeft(h64, 23) * PRIME64_2 + PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; ++p)
+    {
+        h64 ^= *p * PRIME64_5;
+        h64 = RotateLeft(h64, 11) * PRIME64_1;
+    }
+
+    h64 ^= h64 >> 33;
+    h64 *= PRIME64_2;
+    h64 ^= h64 >> 29;
+    h64 *= PRIME64_3;
+    h64 ^= h64 >> 32;
+    return h64;
+}
+
+uint64_t Xxh64::Hash(const void* data, size_t length, uint64_t seed)
+{
+    Xxh64 state(seed);
+    state.Update(data, length);
+    return state.Digest();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+/// Summary:
+///   The XXH64 non-cryptographic hash (https://github.com/Cyan4973/xxHash).
+///   Used to detect changed, corrupt and duplicate files. It is not suitable for security purposes.
+///   Data may be added in pieces of any size. The result does not depend on how the data was split.
+class Xxh64
+{
+    uint64_t totalLength;
+    uint64_t v1, v2, v3, v4;
+    unsigned char buffer[32];
+    size_t buffered;
+    uint64_t seed;
+
+public:
+    explicit Xxh64(uint64_t seed = 0);
+
+    void Reset(uint64_t seed = 0);
+    void Update(const void* data, size_t length);
+
+    /// Returns the hash of the data added so far. More data may still be added afterwards.
+    uint64_t Digest() const;
+
+    /// Returns the hash of a block of memory.
+    static uint64_t Hash(const void* data, size_t length, uint64_t seed = 0);
+};